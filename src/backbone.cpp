@@ -0,0 +1,121 @@
+#include "backbone.hpp"
+
+#include "formula.hpp"
+#include "mem.hpp"
+#include "os.hpp"
+#include <cstring>
+
+namespace sat {
+
+// Chunks grow after a confirmed chunk and shrink after a model, so mostly backbone formulas need few checks and the
+// candidates which are left over after a model are narrowed down quickly
+const i32 max_backbone_chunk_size = 256;
+
+inline bool has_bit(u64 *bits, i32 variable_id) { return bits[variable_id >> 6] & get_word_mask(variable_id); }
+
+Result find_backbone(Problem *problem, BackboneCallback callback, void *data, BackboneStats *stats,
+                     ProblemResult *result) {
+  assert(problem->cardinality_count == 0 && !problem->xor_system);
+
+  f64 start_time     = current_time();
+  i32 variable_count = problem->variable_count;
+  i32 word_count     = words_per_clause(problem);
+  *stats             = {0, 1};
+
+  // Variables set by unit clauses are the only ones assigned before the search
+  Formula formula = formula_from_problem(problem);
+  u64 *candidates = CAllocator::construct<u64>(word_count);
+  memcpy(candidates, problem->unassigned, usize(word_count) * sizeof(u64));
+
+  *result = dpll_solve(problem);
+  if (*result != SAT) {
+    CAllocator::destruct(candidates);
+    destroy_formula(&formula);
+    return ok;
+  }
+
+  u64 *values = CAllocator::construct<u64>(word_count);
+  memcpy(values, problem->assigned_values, usize(word_count) * sizeof(u64));
+  for (i32 i = 1; i < variable_count; ++i) {
+    if (has_bit(candidates, i)) continue;
+    callback(has_bit(values, i) ? i : -i, data);
+    ++stats->literal_count;
+  }
+
+  i32 *chunk          = CAllocator::construct<i32>(max_backbone_chunk_size);
+  i32 chunk_limit     = 1;
+  i32 next_candidate  = 1;
+  i32 candidate_count = 0;
+  for (i32 i = 1; i < variable_count; ++i) {
+    candidate_count += has_bit(candidates, i);
+  }
+
+  Result status = ok;
+  while (candidate_count > 0) {
+    // The chunk is taken round robin so that candidates which survived a model are not always checked first
+    i32 chunk_size = 0;
+    for (i32 visited = 0; visited < variable_count - 1 && chunk_size < chunk_limit; ++visited) {
+      i32 variable_id = next_candidate;
+      next_candidate  = next_candidate + 1 < variable_count ? next_candidate + 1 : 1;
+      if (!has_bit(candidates, variable_id)) continue;
+      chunk[chunk_size++] = has_bit(values, variable_id) ? -variable_id : variable_id;
+    }
+
+    size literal_count = formula.literal_count;
+    push_clause(&formula, chunk, chunk_size);
+    Problem check;
+    status                = load_problem(&check, &formula, problem->splitting_heuristic);
+    formula.literal_count = literal_count;
+    --formula.clause_count;
+    if (status) break;
+
+    check.double_lookahead = problem->double_lookahead;
+    check.limits           = problem->limits;
+    if (check.limits.time_limit > 0) {
+      f64 remaining = problem->limits.time_limit - (current_time() - start_time);
+      if (remaining <= 0) {
+        *result = UNKNOWN;
+        destroy_problem(&check);
+        break;
+      }
+      check.limits.time_limit = remaining;
+    }
+
+    ProblemResult check_result = dpll_solve(&check);
+    ++stats->solve_count;
+    if (check_result == UNKNOWN) {
+      *result = UNKNOWN;
+      destroy_problem(&check);
+      break;
+    }
+
+    if (check_result == UNSAT) {
+      // No model falsifies any literal of the chunk, so they are all backbone and become unit clauses
+      for (i32 i = 0; i < chunk_size; ++i) {
+        i32 literal = -chunk[i];
+        candidates[abs(literal) >> 6] &= ~get_word_mask(abs(literal));
+        push_clause(&formula, &literal, 1);
+        callback(literal, data);
+      }
+      stats->literal_count += chunk_size;
+      candidate_count -= chunk_size;
+      if (chunk_limit * 2 <= max_backbone_chunk_size) chunk_limit *= 2;
+    } else {
+      for (i32 k = 0; k < word_count; ++k) {
+        u64 disagreeing = candidates[k] & (values[k] ^ check.assigned_values[k]);
+        candidate_count -= __builtin_popcountll(disagreeing);
+        candidates[k] &= ~disagreeing;
+      }
+      if (chunk_limit > 1) chunk_limit /= 2;
+    }
+    destroy_problem(&check);
+  }
+
+  CAllocator::destruct(chunk);
+  CAllocator::destruct(values);
+  CAllocator::destruct(candidates);
+  destroy_formula(&formula);
+  return status;
+}
+
+} // namespace sat
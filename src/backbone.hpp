@@ -0,0 +1,28 @@
+#ifndef BACKBONE_HPP
+#define BACKBONE_HPP
+
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+struct BackboneStats {
+  i32 literal_count;
+  i32 solve_count;
+};
+
+// Called for every backbone literal as soon as it is confirmed, with the literal in signed DIMACS form
+typedef void (*BackboneCallback)(i32 literal, void *data);
+
+// Finds the literals which are true in every model of the problem. The first model gives the candidates, then chunks of
+// candidates are checked by solving with a clause that at least one of them is false: UNSAT confirms the whole chunk,
+// SAT removes every candidate the new model disagrees with. The clauses are converted once and every check reuses them
+// together with the confirmed literals as unit clauses.
+// The result is the one of the first solve, or UNKNOWN if a check runs into the limits. Returns err if a check
+// cannot be loaded. The problem may not have cardinality or xor constraints
+Result find_backbone(Problem *problem, BackboneCallback callback, void *data, BackboneStats *stats,
+                     ProblemResult *result);
+
+} // namespace sat
+
+#endif
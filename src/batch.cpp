@@ -0,0 +1,263 @@
+#include "batch.hpp"
+
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+struct BatchLanes {
+  i32 clause_capacity;
+  i32 clause_counts[batch_lane_count];
+
+  // Clause c of lane l is at c * batch_lane_count + l so that the lanes of a clause are next to each other. Lanes with
+  // fewer clauses are padded with the clause x0, which is always satisfied
+  u64 *clauses;
+  u64 *negations;
+
+  i32 formula_ids[batch_lane_count]; // -1 for an idle lane
+  u64 unassigned[batch_lane_count];
+  u64 values[batch_lane_count];
+  u64 preferred[batch_lane_count]; // Values of the decisions
+
+  // Assignment before every decision, the decided variable and whether its other value is tried already
+  i32 depths[batch_lane_count];
+  u64 saved_unassigned[max_batch_variable_count][batch_lane_count];
+  u64 saved_values[max_batch_variable_count][batch_lane_count];
+  i32 decided[max_batch_variable_count][batch_lane_count];
+  bool flipped[max_batch_variable_count][batch_lane_count];
+
+  // Variables are numbered by decreasing occurrences within a lane so that the next decision is the lowest free bit
+  i32 original_ids[batch_lane_count][max_batch_variable_count + 1];
+
+  // Implications of the last sweep
+  u64 implied_true[batch_lane_count];
+  u64 implied_false[batch_lane_count];
+  u64 falsified[batch_lane_count];
+};
+
+inline u64 *lane_clause(u64 *words, i32 clause_id, i32 lane) {
+  return words + size(clause_id) * batch_lane_count + lane;
+}
+
+void load_lane(BatchLanes *lanes, i32 lane, Formula *formula, i32 formula_id) {
+  i32 variable_count = formula->variable_count;
+  assert(variable_count <= max_batch_variable_count && formula->clause_count <= lanes->clause_capacity);
+
+  i32 true_counts[max_batch_variable_count + 1]  = {};
+  i32 false_counts[max_batch_variable_count + 1] = {};
+  for (size i = 0; i < formula->literal_count; ++i) {
+    i32 literal = formula->literals[i];
+    if (literal > 0) ++true_counts[literal];
+    if (literal < 0) ++false_counts[-literal];
+  }
+
+  // Selection by occurrences, ties go to the smaller variable id
+  i32 new_ids[max_batch_variable_count + 1];
+  bool numbered[max_batch_variable_count + 1] = {};
+  lanes->preferred[lane]                      = 0;
+  for (i32 new_id = 1; new_id <= variable_count; ++new_id) {
+    i32 best = 0;
+    for (i32 i = 1; i <= variable_count; ++i) {
+      if (numbered[i]) continue;
+      if (!best || true_counts[i] + false_counts[i] > true_counts[best] + false_counts[best]) best = i;
+    }
+    numbered[best]                    = true;
+    new_ids[best]                     = new_id;
+    lanes->original_ids[lane][new_id] = best;
+    if (true_counts[best] > false_counts[best]) lanes->preferred[lane] |= 1ul << new_id;
+  }
+
+  i32 clause_id = 0;
+  u64 clause    = 0;
+  u64 negation  = 0;
+  for (size i = 0; i < formula->literal_count; ++i) {
+    i32 literal = formula->literals[i];
+    if (literal) {
+      u64 mask = 1ul << new_ids[abs(literal)];
+      clause |= mask;
+      if (literal < 0) negation |= mask;
+      continue;
+    }
+    *lane_clause(lanes->clauses, clause_id, lane)   = clause;
+    *lane_clause(lanes->negations, clause_id, lane) = negation;
+    ++clause_id;
+    clause   = 0;
+    negation = 0;
+  }
+  for (; clause_id < lanes->clause_capacity; ++clause_id) {
+    *lane_clause(lanes->clauses, clause_id, lane)   = 1;
+    *lane_clause(lanes->negations, clause_id, lane) = 0;
+  }
+
+  lanes->clause_counts[lane] = formula->clause_count;
+  lanes->formula_ids[lane]   = formula_id;
+  lanes->unassigned[lane]    = variable_count == 63 ? ~1ul : (1ul << (variable_count + 1)) - 2;
+  lanes->values[lane]        = 1;
+  lanes->depths[lane]        = 0;
+}
+
+// All ones if the word is not zero, with operations which have vector forms in every SIMD instruction set
+inline u64 nonzero_mask(u64 word) { return u64(0) - ((word | (u64(0) - word)) >> 63); }
+
+// One pass over the clauses of all lanes which collects the values implied by clauses with a single unknown literal
+// and flags the lanes with a falsified clause. Idle lanes are swept as well and ignored later, clauses past the end of
+// the longest formula in the lanes are skipped
+void sweep_lanes(BatchLanes *lanes, i32 clause_count) {
+  u64 implied_true[batch_lane_count]  = {};
+  u64 implied_false[batch_lane_count] = {};
+  u64 falsified[batch_lane_count]     = {};
+  u64 unassigned[batch_lane_count];
+  u64 values[batch_lane_count];
+  memcpy(unassigned, lanes->unassigned, sizeof(unassigned));
+  memcpy(values, lanes->values, sizeof(values));
+
+  for (i32 c = 0; c < clause_count; ++c) {
+    u64 *clause_words   = lane_clause(lanes->clauses, c, 0);
+    u64 *negation_words = lane_clause(lanes->negations, c, 0);
+    for (i32 l = 0; l < batch_lane_count; ++l) {
+      u64 unknown    = clause_words[l] & unassigned[l];
+      u64 true_terms = clause_words[l] & ~unassigned[l] & (values[l] ^ negation_words[l]);
+
+      // All ones if the clause is not satisfied and has at most one unknown literal
+      u64 open = ~(nonzero_mask(true_terms) | nonzero_mask(unknown & (unknown - 1)));
+      implied_true[l] |= unknown & ~negation_words[l] & open;
+      implied_false[l] |= unknown & negation_words[l] & open;
+      falsified[l] |= open & ~nonzero_mask(unknown);
+    }
+  }
+
+  memcpy(lanes->implied_true, implied_true, sizeof(implied_true));
+  memcpy(lanes->implied_false, implied_false, sizeof(implied_false));
+  memcpy(lanes->falsified, falsified, sizeof(falsified));
+}
+
+void assign_lane(BatchLanes *lanes, i32 lane, i32 variable_id, bool value) {
+  u64 mask = 1ul << variable_id;
+  lanes->unassigned[lane] &= ~mask;
+  lanes->values[lane] = value ? lanes->values[lane] | mask : lanes->values[lane] & ~mask;
+}
+
+void decide_lane(BatchLanes *lanes, i32 lane) {
+  i32 depth       = lanes->depths[lane]++;
+  i32 variable_id = __builtin_ctzll(lanes->unassigned[lane]);
+
+  lanes->saved_unassigned[depth][lane] = lanes->unassigned[lane];
+  lanes->saved_values[depth][lane]     = lanes->values[lane];
+  lanes->decided[depth][lane]          = variable_id;
+  lanes->flipped[depth][lane]          = false;
+  assign_lane(lanes, lane, variable_id, lanes->preferred[lane] & (1ul << variable_id));
+}
+
+// Flips the deepest decision which has not been tried both ways. Returns false when the search space is exhausted
+bool backtrack_lane(BatchLanes *lanes, i32 lane) {
+  while (lanes->depths[lane] > 0 && lanes->flipped[lanes->depths[lane] - 1][lane]) --lanes->depths[lane];
+  if (lanes->depths[lane] == 0) return false;
+
+  i32 depth                   = lanes->depths[lane] - 1;
+  i32 variable_id             = lanes->decided[depth][lane];
+  lanes->unassigned[lane]     = lanes->saved_unassigned[depth][lane];
+  lanes->values[lane]         = lanes->saved_values[depth][lane];
+  lanes->flipped[depth][lane] = true;
+  assign_lane(lanes, lane, variable_id, !(lanes->preferred[lane] & (1ul << variable_id)));
+  return true;
+}
+
+// Model of the lane in the variable ids of its formula, checked against every clause of the lane
+u64 lane_model(BatchLanes *lanes, i32 lane) {
+  u64 values = lanes->values[lane];
+  for (i32 c = 0; c < lanes->clause_capacity; ++c) {
+    u64 clause   = *lane_clause(lanes->clauses, c, lane);
+    u64 negation = *lane_clause(lanes->negations, c, lane);
+    if (!(clause & (values ^ negation))) {
+      panic("Batch model of formula %d falsifies a clause\n", lanes->formula_ids[lane]);
+    }
+  }
+
+  u64 model = 0;
+  for (i32 i = 1; i <= max_batch_variable_count; ++i) {
+    if (values & (1ul << i)) model |= 1ul << lanes->original_ids[lane][i];
+  }
+  return model;
+}
+
+void solve_batch(Formula *formulas, i32 formula_count, ProblemResult *results, u64 *models, BatchStats *stats) {
+  *stats = {0, 0, 0, 0};
+
+  auto *lanes            = CAllocator::construct<BatchLanes>();
+  lanes->clause_capacity = 1;
+  for (i32 i = 0; i < formula_count; ++i) {
+    if (formulas[i].clause_count > lanes->clause_capacity) lanes->clause_capacity = formulas[i].clause_count;
+  }
+  size word_count  = size(lanes->clause_capacity) * batch_lane_count;
+  lanes->clauses   = CAllocator::construct<u64>(word_count);
+  lanes->negations = CAllocator::construct<u64>(word_count);
+  for (size i = 0; i < word_count; ++i) {
+    lanes->clauses[i]   = 1;
+    lanes->negations[i] = 0;
+  }
+
+  i32 next_formula = 0;
+  i32 busy_count   = 0;
+  for (i32 l = 0; l < batch_lane_count; ++l) {
+    lanes->formula_ids[l] = -1;
+    lanes->unassigned[l]  = 0;
+    lanes->values[l]      = 1;
+    if (next_formula < formula_count) {
+      load_lane(lanes, l, &formulas[next_formula], next_formula);
+      ++next_formula;
+      ++busy_count;
+    }
+  }
+
+  // Every step is one sweep after which each lane either applies its implications, backtracks from a conflict,
+  // decides or has a model, so lanes do not wait for each other to finish propagating
+  while (busy_count > 0) {
+    i32 clause_count = 0;
+    for (i32 l = 0; l < batch_lane_count; ++l) {
+      if (lanes->formula_ids[l] >= 0 && lanes->clause_counts[l] > clause_count) clause_count = lanes->clause_counts[l];
+    }
+    sweep_lanes(lanes, clause_count);
+    ++stats->sweeps;
+    stats->busy_lanes += busy_count;
+
+    for (i32 l = 0; l < batch_lane_count; ++l) {
+      i32 formula_id = lanes->formula_ids[l];
+      if (formula_id < 0) continue;
+
+      // A variable which is implied both ways is a conflict as well
+      u64 implied_true  = lanes->implied_true[l];
+      u64 implied_false = lanes->implied_false[l];
+      if (lanes->falsified[l] || (implied_true & implied_false)) {
+        ++stats->conflicts;
+        if (backtrack_lane(lanes, l)) continue;
+        results[formula_id] = UNSAT;
+      } else if (implied_true | implied_false) {
+        lanes->unassigned[l] &= ~(implied_true | implied_false);
+        lanes->values[l] = (lanes->values[l] | implied_true) & ~implied_false;
+        continue;
+      } else if (lanes->unassigned[l]) {
+        ++stats->decisions;
+        decide_lane(lanes, l);
+        continue;
+      } else {
+        results[formula_id] = SAT;
+        models[formula_id]  = lane_model(lanes, l);
+      }
+
+      // The lane is refilled right away, its first sweep is part of the next step
+      if (next_formula < formula_count) {
+        load_lane(lanes, l, &formulas[next_formula], next_formula);
+        ++next_formula;
+      } else {
+        lanes->formula_ids[l] = -1;
+        --busy_count;
+      }
+    }
+  }
+
+  CAllocator::destruct(lanes->clauses);
+  CAllocator::destruct(lanes->negations);
+  CAllocator::destruct(lanes);
+}
+
+} // namespace sat
@@ -0,0 +1,146 @@
+#include "builder.hpp"
+
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+// Sets of up to this many literals get pairwise at-most-one clauses, which need no auxiliary variables
+const i32 max_pairwise_at_most_one = 6;
+
+CnfBuilder init_builder() {
+  CnfBuilder builder;
+  builder.formula          = init_formula(0);
+  builder.has_empty_clause = false;
+  builder.name_capacity    = 64;
+  builder.names            = CAllocator::construct<char *>(builder.name_capacity);
+  builder.marks            = CAllocator::construct<i8>(builder.name_capacity);
+  builder.clause_capacity  = 64;
+  builder.clause           = CAllocator::construct<i32>(builder.clause_capacity);
+  memset(builder.names, 0, usize(builder.name_capacity) * sizeof(char *));
+  memset(builder.marks, 0, usize(builder.name_capacity));
+  return builder;
+}
+
+void destroy_builder(CnfBuilder *builder) {
+  for (i32 i = 0; i <= builder->formula.variable_count; ++i) {
+    CAllocator::destruct(builder->names[i]);
+  }
+  CAllocator::destruct(builder->names);
+  CAllocator::destruct(builder->marks);
+  CAllocator::destruct(builder->clause);
+  destroy_formula(&builder->formula);
+}
+
+// Grows the variable count and the arrays indexed by variable id
+void reserve_variables(CnfBuilder *builder, i32 variable_count) {
+  if (variable_count > max_variable_count) panic("Formula cannot have more than %d variables\n", max_variable_count);
+  if (variable_count > builder->formula.variable_count) builder->formula.variable_count = variable_count;
+  if (variable_count < builder->name_capacity) return;
+
+  i32 capacity = builder->name_capacity;
+  while (capacity <= variable_count) capacity *= 2;
+
+  auto *names = CAllocator::construct<char *>(capacity);
+  auto *marks = CAllocator::construct<i8>(capacity);
+  memset(names, 0, usize(capacity) * sizeof(char *));
+  memset(marks, 0, usize(capacity));
+  memcpy(names, builder->names, usize(builder->name_capacity) * sizeof(char *));
+  CAllocator::destruct(builder->names);
+  CAllocator::destruct(builder->marks);
+  builder->names         = names;
+  builder->marks         = marks;
+  builder->name_capacity = capacity;
+}
+
+Literal new_variable(CnfBuilder *builder, cstr name) {
+  i32 variable_id = builder->formula.variable_count + 1;
+  reserve_variables(builder, variable_id);
+
+  if (name) {
+    usize length                = strlen(name) + 1;
+    builder->names[variable_id] = CAllocator::construct<char>(size(length));
+    memcpy(builder->names[variable_id], name, length);
+  }
+  return {variable_id};
+}
+
+cstr variable_name(CnfBuilder *builder, i32 variable_id) {
+  assert(variable_id > 0 && variable_id <= builder->formula.variable_count);
+  return builder->names[variable_id];
+}
+
+void add_clause(CnfBuilder *builder, Literal *literals, i32 size) {
+  if (size > builder->clause_capacity) {
+    CAllocator::destruct(builder->clause);
+    builder->clause_capacity = size;
+    builder->clause          = CAllocator::construct<i32>(size);
+  }
+  for (i32 i = 0; i < size; ++i) {
+    assert(literals[i].value != 0);
+    reserve_variables(builder, literal_variable_id(literals[i]));
+    builder->clause[i] = literals[i].value;
+  }
+
+  i32 clause_size = normalize_clause(builder->clause, size, builder->marks);
+  if (clause_size < 0) return;
+  if (clause_size == 0) {
+    builder->has_empty_clause = true;
+    return;
+  }
+  push_clause(&builder->formula, builder->clause, clause_size);
+}
+
+void add_unit(CnfBuilder *builder, Literal literal) { add_clause(builder, &literal, 1); }
+
+void add_binary(CnfBuilder *builder, Literal first, Literal second) {
+  Literal clause[2] = {first, second};
+  add_clause(builder, clause, 2);
+}
+
+void add_implication(CnfBuilder *builder, Literal premise, Literal conclusion) {
+  add_binary(builder, ~premise, conclusion);
+}
+
+void add_equivalence(CnfBuilder *builder, Literal first, Literal second) {
+  add_implication(builder, first, second);
+  add_implication(builder, second, first);
+}
+
+void add_at_most_one(CnfBuilder *builder, Literal *literals, i32 size) {
+  if (size <= max_pairwise_at_most_one) {
+    for (i32 i = 0; i < size; ++i) {
+      for (i32 k = i + 1; k < size; ++k) {
+        add_binary(builder, ~literals[i], ~literals[k]);
+      }
+    }
+    return;
+  }
+
+  // Sequential counter: the auxiliary variable of position i is true once one of the first i + 1 literals is true
+  Literal previous = new_variable(builder, nullptr);
+  add_implication(builder, literals[0], previous);
+  for (i32 i = 1; i < size - 1; ++i) {
+    Literal counter = new_variable(builder, nullptr);
+    add_implication(builder, literals[i], counter);
+    add_implication(builder, previous, counter);
+    add_binary(builder, ~literals[i], ~previous);
+    previous = counter;
+  }
+  add_binary(builder, ~literals[size - 1], ~previous);
+}
+
+void add_exactly_one(CnfBuilder *builder, Literal *literals, i32 size) {
+  add_clause(builder, literals, size);
+  add_at_most_one(builder, literals, size);
+}
+
+Result build_problem(CnfBuilder *builder, Problem *problem, SplittingHeuristic splitting_heuristic) {
+  if (builder->has_empty_clause) {
+    error("Formula contains an empty clause\n");
+    return err;
+  }
+  return load_problem(problem, &builder->formula, splitting_heuristic);
+}
+
+} // namespace sat
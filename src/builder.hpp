@@ -0,0 +1,74 @@
+#ifndef BUILDER_HPP
+#define BUILDER_HPP
+
+#include "formula.hpp"
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+// Literal of the builder in the DIMACS convention (negative when negated), wrapped so that it cannot be mixed up with
+// variable ids, sizes or indices
+struct Literal {
+  i32 value;
+};
+
+inline Literal operator~(Literal literal) { return {-literal.value}; }
+
+inline i32 literal_variable_id(Literal literal) { return literal.value < 0 ? -literal.value : literal.value; }
+
+// True if the literal holds in an assignment of the problem, e.g. the assigned_values of a solved problem
+inline bool literal_value(u64 *values, Literal literal) {
+  i32 variable_id = literal_variable_id(literal);
+  return bool(values[variable_id >> 6] & get_word_mask(variable_id)) == (literal.value > 0);
+}
+
+// Builds a formula in memory which is loaded straight into a problem, without writing and parsing DIMACS. The variable
+// count grows with the variables that are used
+struct CnfBuilder {
+  Formula formula;
+  bool has_empty_clause;
+
+  // Names for decoding models indexed by variable id, nullptr for unnamed and auxiliary variables
+  char **names;
+  i32 name_capacity;
+
+  // Sign of every variable in the clause being added, 0 when absent
+  i8 *marks;
+  i32 *clause;
+  i32 clause_capacity;
+};
+
+CnfBuilder init_builder();
+
+void destroy_builder(CnfBuilder *builder);
+
+// Returns the positive literal of a new variable. The name is copied and may be nullptr
+Literal new_variable(CnfBuilder *builder, cstr name);
+
+cstr variable_name(CnfBuilder *builder, i32 variable_id);
+
+// Duplicate literals are merged and tautologies are dropped. An empty clause makes the formula unsatisfiable
+void add_clause(CnfBuilder *builder, Literal *literals, i32 size);
+
+void add_unit(CnfBuilder *builder, Literal literal);
+
+void add_binary(CnfBuilder *builder, Literal first, Literal second);
+
+// premise -> conclusion
+void add_implication(CnfBuilder *builder, Literal premise, Literal conclusion);
+
+void add_equivalence(CnfBuilder *builder, Literal first, Literal second);
+
+// Pairwise clauses for small sets and the sequential counter encoding with size - 1 auxiliary variables otherwise
+void add_at_most_one(CnfBuilder *builder, Literal *literals, i32 size);
+
+void add_exactly_one(CnfBuilder *builder, Literal *literals, i32 size);
+
+// Loads the formula into a problem ready for dpll_solve. Returns err if there are no clauses or the formula contains an
+// empty clause
+Result build_problem(CnfBuilder *builder, Problem *problem, SplittingHeuristic splitting_heuristic);
+
+} // namespace sat
+
+#endif
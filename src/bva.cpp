@@ -0,0 +1,386 @@
+#include "bva.hpp"
+
+#include "cardinality.hpp"
+#include "heap.hpp"
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+// Visits of clauses and literals, no replacements are searched for once the limit is reached
+const i64 bva_work_limit = 20000000;
+
+struct BvaState {
+  i32 variable_count;
+  i32 variable_capacity; // Original variables and the auxiliary variables which may be added
+
+  // Clauses over make_literal literals in one buffer, deleted clauses stay in place
+  i32 clause_count;
+  i32 clause_capacity;
+  size *clause_starts;
+  i32 *clause_sizes;
+  bool *deleted;
+  i32 *clause_stamps;
+
+  size literal_count;
+  size literal_capacity;
+  i32 *literals;
+
+  // Clauses of every literal with the deleted ones skipped lazily and the number of clauses which are not deleted
+  WatchList *occurrences;
+  i32 *occurrence_counts;
+
+  // Literals are replaced in order of decreasing occurrences, the scores of the heap are the occurrence counts
+  VariableHeap queue;
+
+  i32 *literal_stamps;
+  i32 *match_counts;
+  i32 stamp;
+  i64 work;
+};
+
+inline i32 bva_literal(i32 literal) { return make_literal(abs(literal), literal < 0); }
+
+inline i32 dimacs_literal(i32 literal) {
+  return literal_is_negated(literal) ? -literal_variable(literal) : literal_variable(literal);
+}
+
+// Keeps the heap in order when the occurrences of the literal change
+void change_occurrences(BvaState *state, i32 literal, i32 delta) {
+  state->occurrence_counts[literal] += delta;
+  state->queue.score[literal] = state->occurrence_counts[literal];
+  heap_update(&state->queue, literal);
+}
+
+void add_bva_clause(BvaState *state, i32 *literals, i32 clause_size) {
+  if (state->clause_count == state->clause_capacity) {
+    i32 capacity        = state->clause_capacity * 2;
+    auto *clause_starts = CAllocator::construct<size>(capacity);
+    auto *clause_sizes  = CAllocator::construct<i32>(capacity);
+    auto *deleted       = CAllocator::construct<bool>(capacity);
+    auto *clause_stamps = CAllocator::construct<i32>(capacity);
+    memcpy(clause_starts, state->clause_starts, usize(state->clause_count) * sizeof(size));
+    memcpy(clause_sizes, state->clause_sizes, usize(state->clause_count) * sizeof(i32));
+    memcpy(deleted, state->deleted, usize(state->clause_count) * sizeof(bool));
+    memcpy(clause_stamps, state->clause_stamps, usize(state->clause_count) * sizeof(i32));
+    CAllocator::destruct(state->clause_starts);
+    CAllocator::destruct(state->clause_sizes);
+    CAllocator::destruct(state->deleted);
+    CAllocator::destruct(state->clause_stamps);
+    state->clause_starts   = clause_starts;
+    state->clause_sizes    = clause_sizes;
+    state->deleted         = deleted;
+    state->clause_stamps   = clause_stamps;
+    state->clause_capacity = capacity;
+  }
+
+  if (state->literal_count + clause_size > state->literal_capacity) {
+    size capacity = state->literal_capacity * 2 + clause_size;
+    i32 *buffer   = CAllocator::construct<i32>(capacity);
+    memcpy(buffer, state->literals, usize(state->literal_count) * sizeof(i32));
+    CAllocator::destruct(state->literals);
+    state->literals         = buffer;
+    state->literal_capacity = capacity;
+  }
+
+  i32 clause_id                   = state->clause_count++;
+  state->clause_starts[clause_id] = state->literal_count;
+  state->clause_sizes[clause_id]  = clause_size;
+  state->deleted[clause_id]       = false;
+  state->clause_stamps[clause_id] = 0;
+  memcpy(state->literals + state->literal_count, literals, usize(clause_size) * sizeof(i32));
+  state->literal_count += clause_size;
+  for (i32 i = 0; i < clause_size; ++i) {
+    push_watch(&state->occurrences[literals[i]], clause_id);
+    change_occurrences(state, literals[i], 1);
+  }
+}
+
+void delete_bva_clause(BvaState *state, i32 clause_id) {
+  state->deleted[clause_id] = true;
+  i32 *literals             = state->literals + state->clause_starts[clause_id];
+  for (i32 i = 0; i < state->clause_sizes[clause_id]; ++i) {
+    change_occurrences(state, literals[i], -1);
+  }
+}
+
+// There are at most as many auxiliary variables as original ones
+BvaState init_bva_state(Formula *formula) {
+  i32 extra_count = formula->variable_count < max_variable_count - formula->variable_count
+                        ? formula->variable_count
+                        : max_variable_count - formula->variable_count;
+
+  BvaState state;
+  state.variable_count    = formula->variable_count;
+  state.variable_capacity = formula->variable_count + extra_count;
+  state.clause_count      = 0;
+  state.clause_capacity   = formula->clause_count > 0 ? formula->clause_count : 1;
+  state.clause_starts     = CAllocator::construct<size>(state.clause_capacity);
+  state.clause_sizes      = CAllocator::construct<i32>(state.clause_capacity);
+  state.deleted           = CAllocator::construct<bool>(state.clause_capacity);
+  state.clause_stamps     = CAllocator::construct<i32>(state.clause_capacity);
+  state.literal_count     = 0;
+  state.literal_capacity  = formula->literal_count > 0 ? formula->literal_count : 1;
+  state.literals          = CAllocator::construct<i32>(state.literal_capacity);
+  state.stamp             = 0;
+  state.work              = 0;
+
+  i32 literal_capacity    = 2 * (state.variable_capacity + 1);
+  state.occurrences       = CAllocator::construct<WatchList>(literal_capacity);
+  state.occurrence_counts = CAllocator::construct<i32>(literal_capacity);
+  state.literal_stamps    = CAllocator::construct<i32>(literal_capacity);
+  state.match_counts      = CAllocator::construct<i32>(literal_capacity);
+  memset(state.occurrences, 0, usize(literal_capacity) * sizeof(WatchList));
+  memset(state.occurrence_counts, 0, usize(literal_capacity) * sizeof(i32));
+  memset(state.literal_stamps, 0, usize(literal_capacity) * sizeof(i32));
+  memset(state.match_counts, 0, usize(literal_capacity) * sizeof(i32));
+  state.queue = init_heap(literal_capacity);
+
+  // Repeated literals are dropped so that clauses of the same size can be compared by their literal sets
+  i32 *clause     = CAllocator::construct<i32>(2 * formula->variable_count);
+  i32 clause_size = 0;
+  ++state.stamp;
+  for (size i = 0; i < formula->literal_count; ++i) {
+    i32 literal = formula->literals[i];
+    if (!literal) {
+      add_bva_clause(&state, clause, clause_size);
+      clause_size = 0;
+      ++state.stamp;
+      continue;
+    }
+    literal = bva_literal(literal);
+    if (state.literal_stamps[literal] == state.stamp) continue;
+    state.literal_stamps[literal] = state.stamp;
+    clause[clause_size++]         = literal;
+  }
+  CAllocator::destruct(clause);
+
+  heap_build(&state.queue, 2 * (formula->variable_count + 1));
+  return state;
+}
+
+void destroy_bva_state(BvaState *state) {
+  for (i32 i = 0; i < 2 * (state->variable_capacity + 1); ++i) {
+    CAllocator::destruct(state->occurrences[i].data);
+  }
+  CAllocator::destruct(state->occurrences);
+  CAllocator::destruct(state->occurrence_counts);
+  CAllocator::destruct(state->literal_stamps);
+  CAllocator::destruct(state->match_counts);
+  destroy_heap(&state->queue);
+  CAllocator::destruct(state->clause_starts);
+  CAllocator::destruct(state->clause_sizes);
+  CAllocator::destruct(state->deleted);
+  CAllocator::destruct(state->clause_stamps);
+  CAllocator::destruct(state->literals);
+}
+
+// Product found for a literal: row r holds the clauses (matched[j] v R_r) for every matched literal j
+struct BvaProduct {
+  i32 *matched;
+  i32 matched_count;
+  i32 *rows;
+  i32 row_count;
+
+  // Scratch space of the next rows, of the (literal, row, clause) matches of a round and of a clause
+  i32 *next_rows;
+  i32 *remainder;
+  WatchList matches;
+  WatchList touched;
+};
+
+// Returns the literal which replaces the first matched literal in the clause when the rest of the clauses are equal,
+// or -1. The literals of the row clause are stamped with the current stamp
+i32 find_swapped_literal(BvaState *state, BvaProduct *product, i32 clause_id) {
+  i32 first   = product->matched[0];
+  i32 *clause = state->literals + state->clause_starts[clause_id];
+  i32 swapped = -1;
+  state->work += state->clause_sizes[clause_id];
+  for (i32 i = 0; i < state->clause_sizes[clause_id]; ++i) {
+    i32 literal = clause[i];
+    if (literal == first) return -1;
+    if (state->literal_stamps[literal] == state->stamp) continue;
+    if (swapped >= 0) return -1;
+    swapped = literal;
+  }
+  if (swapped < 0 || swapped == (first ^ 1)) return -1;
+  for (i32 j = 1; j < product->matched_count; ++j) {
+    if (product->matched[j] == swapped) return -1;
+  }
+  return swapped;
+}
+
+// Grows the product of the literal one matched literal at a time as long as the number of removed clauses grows
+void find_product(BvaState *state, BvaProduct *product, i32 literal) {
+  product->matched[0]    = literal;
+  product->matched_count = 1;
+  product->row_count     = 0;
+  WatchList *occurrences = &state->occurrences[literal];
+  for (i32 i = 0; i < occurrences->size; ++i) {
+    i32 clause_id = occurrences->data[i];
+    if (state->deleted[clause_id] || state->clause_sizes[clause_id] < 2) continue;
+    product->rows[product->row_count++] = clause_id;
+  }
+
+  for (;;) {
+    i32 stride            = product->matched_count;
+    product->matches.size = 0;
+    product->touched.size = 0;
+    for (i32 r = 0; r < product->row_count && state->work < bva_work_limit; ++r) {
+      i32 clause_id = product->rows[r * stride];
+      i32 *clause   = state->literals + state->clause_starts[clause_id];
+      i32 size      = state->clause_sizes[clause_id];
+
+      // Clauses which differ from this one only in the literal all contain its rarest other literal
+      ++state->stamp;
+      i32 rarest = -1;
+      for (i32 i = 0; i < size; ++i) {
+        state->literal_stamps[clause[i]] = state->stamp;
+        if (clause[i] == literal) continue;
+        if (rarest < 0 || state->occurrence_counts[clause[i]] < state->occurrence_counts[rarest]) rarest = clause[i];
+      }
+
+      WatchList *candidates = &state->occurrences[rarest];
+      state->work += candidates->size;
+      for (i32 i = 0; i < candidates->size; ++i) {
+        i32 other_id = candidates->data[i];
+        if (other_id == clause_id || state->deleted[other_id] || state->clause_sizes[other_id] != size) continue;
+
+        i32 swapped = find_swapped_literal(state, product, other_id);
+        if (swapped < 0) continue;
+        if (!state->match_counts[swapped]++) push_watch(&product->touched, swapped);
+        push_watch(&product->matches, swapped);
+        push_watch(&product->matches, r);
+        push_watch(&product->matches, other_id);
+      }
+    }
+
+    i32 best = -1;
+    for (i32 i = 0; i < product->touched.size; ++i) {
+      i32 swapped = product->touched.data[i];
+      if (best < 0 || state->match_counts[swapped] > state->match_counts[best]) best = swapped;
+    }
+    i32 best_count = best >= 0 ? state->match_counts[best] : 0;
+    for (i32 i = 0; i < product->touched.size; ++i) {
+      state->match_counts[product->touched.data[i]] = 0;
+    }
+
+    // A round which was cut short by the limit only saw part of the matches
+    i32 reduction      = stride * product->row_count - stride - product->row_count;
+    i32 next_reduction = (stride + 1) * best_count - (stride + 1) - best_count;
+    if (best < 0 || next_reduction <= reduction || state->work >= bva_work_limit) return;
+
+    // Duplicate clauses can match the same clause twice, every clause is used once
+    ++state->stamp;
+    i32 next_row_count = 0;
+    for (i32 i = 0; i < product->matches.size; i += 3) {
+      if (product->matches.data[i] != best) continue;
+      i32 *row     = product->rows + product->matches.data[i + 1] * stride;
+      i32 other_id = product->matches.data[i + 2];
+      if (state->clause_stamps[row[0]] == state->stamp || state->clause_stamps[other_id] == state->stamp) continue;
+      state->clause_stamps[row[0]]   = state->stamp;
+      state->clause_stamps[other_id] = state->stamp;
+
+      i32 *next_row = product->next_rows + next_row_count * (stride + 1);
+      memcpy(next_row, row, usize(stride) * sizeof(i32));
+      next_row[stride] = other_id;
+      ++next_row_count;
+    }
+
+    i32 *rows                                  = product->rows;
+    product->rows                              = product->next_rows;
+    product->next_rows                         = rows;
+    product->row_count                         = next_row_count;
+    product->matched[product->matched_count++] = best;
+  }
+}
+
+// Replaces the clauses of the product by the clauses of a fresh variable and queues the literals again
+void replace_product(BvaState *state, BvaProduct *product, BvaStats *stats) {
+  i32 variable_id = ++state->variable_count;
+  i32 positive    = make_literal(variable_id, false);
+  i32 negative    = make_literal(variable_id, true);
+  i32 stride      = product->matched_count;
+  i32 first       = product->matched[0];
+  i32 *remainder  = product->remainder;
+
+  for (i32 r = 0; r < product->row_count; ++r) {
+    i32 *row    = product->rows + r * stride;
+    i32 *clause = state->literals + state->clause_starts[row[0]];
+    i32 size    = 0;
+    for (i32 i = 0; i < state->clause_sizes[row[0]]; ++i) {
+      if (clause[i] != first) remainder[size++] = clause[i];
+    }
+    remainder[size++] = positive;
+
+    for (i32 j = 0; j < stride; ++j) {
+      delete_bva_clause(state, row[j]);
+    }
+    add_bva_clause(state, remainder, size);
+  }
+  for (i32 j = 0; j < stride; ++j) {
+    i32 binary[2] = {product->matched[j], negative};
+    add_bva_clause(state, binary, 2);
+  }
+
+  ++stats->replacement_count;
+  ++stats->variable_count;
+  stats->removed_clause_count += stride * product->row_count - stride - product->row_count;
+
+  for (i32 j = 0; j < stride; ++j) {
+    if (!heap_contains(&state->queue, product->matched[j])) heap_insert(&state->queue, product->matched[j]);
+  }
+  heap_insert(&state->queue, positive);
+  heap_insert(&state->queue, negative);
+}
+
+BvaStats add_bounded_variables(Formula *formula) {
+  BvaStats stats = {0, 0, 0};
+  if (formula->variable_count <= 0 || formula->clause_count <= 0) return stats;
+
+  BvaState state = init_bva_state(formula);
+
+  // Every clause is in at most one row and there are never more clauses than in the input. A clause has at most one
+  // literal per literal of the formula
+  i32 literal_capacity = 2 * (state.variable_capacity + 1);
+  BvaProduct product;
+  product.matched   = CAllocator::construct<i32>(literal_capacity);
+  product.rows      = CAllocator::construct<i32>(formula->clause_count);
+  product.next_rows = CAllocator::construct<i32>(formula->clause_count);
+  product.remainder = CAllocator::construct<i32>(literal_capacity);
+  product.matches   = {nullptr, 0, 0};
+  product.touched   = {nullptr, 0, 0};
+
+  while (state.queue.size > 0 && state.work < bva_work_limit && state.variable_count < state.variable_capacity) {
+    i32 literal = heap_pop(&state.queue);
+    if (state.occurrence_counts[literal] < 2) continue;
+
+    find_product(&state, &product, literal);
+    if (product.matched_count * product.row_count > product.matched_count + product.row_count) {
+      replace_product(&state, &product, &stats);
+    }
+  }
+
+  Formula result = init_formula(state.variable_count);
+  for (i32 i = 0; i < state.clause_count; ++i) {
+    if (state.deleted[i]) continue;
+    i32 *clause = state.literals + state.clause_starts[i];
+    for (i32 k = 0; k < state.clause_sizes[i]; ++k) {
+      push_literal(&result, dimacs_literal(clause[k]));
+    }
+    push_literal(&result, 0);
+  }
+  destroy_formula(formula);
+  *formula = result;
+
+  CAllocator::destruct(product.matched);
+  CAllocator::destruct(product.rows);
+  CAllocator::destruct(product.next_rows);
+  CAllocator::destruct(product.remainder);
+  CAllocator::destruct(product.matches.data);
+  CAllocator::destruct(product.touched.data);
+  destroy_bva_state(&state);
+  return stats;
+}
+
+} // namespace sat
@@ -0,0 +1,24 @@
+#ifndef BVA_HPP
+#define BVA_HPP
+
+#include "formula.hpp"
+#include "general.hpp"
+
+namespace sat {
+
+struct BvaStats {
+  i32 replacement_count;
+  i32 variable_count; // Auxiliary variables, one per replacement
+  i32 removed_clause_count;
+};
+
+// Bounded variable addition: finds sets of clauses which are the product of a set of literals and a set of clause
+// remainders, (l1 v R1), (l1 v R2), ..., (lm v Rk), and replaces the m * k clauses by (x v R1), ..., (x v Rk) and
+// (-x v l1), ..., (-x v lm) with a fresh variable x. A replacement is only made when it removes clauses (m * k > m + k)
+// and resolving x away gives back the original clauses, so every model of the result is a model of the input on the
+// original variables. Auxiliary variables are numbered after the original ones
+BvaStats add_bounded_variables(Formula *formula);
+
+} // namespace sat
+
+#endif
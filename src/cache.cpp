@@ -0,0 +1,135 @@
+#include "cache.hpp"
+
+#include "mem.hpp"
+#include "os.hpp"
+#include "solver.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sat {
+
+const char cache_magic[4] = {'S', 'A', 'T', 'C'};
+
+// Every entry of the log is this header followed by the model words of SAT results
+struct CacheEntry {
+  CnfHash hash;
+  i32 variable_count;
+  i32 satisfiable;
+};
+
+inline i32 model_word_count(i32 variable_count) { return ((variable_count - 1) >> 6) + 1; }
+
+CnfHash init_cnf_hash() { return {0, 0}; }
+
+ClauseHash init_clause_hash() { return {0, 0, 0}; }
+
+void finish_clause(CnfHash *hash, ClauseHash *clause) {
+  hash->low += mix_hash(clause->low ^ u64(clause->length));
+  hash->high += mix_hash(clause->high + (u64(clause->length) << 32));
+  *clause = init_clause_hash();
+}
+
+CnfHash hash_formula(Formula *formula) {
+  CnfHash hash      = init_cnf_hash();
+  ClauseHash clause = init_clause_hash();
+  for (size i = 0; i < formula->literal_count; ++i) {
+    if (formula->literals[i]) {
+      hash_literal(&clause, formula->literals[i]);
+    } else {
+      finish_clause(&hash, &clause);
+    }
+  }
+  return hash;
+}
+
+CachedResult lookup_result(cstr path, CnfHash hash, i32 variable_count, u64 *values) {
+  File file = read_file(path);
+  if (!file.data) return CACHE_MISS;
+
+  CachedResult result = CACHE_MISS;
+  usize length        = usize(file.length);
+  usize offset        = sizeof(cache_magic);
+  if (length < offset || memcmp(file.data, cache_magic, sizeof(cache_magic))) {
+    error("Ignoring invalid result cache %s\n", path);
+    CAllocator::destruct(file.data);
+    return CACHE_MISS;
+  }
+
+  // A partially written entry at the end of the log is ignored
+  while (offset + sizeof(CacheEntry) <= length) {
+    CacheEntry entry;
+    memcpy(&entry, file.data + offset, sizeof(entry));
+    offset += sizeof(entry);
+    if (entry.variable_count <= 0 || entry.variable_count > max_variable_count + 1) break;
+
+    usize model_bytes = entry.satisfiable ? usize(model_word_count(entry.variable_count)) * sizeof(u64) : 0;
+    if (offset + model_bytes > length) break;
+
+    if (entry.hash.low == hash.low && entry.hash.high == hash.high && entry.variable_count == variable_count) {
+      result = entry.satisfiable ? CACHE_SAT : CACHE_UNSAT;
+      if (entry.satisfiable) memcpy(values, file.data + offset, model_bytes);
+    }
+    offset += model_bytes;
+  }
+
+  CAllocator::destruct(file.data);
+  return result;
+}
+
+// Writes all of the buffer, write may return after a part of it
+bool write_all(i32 fd, char *data, usize length) {
+  while (length > 0) {
+    ssize_t written = write(fd, data, length);
+    if (written <= 0) return false;
+    data += written;
+    length -= usize(written);
+  }
+  return true;
+}
+
+Result store_result(cstr path, CnfHash hash, i32 variable_count, bool satisfiable, u64 *values) {
+  i32 fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) return err;
+
+  // The log stays locked from the check for an empty file until the entry is written, so that concurrent runs neither
+  // both write the magic nor interleave their entries
+  struct stat status;
+  if (flock(fd, LOCK_EX) || fstat(fd, &status)) {
+    close(fd);
+    return err;
+  }
+
+  i32 word_count   = satisfiable ? model_word_count(variable_count) : 0;
+  usize length     = sizeof(cache_magic) + sizeof(CacheEntry) + usize(word_count) * sizeof(u64);
+  char *buffer     = CAllocator::construct<char>(size(length));
+  CacheEntry entry = {hash, variable_count, satisfiable};
+
+  char *out = buffer;
+  if (status.st_size == 0) {
+    memcpy(out, cache_magic, sizeof(cache_magic));
+    out += sizeof(cache_magic);
+  }
+  memcpy(out, &entry, sizeof(entry));
+  out += sizeof(entry);
+  if (word_count) {
+    memcpy(out, values, usize(word_count - 1) * sizeof(u64));
+    out += usize(word_count - 1) * sizeof(u64);
+
+    // Variables past the model (e.g. auxiliary ones) are cleared so that equal models give equal entries
+    u64 last = values[word_count - 1];
+    if (variable_count & 63) last &= get_word_mask(variable_count) - 1;
+    memcpy(out, &last, sizeof(last));
+    out += sizeof(last);
+  }
+
+  // Closing the file releases the lock
+  bool written = write_all(fd, buffer, usize(out - buffer));
+  written      = !close(fd) && written;
+  CAllocator::destruct(buffer);
+  return written ? ok : err;
+}
+
+} // namespace sat
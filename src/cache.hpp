@@ -0,0 +1,61 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include "formula.hpp"
+#include "general.hpp"
+
+namespace sat {
+
+// 128-bit hash of a CNF which does not depend on the order of the clauses or of the literals within a clause. Clauses
+// are hashed on their own and summed, so it is built while parsing without keeping the clauses around
+struct CnfHash {
+  u64 low;
+  u64 high;
+};
+
+// Sums of the literal hashes of the clause which is being parsed
+struct ClauseHash {
+  u64 low;
+  u64 high;
+  i32 length;
+};
+
+inline u64 mix_hash(u64 x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+  return x ^ (x >> 31);
+}
+
+CnfHash init_cnf_hash();
+
+ClauseHash init_clause_hash();
+
+// Signed DIMACS literal. Called by the parser for every literal so it only takes two multiplications
+inline void hash_literal(ClauseHash *clause, i32 literal) {
+  u64 x = u64(u32(literal)) * 0x9E3779B97F4A7C15;
+  clause->low += x ^ (x >> 29);
+  clause->high += (x ^ (x >> 32)) * 0xD6E8FEB86659FD93;
+  ++clause->length;
+}
+
+// Adds the clause to the formula hash and resets it for the next one
+void finish_clause(CnfHash *hash, ClauseHash *clause);
+
+CnfHash hash_formula(Formula *formula);
+
+enum CachedResult {
+  CACHE_MISS,
+  CACHE_SAT,
+  CACHE_UNSAT,
+};
+
+// Looks up the formula in the append-only result log at path, the latest entry wins. The model of a SAT entry is
+// written to values which has room for variable_count variables including x0
+CachedResult lookup_result(cstr path, CnfHash hash, i32 variable_count, u64 *values);
+
+// Appends the result with the model over variable_count variables (nullptr for UNSAT) to the log at path
+Result store_result(cstr path, CnfHash hash, i32 variable_count, bool satisfiable, u64 *values);
+
+} // namespace sat
+
+#endif
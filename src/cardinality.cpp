@@ -0,0 +1,295 @@
+#include "cardinality.hpp"
+
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+void push_watch(WatchList *list, i32 constraint_id) {
+  if (list->size == list->capacity) {
+    i32 capacity = list->capacity ? list->capacity * 2 : 4;
+    i32 *data    = CAllocator::construct<i32>(capacity);
+    if (list->size) memcpy(data, list->data, usize(list->size) * sizeof(i32));
+    CAllocator::destruct(list->data);
+    list->data     = data;
+    list->capacity = capacity;
+  }
+  list->data[list->size++] = constraint_id;
+}
+
+i32 watched_count(CardinalityConstraint *constraint) {
+  return constraint->bound + 1 < constraint->size ? constraint->bound + 1 : constraint->size;
+}
+
+bool literal_is_false(Problem *problem, i32 literal) {
+  i32 variable_id = literal_variable(literal);
+  if (problem->unassigned[variable_id >> 6] & get_word_mask(variable_id)) return false;
+  return bool(problem->assigned_values[variable_id >> 6] & get_word_mask(variable_id)) == literal_is_negated(literal);
+}
+
+Result add_at_least(Problem *problem, i32 *literals, i32 size, i32 bound) {
+  if (bound <= 0) return ok;
+  if (bound > size) return err;
+
+  if (!problem->cardinality_watches) {
+    problem->cardinality_watches = CAllocator::construct<WatchList>(2 * problem->variable_count);
+    memset(problem->cardinality_watches, 0, usize(2 * problem->variable_count) * sizeof(WatchList));
+  }
+
+  if (problem->cardinality_count == problem->cardinality_capacity) {
+    i32 capacity        = problem->cardinality_capacity ? problem->cardinality_capacity * 2 : 16;
+    auto *cardinalities = CAllocator::construct<CardinalityConstraint>(capacity);
+    if (problem->cardinality_count) {
+      memcpy(cardinalities, problem->cardinalities,
+             usize(problem->cardinality_count) * sizeof(CardinalityConstraint));
+    }
+    CAllocator::destruct(problem->cardinalities);
+    problem->cardinalities        = cardinalities;
+    problem->cardinality_capacity = capacity;
+  }
+
+  i32 constraint_id                 = problem->cardinality_count++;
+  CardinalityConstraint *constraint = &problem->cardinalities[constraint_id];
+  constraint->bound                 = bound;
+  constraint->size                  = size;
+  constraint->literals              = CAllocator::construct<i32>(size);
+  memcpy(constraint->literals, literals, usize(size) * sizeof(i32));
+
+  for (i32 i = 0; i < watched_count(constraint); ++i) {
+    push_watch(&problem->cardinality_watches[constraint->literals[i]], constraint_id);
+  }
+
+  // Every literal has to be true. A literal which an earlier unit already made false is still queued, so the conflict
+  // is found when the root level is propagated before the search
+  if (bound == size) {
+    for (i32 i = 0; i < size; ++i) {
+      i32 variable_id = literal_variable(literals[i]);
+      if (problem->unassigned[variable_id >> 6] & get_word_mask(variable_id)) {
+        set_variable(problem, variable_id, !literal_is_negated(literals[i]));
+      }
+    }
+  }
+
+  return ok;
+}
+
+Result add_cardinality(Problem *problem, i32 *literals, i32 size, CardinalityKind kind, i32 bound) {
+  if (kind == AT_LEAST || kind == EXACTLY) {
+    if (add_at_least(problem, literals, size, bound)) return err;
+  }
+
+  if (kind == AT_MOST || kind == EXACTLY) {
+    i32 *negated = CAllocator::construct<i32>(size);
+    for (i32 i = 0; i < size; ++i) {
+      negated[i] = literals[i] ^ 1;
+    }
+    Result result = bound < 0 ? err : add_at_least(problem, negated, size, size - bound);
+    CAllocator::destruct(negated);
+    if (result) return err;
+  }
+
+  return ok;
+}
+
+UnitPropagateResult propagate_cardinalities(Problem *problem, i32 false_literal) {
+  WatchList *list = &problem->cardinality_watches[false_literal];
+
+  i32 kept = 0;
+  for (i32 i = 0; i < list->size; ++i) {
+    i32 constraint_id                 = list->data[i];
+    CardinalityConstraint *constraint = &problem->cardinalities[constraint_id];
+    i32 *literals                     = constraint->literals;
+    i32 watched                       = watched_count(constraint);
+
+    i32 position = 0;
+    while (literals[position] != false_literal) ++position;
+    assert(position < watched);
+
+    // Move the watch to a literal which is not false yet
+    bool moved = false;
+    for (i32 k = watched; k < constraint->size; ++k) {
+      if (literal_is_false(problem, literals[k])) continue;
+
+      literals[position] = literals[k];
+      literals[k]        = false_literal;
+      push_watch(&problem->cardinality_watches[literals[position]], constraint_id);
+      moved = true;
+      break;
+    }
+    if (moved) continue;
+
+    list->data[kept++] = constraint_id;
+
+    // Only the watched literals can still be true
+    i32 non_false = 0;
+    for (i32 k = 0; k < watched; ++k) {
+      if (!literal_is_false(problem, literals[k])) ++non_false;
+    }
+
+    if (non_false < constraint->bound) {
+      debug("  - Conflict from cardinality%d\n", constraint_id);
+      for (++i; i < list->size; ++i) {
+        list->data[kept++] = list->data[i];
+      }
+      list->size = kept;
+      return CONFLICT;
+    }
+
+    if (non_false == constraint->bound) {
+      for (i32 k = 0; k < watched; ++k) {
+        i32 variable_id = literal_variable(literals[k]);
+        if (!(problem->unassigned[variable_id >> 6] & get_word_mask(variable_id))) continue;
+
+        debug("  - From cardinality%d: x%d = %d\n", constraint_id, variable_id, !literal_is_negated(literals[k]));
+        set_variable(problem, variable_id, !literal_is_negated(literals[k]));
+      }
+    }
+  }
+  list->size = kept;
+
+  return NO_CONFLICT;
+}
+
+bool cardinalities_satisfied(Problem *problem, u64 *values) {
+  for (i32 i = 0; i < problem->cardinality_count; ++i) {
+    CardinalityConstraint *constraint = &problem->cardinalities[i];
+
+    i32 true_count = 0;
+    for (i32 k = 0; k < constraint->size; ++k) {
+      i32 variable_id = literal_variable(constraint->literals[k]);
+      bool value      = values[variable_id >> 6] & get_word_mask(variable_id);
+      if (value != literal_is_negated(constraint->literals[k])) ++true_count;
+    }
+    if (true_count < constraint->bound) return false;
+  }
+  return true;
+}
+
+// Edge of the at most one graph: both literals cannot be true at the same time because of the binary clause
+struct AtMostOneEdge {
+  i32 from;
+  i32 to;
+  i32 clause_id;
+};
+
+i32 compare_edges(const void *left, const void *right) {
+  auto *a = (const AtMostOneEdge *)left;
+  auto *b = (const AtMostOneEdge *)right;
+  if (a->from != b->from) return a->from < b->from ? -1 : 1;
+  if (a->to != b->to) return a->to < b->to ? -1 : 1;
+  return 0;
+}
+
+// Returns the index of the edge between the literals or -1
+i32 find_edge(AtMostOneEdge *edges, i32 *offsets, i32 from, i32 to) {
+  i32 low  = offsets[from];
+  i32 high = offsets[from + 1];
+  while (low < high) {
+    i32 middle = (low + high) / 2;
+    if (edges[middle].to == to) return middle;
+    if (edges[middle].to < to) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return -1;
+}
+
+i32 detect_at_most_one(Problem *problem) {
+  i32 word_count    = words_per_clause(problem);
+  i32 literal_count = 2 * problem->variable_count;
+
+  // Every binary clause (x v y) says that at most one of ~x and ~y is true, store it as an edge in both directions
+  i32 edge_count = 0;
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    i32 size = 0;
+    for (i32 k = 0; k < word_count; ++k) {
+      size += __builtin_popcountll(problem->clauses[i64(i) * word_count + k]);
+    }
+    if (size == 2) edge_count += 2;
+  }
+  if (edge_count == 0) return 0;
+
+  auto *edges = CAllocator::construct<AtMostOneEdge>(edge_count);
+  edge_count  = 0;
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    i32 nodes[2];
+    i32 size = 0;
+    for (i32 k = 0; k < word_count && size <= 2; ++k) {
+      u64 clause_word = problem->clauses[i64(i) * word_count + k];
+      while (clause_word && size <= 2) {
+        i32 variable_id = (k << 6) | __builtin_ctzll(clause_word);
+        bool negated    = problem->negations[i64(i) * word_count + k] & get_word_mask(variable_id);
+        if (size < 2) nodes[size] = make_literal(variable_id, !negated);
+        ++size;
+        clause_word &= clause_word - 1;
+      }
+    }
+    if (size != 2) continue;
+
+    edges[edge_count++] = {nodes[0], nodes[1], i};
+    edges[edge_count++] = {nodes[1], nodes[0], i};
+  }
+  qsort(edges, usize(edge_count), sizeof(AtMostOneEdge), compare_edges);
+
+  i32 *offsets = CAllocator::construct<i32>(literal_count + 1);
+  memset(offsets, 0, usize(literal_count + 1) * sizeof(i32));
+  for (i32 i = 0; i < edge_count; ++i) {
+    ++offsets[edges[i].from + 1];
+  }
+  for (i32 i = 0; i < literal_count; ++i) {
+    offsets[i + 1] += offsets[i];
+  }
+
+  u8 *removed = CAllocator::construct<u8>(problem->clause_count);
+  memset(removed, 0, usize(problem->clause_count));
+
+  i32 *clique      = CAllocator::construct<i32>(problem->variable_count);
+  i32 created      = 0;
+  i32 clique_total = 0;
+
+  // Greedily grow a clique from every literal over the neighbours which still have uncovered edges to it
+  for (i32 literal = 0; literal < literal_count; ++literal) {
+    i32 clique_size       = 0;
+    clique[clique_size++] = literal;
+
+    for (i32 i = offsets[literal]; i < offsets[literal + 1]; ++i) {
+      if (removed[edges[i].clause_id]) continue;
+
+      i32 candidate = edges[i].to;
+      bool adjacent = true;
+      for (i32 k = 1; k < clique_size && adjacent; ++k) {
+        adjacent = find_edge(edges, offsets, candidate, clique[k]) >= 0;
+      }
+      if (adjacent) clique[clique_size++] = candidate;
+    }
+
+    // A clique of two is just the binary clause itself
+    if (clique_size < 3) continue;
+
+    for (i32 i = 0; i < clique_size; ++i) {
+      for (i32 k = i + 1; k < clique_size; ++k) {
+        removed[edges[find_edge(edges, offsets, clique[i], clique[k])].clause_id] = 1;
+      }
+    }
+
+    if (add_cardinality(problem, clique, clique_size, AT_MOST, 1)) panic("At most one constraint is unsatisfiable\n");
+    ++created;
+    clique_total += clique_size;
+  }
+
+  i32 clause_count = problem->clause_count;
+  remove_clauses(problem, removed);
+  debug("Detected %d at most one constraints over %d literals replacing %d clauses\n", created, clique_total,
+        clause_count - problem->clause_count);
+
+  CAllocator::destruct(clique);
+  CAllocator::destruct(removed);
+  CAllocator::destruct(offsets);
+  CAllocator::destruct(edges);
+
+  return created;
+}
+
+} // namespace sat
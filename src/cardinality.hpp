@@ -0,0 +1,34 @@
+#ifndef CARDINALITY_HPP
+#define CARDINALITY_HPP
+
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+enum CardinalityKind {
+  AT_MOST,
+  AT_LEAST,
+  EXACTLY,
+};
+
+// Appends the id to the list, which doubles its capacity when it is full
+void push_watch(WatchList *list, i32 constraint_id);
+
+// Adds a constraint over the literals (make_literal encoding). At most k constraints are stored as at least
+// size - k of the negated literals and exactly k constraints as both. Returns err if it can never be satisfied
+Result add_cardinality(Problem *problem, i32 *literals, i32 size, CardinalityKind kind, i32 bound);
+
+// Visits the constraints watching the literal which has just become false
+UnitPropagateResult propagate_cardinalities(Problem *problem, i32 false_literal);
+
+// Checks every cardinality constraint against a complete assignment
+bool cardinalities_satisfied(Problem *problem, u64 *values);
+
+// Replaces cliques of pairwise binary clauses (~a v ~b) by at most one constraints. Returns the number of constraints
+// created. Has to run before the search is prepared
+i32 detect_at_most_one(Problem *problem);
+
+} // namespace sat
+
+#endif
@@ -0,0 +1,270 @@
+#include "checkpoint.hpp"
+
+#include "mem.hpp"
+#include "os.hpp"
+#include <cstring>
+#include <pthread.h>
+#include <unistd.h>
+
+namespace sat {
+
+const char checkpoint_magic[4] = {'S', 'A', 'T', 'K'};
+
+// Decisions are only counted between time checks so that the search does not read the clock at every decision
+const i32 checkpoint_check_interval = 64;
+
+struct Checkpointer {
+  cstr path;
+  char *temporary_path;
+  f64 interval;
+  f64 next_time;
+  i32 check_count;
+  u64 problem_hash;
+
+  // Serialized checkpoint which is owned by the writer thread while writing is set
+  char *buffer;
+  usize buffer_length;
+  usize buffer_capacity;
+
+  pthread_t thread;
+  bool thread_started;
+  bool writing;
+};
+
+// Covers the clause matrix and the initial assignment so that a checkpoint is never resumed on a different formula
+u64 hash_problem(Problem *problem) {
+  i32 word_count = words_per_clause(problem);
+  u64 hash       = 0xCBF29CE484222325;
+  for (size i = 0; i < size(problem->clause_count) * word_count; ++i) {
+    hash = (hash ^ problem->clauses[i]) * 0x100000001B3;
+    hash = (hash ^ problem->negations[i]) * 0x100000001B3;
+  }
+  for (i32 i = 0; i < word_count; ++i) {
+    hash = (hash ^ problem->unassigned[i]) * 0x100000001B3;
+    hash = (hash ^ (problem->assigned_values[i] & ~problem->unassigned[i])) * 0x100000001B3;
+  }
+  return hash ^ (hash >> 29);
+}
+
+Checkpointer *init_checkpointer(Problem *problem, cstr path, f64 interval) {
+  auto *checkpointer         = CAllocator::construct<Checkpointer>();
+  usize path_length          = strlen(path);
+  checkpointer->path         = path;
+  checkpointer->interval     = interval;
+  checkpointer->next_time    = current_time() + interval;
+  checkpointer->check_count  = 0;
+  checkpointer->problem_hash = hash_problem(problem);
+
+  checkpointer->temporary_path = CAllocator::construct<char>(size(path_length) + 5);
+  memcpy(checkpointer->temporary_path, path, path_length);
+  memcpy(checkpointer->temporary_path + path_length, ".tmp", 5);
+
+  checkpointer->buffer          = nullptr;
+  checkpointer->buffer_length   = 0;
+  checkpointer->buffer_capacity = 0;
+  checkpointer->thread_started  = false;
+  checkpointer->writing         = false;
+  return checkpointer;
+}
+
+void wait_for_checkpoint(Checkpointer *checkpointer) {
+  if (!checkpointer->thread_started) return;
+  pthread_join(checkpointer->thread, nullptr);
+  checkpointer->thread_started = false;
+}
+
+void destroy_checkpointer(Checkpointer *checkpointer) {
+  wait_for_checkpoint(checkpointer);
+  CAllocator::destruct(checkpointer->buffer);
+  CAllocator::destruct(checkpointer->temporary_path);
+  CAllocator::destruct(checkpointer);
+}
+
+char *put_bytes(char *out, const void *data, usize length) {
+  memcpy(out, data, length);
+  return out + length;
+}
+
+// Copies the search state into the buffer of the checkpointer
+void serialize_checkpoint(Checkpointer *checkpointer, Problem *problem) {
+  i32 word_count  = words_per_clause(problem);
+  usize set_bytes = usize(word_count) * sizeof(u64);
+  i32 level_count = problem->decision_stack_size;
+  usize length    = sizeof(checkpoint_magic) + sizeof(CheckpointHeader) + (2 + usize(level_count)) * set_bytes +
+                 usize(level_count) * sizeof(i32);
+
+  if (length > checkpointer->buffer_capacity) {
+    CAllocator::destruct(checkpointer->buffer);
+    checkpointer->buffer_capacity = length + length / 2;
+    checkpointer->buffer          = CAllocator::construct<char>(size(checkpointer->buffer_capacity));
+    if (!checkpointer->buffer) panic("Could not allocate %lu bytes for a checkpoint\n", checkpointer->buffer_capacity);
+  }
+
+  CheckpointHeader header;
+  header.variable_count      = problem->variable_count;
+  header.clause_count        = problem->clause_count;
+  header.splitting_heuristic = problem->splitting_heuristic;
+  header.decision_count      = level_count;
+  header.problem_hash        = checkpointer->problem_hash;
+  header.split_count         = problem->split_count;
+  header.conflict_count      = problem->conflict_count;
+  header.propagation_count   = problem->propagation_count;
+  header.elapsed_time        = current_time() - problem->start_time;
+  header.random_state        = problem->random.state;
+
+  char *out = checkpointer->buffer;
+  out       = put_bytes(out, checkpoint_magic, sizeof(checkpoint_magic));
+  out       = put_bytes(out, &header, sizeof(header));
+  out       = put_bytes(out, problem->unassigned, set_bytes);
+  out       = put_bytes(out, problem->assigned_values, set_bytes);
+  for (i32 i = 0; i < level_count; ++i) {
+    out = put_bytes(out, problem->previous_unassigned_stack[i], set_bytes);
+  }
+  out = put_bytes(out, problem->decision_stack, usize(level_count) * sizeof(i32));
+  assert(usize(out - checkpointer->buffer) == length);
+
+  checkpointer->buffer_length = length;
+}
+
+// Writes the buffer to the temporary file and renames it over the checkpoint, so a crash at any point leaves either
+// the old or the new checkpoint behind
+Result write_checkpoint_file(Checkpointer *checkpointer) {
+  FILE *file = fopen(checkpointer->temporary_path, "wb");
+  if (!file) return err;
+
+  bool written = fwrite(checkpointer->buffer, 1, checkpointer->buffer_length, file) == checkpointer->buffer_length;
+  written      = !fflush(file) && !fsync(fileno(file)) && written;
+  written      = !fclose(file) && written;
+  if (!written || rename(checkpointer->temporary_path, checkpointer->path)) return err;
+  return ok;
+}
+
+void *checkpoint_thread(void *data) {
+  auto *checkpointer = (Checkpointer *)data;
+  if (write_checkpoint_file(checkpointer)) error("Could not write checkpoint %s\n", checkpointer->path);
+  __atomic_store_n(&checkpointer->writing, false, __ATOMIC_RELEASE);
+  return nullptr;
+}
+
+void checkpoint_search(Problem *problem) {
+  Checkpointer *checkpointer = problem->checkpointer;
+  if (++checkpointer->check_count < checkpoint_check_interval) return;
+  checkpointer->check_count = 0;
+
+  if (current_time() < checkpointer->next_time) return;
+  if (__atomic_load_n(&checkpointer->writing, __ATOMIC_ACQUIRE)) return;
+
+  wait_for_checkpoint(checkpointer);
+  serialize_checkpoint(checkpointer, problem);
+  debug("Checkpoint at %d decision levels\n", problem->decision_stack_size);
+
+  checkpointer->writing = true;
+  if (pthread_create(&checkpointer->thread, nullptr, checkpoint_thread, checkpointer)) {
+    panic("Failed to create thread\n");
+  }
+  checkpointer->thread_started = true;
+  checkpointer->next_time      = current_time() + checkpointer->interval;
+}
+
+void write_final_checkpoint(Problem *problem) {
+  Checkpointer *checkpointer = problem->checkpointer;
+  wait_for_checkpoint(checkpointer);
+  serialize_checkpoint(checkpointer, problem);
+  if (write_checkpoint_file(checkpointer)) error("Could not write checkpoint %s\n", checkpointer->path);
+}
+
+Result read_checkpoint(Checkpoint *checkpoint, Problem *problem, cstr path) {
+  File file = read_file(path);
+  if (!file.data) {
+    error("Could not read checkpoint %s\n", path);
+    return err;
+  }
+
+  i32 word_count           = words_per_clause(problem);
+  usize set_bytes          = usize(word_count) * sizeof(u64);
+  usize length             = usize(file.length);
+  CheckpointHeader *header = &checkpoint->header;
+  bool valid               = length >= sizeof(checkpoint_magic) + sizeof(CheckpointHeader) &&
+               !memcmp(file.data, checkpoint_magic, sizeof(checkpoint_magic));
+  if (valid) {
+    memcpy(header, file.data + sizeof(checkpoint_magic), sizeof(CheckpointHeader));
+    valid = header->decision_count >= 0 && header->decision_count < problem->variable_count &&
+            length == sizeof(checkpoint_magic) + sizeof(CheckpointHeader) +
+                          (2 + usize(header->decision_count)) * set_bytes +
+                          usize(header->decision_count) * sizeof(i32);
+  }
+  if (!valid) {
+    error("Invalid checkpoint %s\n", path);
+    CAllocator::destruct(file.data);
+    return err;
+  }
+
+  if (header->variable_count != problem->variable_count || header->clause_count != problem->clause_count ||
+      header->splitting_heuristic != problem->splitting_heuristic || header->problem_hash != hash_problem(problem)) {
+    error("Checkpoint %s was written for a different problem or heuristic\n", path);
+    CAllocator::destruct(file.data);
+    return err;
+  }
+
+  i32 level_count              = header->decision_count;
+  checkpoint->unassigned       = CAllocator::construct<u64>(word_count);
+  checkpoint->assigned_values  = CAllocator::construct<u64>(word_count);
+  checkpoint->level_unassigned = CAllocator::construct<u64>(size(level_count + 1) * word_count);
+  checkpoint->decisions        = CAllocator::construct<i32>(level_count + 1);
+
+  char *in = file.data + sizeof(checkpoint_magic) + sizeof(CheckpointHeader);
+  memcpy(checkpoint->unassigned, in, set_bytes);
+  memcpy(checkpoint->assigned_values, in + set_bytes, set_bytes);
+  memcpy(checkpoint->level_unassigned, in + 2 * set_bytes, usize(level_count) * set_bytes);
+  memcpy(checkpoint->decisions, in + (2 + usize(level_count)) * set_bytes, usize(level_count) * sizeof(i32));
+  checkpoint->replay_failed = false;
+  CAllocator::destruct(file.data);
+
+  // Decisions are distinct variables which are unassigned at the root and assigned from their own level on, and every
+  // level only assigns more variables
+  u64 *decided = CAllocator::construct<u64>(word_count);
+  memset(decided, 0, set_bytes);
+  for (i32 level = 0; valid && level < level_count; ++level) {
+    i32 variable_id = decision_get_variable_id(checkpoint->decisions[level]);
+    if (variable_id <= 0 || variable_id >= problem->variable_count) {
+      valid = false;
+      break;
+    }
+
+    i32 word              = variable_id >> 6;
+    u64 mask              = get_word_mask(variable_id);
+    u64 *level_unassigned = checkpoint->level_unassigned + size(level) * word_count;
+    u64 *next_unassigned  = level + 1 < level_count ? level_unassigned + word_count : checkpoint->unassigned;
+
+    valid = !(decided[word] & mask) && (problem->unassigned[word] & mask) && !(level_unassigned[word] & mask);
+    decided[word] |= mask;
+    for (i32 i = 0; valid && i < word_count; ++i) {
+      valid = !(next_unassigned[i] & ~level_unassigned[i]);
+    }
+  }
+
+  // Variables assigned at the root (unit clauses and the implicit x0) stay assigned with the same values
+  u64 *root_unassigned = level_count > 0 ? checkpoint->level_unassigned : checkpoint->unassigned;
+  for (i32 i = 0; valid && i < word_count; ++i) {
+    u64 root_assigned = ~problem->unassigned[i];
+    valid             = !(root_unassigned[i] & root_assigned) &&
+                        !((checkpoint->assigned_values[i] ^ problem->assigned_values[i]) & root_assigned);
+  }
+  CAllocator::destruct(decided);
+
+  if (!valid) {
+    error("Checkpoint %s does not match the search of this problem\n", path);
+    destroy_checkpoint(checkpoint);
+    return err;
+  }
+  return ok;
+}
+
+void destroy_checkpoint(Checkpoint *checkpoint) {
+  CAllocator::destruct(checkpoint->unassigned);
+  CAllocator::destruct(checkpoint->assigned_values);
+  CAllocator::destruct(checkpoint->level_unassigned);
+  CAllocator::destruct(checkpoint->decisions);
+}
+
+} // namespace sat
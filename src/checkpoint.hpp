@@ -0,0 +1,64 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+// Fixed size part of a checkpoint file, directly after the magic
+struct CheckpointHeader {
+  i32 variable_count;
+  i32 clause_count;
+  i32 splitting_heuristic;
+  i32 decision_count;
+  u64 problem_hash;
+
+  i64 split_count;
+  i64 conflict_count;
+  i64 propagation_count;
+  f64 elapsed_time;
+  u64 random_state;
+};
+
+// State of dpll_solve between two decisions. Everything else (watchlists, heuristic counts, clause trails, xor pivots)
+// follows from the formula and is rebuilt by replaying the decisions on resume
+struct Checkpoint {
+  CheckpointHeader header;
+
+  u64 *unassigned;
+  u64 *assigned_values;
+
+  // One unassigned bitset per decision level, taken right after the decision was assigned
+  u64 *level_unassigned;
+
+  // Decisions with their value and tried-both bits
+  i32 *decisions;
+
+  // Set by dpll_solve when the decisions cannot be replayed on the problem, the search is not started then
+  bool replay_failed;
+};
+
+// Writes checkpoints of a running dpll_solve to path every interval seconds. The file is replaced atomically
+Checkpointer *init_checkpointer(Problem *problem, cstr path, f64 interval);
+
+// Waits for a checkpoint which is still being written
+void destroy_checkpointer(Checkpointer *checkpointer);
+
+// Called by the search at every decision. When the interval has passed the state is copied into a buffer which a
+// background thread writes out, so the search only pauses for the copy. A checkpoint is skipped while the previous one
+// is still being written
+void checkpoint_search(Problem *problem);
+
+// Writes a checkpoint of the current state and waits for it, used when the search stops early
+void write_final_checkpoint(Problem *problem);
+
+// Loads a checkpoint which was written for the same problem and splitting heuristic. The decisions have to be distinct
+// variables which are unassigned at the root, and the variables assigned at the root keep their values at every level
+Result read_checkpoint(Checkpoint *checkpoint, Problem *problem, cstr path);
+
+void destroy_checkpoint(Checkpoint *checkpoint);
+
+} // namespace sat
+
+#endif
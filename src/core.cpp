@@ -0,0 +1,426 @@
+#include "core.hpp"
+
+#include "formula.hpp"
+#include "mem.hpp"
+#include "os.hpp"
+#include <cstring>
+
+namespace sat {
+
+// Clause ids are the positions of the clauses in the formula of the whole problem
+struct CoreSearch {
+  Formula formula;
+  size *clause_starts;
+  i32 clause_count;
+  i32 word_count;
+
+  SplittingHeuristic splitting_heuristic;
+  bool double_lookahead;
+  SolveLimits limits;
+  f64 start_time;
+
+  // Smallest unsatisfiable set of clauses so far as flags and as a list, and the clauses known to be necessary in it
+  u8 *active;
+  i32 *active_ids;
+  i32 active_count;
+  u8 *necessary;
+
+  // Clauses of the problem which is solved next, the clause id of each of them and the first unit clause of every
+  // variable among them
+  Formula subset;
+  i32 *subset_ids;
+  i32 *unit_clauses;
+  u8 *used;
+
+  // The variables of the subset are numbered densely, so that the clause words and the decisions only cover the
+  // variables which occur in it. Variables which do not occur map to 0
+  i32 *variable_map;
+  i32 *original_variables;
+
+  // Model of the last satisfiable subset
+  u64 *model;
+
+  CoreStats *stats;
+};
+
+inline i32 *clause_literals(CoreSearch *search, i32 clause_id) {
+  return search->formula.literals + search->clause_starts[clause_id];
+}
+
+inline i32 clause_length(CoreSearch *search, i32 clause_id) {
+  return i32(search->clause_starts[clause_id + 1] - search->clause_starts[clause_id] - 1);
+}
+
+void activate_clause(CoreSearch *search, i32 clause_id) {
+  if (search->active[clause_id]) return;
+  search->active[clause_id] = 1;
+  ++search->active_count;
+}
+
+// Replaces the active clauses with the flagged ones, which are always a subset of them
+void compact_active_ids(CoreSearch *search, i32 previous_count) {
+  i32 count = 0;
+  for (i32 i = 0; i < previous_count; ++i) {
+    i32 clause_id = search->active_ids[i];
+    if (search->active[clause_id]) search->active_ids[count++] = clause_id;
+  }
+  assert(count == search->active_count);
+}
+
+// Collects the active clauses except skipped_clause_id. Unit clauses are assigned while a problem is loaded, so two
+// opposite unit clauses are taken as the core right away and false is returned
+bool collect_subset(CoreSearch *search, i32 skipped_clause_id) {
+  i32 conflict_clauses[2] = {-1, -1};
+
+  // Only the unit clauses and variables of the previous subset have to be cleared
+  Formula *subset = &search->subset;
+  for (i32 i = 0; i < subset->clause_count; ++i) {
+    i32 clause_id = search->subset_ids[i];
+    if (clause_length(search, clause_id) == 1) search->unit_clauses[abs(clause_literals(search, clause_id)[0])] = -1;
+  }
+  for (i32 i = 1; i <= subset->variable_count; ++i) {
+    search->variable_map[search->original_variables[i]] = 0;
+  }
+  subset->variable_count = search->formula.variable_count;
+  subset->clause_count   = 0;
+  subset->literal_count  = 0;
+
+  for (i32 i = 0; i < search->active_count; ++i) {
+    i32 clause_id = search->active_ids[i];
+    if (clause_id == skipped_clause_id) continue;
+
+    i32 *literals = clause_literals(search, clause_id);
+    i32 length    = clause_length(search, clause_id);
+    if (length == 1) {
+      i32 unit_clause = search->unit_clauses[abs(literals[0])];
+      if (unit_clause < 0) {
+        search->unit_clauses[abs(literals[0])] = clause_id;
+      } else if (clause_literals(search, unit_clause)[0] != literals[0]) {
+        conflict_clauses[0] = unit_clause;
+        conflict_clauses[1] = clause_id;
+      }
+    }
+
+    search->subset_ids[subset->clause_count] = clause_id;
+    for (i32 k = 0; k < length; ++k) {
+      search->variable_map[abs(literals[k])] = 1;
+    }
+    push_clause(subset, literals, length);
+  }
+
+  // The numbering keeps the order of the variables so that the heuristics break ties the same way
+  i32 variable_count = 0;
+  for (i32 i = 1; i <= search->formula.variable_count; ++i) {
+    if (!search->variable_map[i]) continue;
+    search->variable_map[i]                    = ++variable_count;
+    search->original_variables[variable_count] = i;
+  }
+  subset->variable_count = variable_count;
+  for (size i = 0; i < subset->literal_count; ++i) {
+    i32 literal         = subset->literals[i];
+    subset->literals[i] = literal < 0 ? -search->variable_map[-literal] : search->variable_map[literal];
+  }
+
+  if (conflict_clauses[0] < 0) return true;
+
+  i32 previous_count = search->active_count;
+  memset(search->active, 0, usize(search->clause_count));
+  search->active_count = 0;
+  activate_clause(search, conflict_clauses[0]);
+  activate_clause(search, conflict_clauses[1]);
+  compact_active_ids(search, previous_count);
+  return false;
+}
+
+// Solves a loaded subset. UNSAT replaces the active clauses with the ones the refutation used, SAT keeps the model.
+// The variables of the problem are renumbered with original_variables, nullptr if they are not
+ProblemResult solve_loaded(CoreSearch *search, Problem *problem, i32 *original_variables) {
+  problem->double_lookahead = search->double_lookahead;
+  problem->limits           = search->limits;
+  if (search->limits.time_limit > 0) {
+    f64 remaining = search->limits.time_limit - (current_time() - search->start_time);
+    if (remaining <= 0) return UNKNOWN;
+    problem->limits.time_limit = remaining;
+  }
+
+  memset(search->used, 0, usize(problem->clause_count));
+  problem->used_clauses = search->used;
+  ++search->stats->solve_count;
+  ProblemResult result  = dpll_solve(problem);
+  problem->used_clauses = nullptr;
+
+  if (result == SAT && original_variables) {
+    memset(search->model, 0, usize(search->word_count) * sizeof(u64));
+    for (i32 i = 1; i < problem->variable_count; ++i) {
+      if (!(problem->assigned_values[i >> 6] & get_word_mask(i))) continue;
+      search->model[original_variables[i] >> 6] |= get_word_mask(original_variables[i]);
+    }
+  } else if (result == SAT) {
+    memcpy(search->model, problem->assigned_values, usize(search->word_count) * sizeof(u64));
+  }
+  if (result != UNSAT) return result;
+
+  // The variables which were assigned before the search come from the unit clauses
+  i32 previous_count = search->active_count;
+  memset(search->active, 0, usize(search->clause_count));
+  search->active_count = 0;
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    if (!search->used[i]) continue;
+
+    i32 clause_id = search->subset_ids[i];
+    activate_clause(search, clause_id);
+    i32 *literals = clause_literals(search, clause_id);
+    for (i32 k = 0; k < clause_length(search, clause_id); ++k) {
+      i32 unit_clause = search->unit_clauses[abs(literals[k])];
+      if (unit_clause >= 0) activate_clause(search, unit_clause);
+    }
+  }
+  compact_active_ids(search, previous_count);
+  return UNSAT;
+}
+
+ProblemResult solve_subset(CoreSearch *search, i32 skipped_clause_id) {
+  if (!collect_subset(search, skipped_clause_id)) return UNSAT;
+
+  // Without clauses every assignment is a model
+  if (search->subset.clause_count == 0) {
+    memset(search->model, 0, usize(search->word_count) * sizeof(u64));
+    return SAT;
+  }
+
+  // A check which cannot be loaded (its clause matrix does not fit in memory) stops the search like a limit, the core
+  // found so far stays valid
+  Problem problem;
+  if (load_problem(&problem, &search->subset, search->splitting_heuristic)) return UNKNOWN;
+  ProblemResult result = solve_loaded(search, &problem, search->original_variables);
+  destroy_problem(&problem);
+  return result;
+}
+
+// Model rotation state over the clauses of the core: the model which is changed by flips and the number of true
+// literals of every clause under it
+struct Rotation {
+  size *occurrence_starts; // Indexed by 2 * variable_id + negated
+  i32 *occurrences;
+  i32 *true_counts;
+  u64 *values;
+};
+
+struct RotationFrame {
+  i32 clause_id;
+  i32 position;            // Next literal of the clause which is flipped
+  i32 flipped_variable_id; // Variable which was flipped to falsify the clause, 0 for the model of the solver
+};
+
+inline size occurrence_index(i32 literal) { return literal < 0 ? 2 * size(-literal) + 1 : 2 * size(literal); }
+
+inline bool literal_is_true(u64 *values, i32 literal) {
+  bool value = values[abs(literal) >> 6] & get_word_mask(abs(literal));
+  return literal < 0 ? !value : value;
+}
+
+Rotation init_rotation(CoreSearch *search) {
+  i32 variable_count = search->formula.variable_count;
+
+  Rotation rotation;
+  rotation.occurrence_starts = CAllocator::construct<size>(2 * size(variable_count) + 3);
+  rotation.true_counts       = CAllocator::construct<i32>(search->clause_count);
+  rotation.values            = CAllocator::construct<u64>(search->word_count);
+  memset(rotation.occurrence_starts, 0, usize(2 * variable_count + 3) * sizeof(size));
+  for (i32 i = 0; i < search->active_count; ++i) {
+    i32 clause_id = search->active_ids[i];
+    i32 *literals = clause_literals(search, clause_id);
+    for (i32 k = 0; k < clause_length(search, clause_id); ++k) {
+      ++rotation.occurrence_starts[occurrence_index(literals[k]) + 1];
+    }
+  }
+  for (i32 i = 0; i < 2 * variable_count + 2; ++i) {
+    rotation.occurrence_starts[i + 1] += rotation.occurrence_starts[i];
+  }
+
+  size occurrence_count = rotation.occurrence_starts[2 * variable_count + 2];
+  rotation.occurrences  = CAllocator::construct<i32>(occurrence_count > 0 ? occurrence_count : 1);
+  size *positions       = CAllocator::construct<size>(2 * size(variable_count) + 2);
+  memcpy(positions, rotation.occurrence_starts, usize(2 * variable_count + 2) * sizeof(size));
+  for (i32 i = 0; i < search->active_count; ++i) {
+    i32 clause_id = search->active_ids[i];
+    i32 *literals = clause_literals(search, clause_id);
+    for (i32 k = 0; k < clause_length(search, clause_id); ++k) {
+      rotation.occurrences[positions[occurrence_index(literals[k])]++] = clause_id;
+    }
+  }
+  CAllocator::destruct(positions);
+  return rotation;
+}
+
+void destroy_rotation(Rotation *rotation) {
+  CAllocator::destruct(rotation->occurrence_starts);
+  CAllocator::destruct(rotation->occurrences);
+  CAllocator::destruct(rotation->true_counts);
+  CAllocator::destruct(rotation->values);
+}
+
+void flip_rotation_variable(Rotation *rotation, i32 variable_id) {
+  i32 true_literal = literal_is_true(rotation->values, variable_id) ? variable_id : -variable_id;
+  for (size o = rotation->occurrence_starts[occurrence_index(true_literal)];
+       o < rotation->occurrence_starts[occurrence_index(true_literal) + 1]; ++o) {
+    --rotation->true_counts[rotation->occurrences[o]];
+  }
+  for (size o = rotation->occurrence_starts[occurrence_index(-true_literal)];
+       o < rotation->occurrence_starts[occurrence_index(-true_literal) + 1]; ++o) {
+    ++rotation->true_counts[rotation->occurrences[o]];
+  }
+  rotation->values[variable_id >> 6] ^= get_word_mask(variable_id);
+}
+
+// The model falsifies exactly one active clause, which is necessary. Flipping a variable of that clause satisfies it,
+// and if the flip falsifies exactly one other clause then that one is necessary as well and its variables are tried in
+// turn. Every clause is only rotated into once, so this takes at most one pass per necessary clause
+void rotate_model(CoreSearch *search, Rotation *rotation, RotationFrame *stack, i32 clause_id) {
+  memcpy(rotation->values, search->model, usize(search->word_count) * sizeof(u64));
+  for (i32 i = 0; i < search->active_count; ++i) {
+    i32 active_id = search->active_ids[i];
+    i32 *literals = clause_literals(search, active_id);
+    i32 count     = 0;
+    for (i32 k = 0; k < clause_length(search, active_id); ++k) {
+      count += literal_is_true(rotation->values, literals[k]);
+    }
+    rotation->true_counts[active_id] = count;
+  }
+  assert(rotation->true_counts[clause_id] == 0);
+
+  i32 depth = 0;
+  stack[depth++] = {clause_id, 0, 0};
+  while (depth > 0) {
+    RotationFrame *frame = &stack[depth - 1];
+    if (frame->position == clause_length(search, frame->clause_id)) {
+      if (frame->flipped_variable_id) flip_rotation_variable(rotation, frame->flipped_variable_id);
+      --depth;
+      continue;
+    }
+
+    i32 literal     = clause_literals(search, frame->clause_id)[frame->position++];
+    i32 variable_id = abs(literal);
+    if (variable_id == frame->flipped_variable_id) continue;
+
+    // The literal is false, so the flip falsifies the clauses whose only true literal is its negation
+    i32 falsified_clause_id = -1;
+    i32 falsified_count     = 0;
+    for (size o = rotation->occurrence_starts[occurrence_index(-literal)];
+         o < rotation->occurrence_starts[occurrence_index(-literal) + 1] && falsified_count < 2; ++o) {
+      i32 other_id = rotation->occurrences[o];
+      if (!search->active[other_id] || rotation->true_counts[other_id] != 1) continue;
+      falsified_clause_id = other_id;
+      ++falsified_count;
+    }
+    if (falsified_count != 1 || search->necessary[falsified_clause_id]) continue;
+
+    search->necessary[falsified_clause_id] = 1;
+    ++search->stats->rotation_count;
+    flip_rotation_variable(rotation, variable_id);
+    stack[depth++] = {falsified_clause_id, 0, variable_id};
+  }
+}
+
+// Refines the core until it stops shrinking and then removes clauses one at a time if it has to be minimal
+void shrink_core(CoreSearch *search, bool minimize) {
+  i32 previous_count;
+  do {
+    previous_count       = search->active_count;
+    ProblemResult result = solve_subset(search, -1);
+    if (result == UNKNOWN) return;
+    if (result == SAT) panic("Clauses used to refute the formula are satisfiable\n");
+  } while (search->active_count < previous_count);
+
+  if (!minimize) return;
+
+  // Every necessary clause is marked once, by a solve or by a rotation, so the frames never exceed the core
+  Rotation rotation     = init_rotation(search);
+  RotationFrame *stack  = CAllocator::construct<RotationFrame>(search->active_count + 1);
+  bool stopped          = false;
+  for (i32 clause_id = 0; clause_id < search->clause_count && !stopped; ++clause_id) {
+    if (!search->active[clause_id] || search->necessary[clause_id]) continue;
+
+    ProblemResult result = solve_subset(search, clause_id);
+    if (result == UNKNOWN) {
+      stopped = true;
+    } else if (result == SAT) {
+      search->necessary[clause_id] = 1;
+      rotate_model(search, &rotation, stack, clause_id);
+    }
+  }
+  CAllocator::destruct(stack);
+  destroy_rotation(&rotation);
+
+  search->stats->minimal = !stopped;
+}
+
+ProblemResult find_core(Problem *problem, bool minimize, u8 *in_core, u64 *values, CoreStats *stats) {
+  assert(problem->cardinality_count == 0 && !problem->xor_system);
+
+  CoreSearch search;
+  search.formula             = formula_from_problem(problem);
+  search.clause_count        = problem->clause_count;
+  search.word_count          = words_per_clause(problem);
+  search.splitting_heuristic = problem->splitting_heuristic;
+  search.double_lookahead    = problem->double_lookahead;
+  search.limits              = problem->limits;
+  search.start_time          = current_time();
+  search.stats               = stats;
+  *stats                     = {problem->clause_count, 0, 0, false};
+
+  search.clause_starts    = CAllocator::construct<size>(search.clause_count + 1);
+  search.clause_starts[0] = 0;
+  i32 clause_id           = 0;
+  for (size i = 0; i < search.formula.literal_count; ++i) {
+    if (!search.formula.literals[i]) search.clause_starts[++clause_id] = i + 1;
+  }
+
+  search.active       = CAllocator::construct<u8>(search.clause_count);
+  search.active_ids   = CAllocator::construct<i32>(search.clause_count);
+  search.necessary    = CAllocator::construct<u8>(search.clause_count);
+  search.active_count = search.clause_count;
+  memset(search.active, 1, usize(search.clause_count));
+  memset(search.necessary, 0, usize(search.clause_count));
+  for (i32 i = 0; i < search.clause_count; ++i) {
+    search.active_ids[i] = i;
+  }
+
+  search.subset       = init_formula(0);
+  search.subset_ids   = CAllocator::construct<i32>(search.clause_count);
+  search.unit_clauses = CAllocator::construct<i32>(search.formula.variable_count + 1);
+  search.used         = CAllocator::construct<u8>(search.clause_count);
+  search.model        = CAllocator::construct<u64>(search.word_count);
+  search.variable_map       = CAllocator::construct<i32>(search.formula.variable_count + 1);
+  search.original_variables = CAllocator::construct<i32>(search.formula.variable_count + 1);
+  for (i32 i = 0; i <= search.formula.variable_count; ++i) {
+    search.unit_clauses[i] = -1;
+    search.variable_map[i] = 0;
+  }
+
+  // The first solve runs on the problem as it was loaded
+  ProblemResult result = UNSAT;
+  if (collect_subset(&search, -1)) result = solve_loaded(&search, problem, nullptr);
+  if (result == SAT) memcpy(values, search.model, usize(search.word_count) * sizeof(u64));
+  if (result == UNSAT) {
+    shrink_core(&search, minimize);
+    memcpy(in_core, search.active, usize(search.clause_count));
+    stats->clause_count = search.active_count;
+  }
+
+  CAllocator::destruct(search.original_variables);
+  CAllocator::destruct(search.variable_map);
+  CAllocator::destruct(search.model);
+  CAllocator::destruct(search.used);
+  CAllocator::destruct(search.unit_clauses);
+  CAllocator::destruct(search.subset_ids);
+  destroy_formula(&search.subset);
+  CAllocator::destruct(search.necessary);
+  CAllocator::destruct(search.active_ids);
+  CAllocator::destruct(search.active);
+  CAllocator::destruct(search.clause_starts);
+  destroy_formula(&search.formula);
+  return result;
+}
+
+} // namespace sat
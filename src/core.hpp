@@ -0,0 +1,28 @@
+#ifndef CORE_HPP
+#define CORE_HPP
+
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+struct CoreStats {
+  i32 clause_count; // Clauses in the core
+  i32 solve_count;
+  i32 rotation_count; // Clauses found to be necessary by model rotation instead of a solver call
+  bool minimal;
+};
+
+// Finds an unsatisfiable subset of the clauses of the problem and flags it in in_core, indexed by clause id (the order
+// of the input). Every solve marks the clauses which propagated or were falsified, and the marked clauses with the
+// unit clauses of their variables are solved again until the core stops shrinking (clause set refinement). With
+// minimize the core is then reduced to a minimal unsatisfiable subset by removing one clause at a time: an UNSAT
+// answer refines the core again, a SAT answer makes the clause necessary and its model is rotated over the flips of
+// the clause's variables to find more necessary clauses without solving. Stopping at a limit or at a check which
+// cannot be allocated still leaves a valid core which is not minimal. On SAT the model is copied to values. The
+// problem may not have cardinality or xor constraints
+ProblemResult find_core(Problem *problem, bool minimize, u8 *in_core, u64 *values, CoreStats *stats);
+
+} // namespace sat
+
+#endif
@@ -0,0 +1,493 @@
+#include "counter.hpp"
+
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+void reserve_count(BigCount *count, i32 capacity) {
+  if (count->capacity >= capacity) return;
+
+  u32 *limbs = CAllocator::construct<u32>(capacity);
+  memcpy(limbs, count->limbs, usize(count->size) * sizeof(u32));
+  CAllocator::destruct(count->limbs);
+  count->limbs    = limbs;
+  count->capacity = capacity;
+}
+
+BigCount init_count(u32 value) {
+  BigCount count;
+  count.capacity = 4;
+  count.limbs    = CAllocator::construct<u32>(count.capacity);
+  count.limbs[0] = value;
+  count.size     = value ? 1 : 0;
+  return count;
+}
+
+void destroy_count(BigCount *count) { CAllocator::destruct(count->limbs); }
+
+void copy_count(BigCount *destination, BigCount *source) {
+  reserve_count(destination, source->size);
+  memcpy(destination->limbs, source->limbs, usize(source->size) * sizeof(u32));
+  destination->size = source->size;
+}
+
+void add_count(BigCount *destination, BigCount *source) {
+  i32 size = destination->size > source->size ? destination->size : source->size;
+  reserve_count(destination, size + 1);
+
+  u64 carry = 0;
+  for (i32 i = 0; i < size; ++i) {
+    u64 sum = carry;
+    if (i < destination->size) sum += destination->limbs[i];
+    if (i < source->size) sum += source->limbs[i];
+    destination->limbs[i] = u32(sum);
+    carry                 = sum >> 32;
+  }
+  destination->size = size;
+  if (carry) destination->limbs[destination->size++] = u32(carry);
+}
+
+void multiply_count(BigCount *destination, BigCount *source) {
+  if (is_zero(destination) || is_zero(source)) {
+    destination->size = 0;
+    return;
+  }
+
+  i32 capacity = destination->size + source->size;
+  u32 *limbs   = CAllocator::construct<u32>(capacity);
+  memset(limbs, 0, usize(capacity) * sizeof(u32));
+
+  for (i32 i = 0; i < destination->size; ++i) {
+    u64 carry = 0;
+    for (i32 k = 0; k < source->size; ++k) {
+      u64 product  = u64(destination->limbs[i]) * source->limbs[k] + limbs[i + k] + carry;
+      limbs[i + k] = u32(product);
+      carry        = product >> 32;
+    }
+    limbs[i + source->size] = u32(carry);
+  }
+  i32 size = capacity;
+  while (size > 0 && limbs[size - 1] == 0) --size;
+
+  CAllocator::destruct(destination->limbs);
+  destination->limbs    = limbs;
+  destination->size     = size;
+  destination->capacity = capacity;
+}
+
+void shift_count(BigCount *count, i32 exponent) {
+  if (is_zero(count) || exponent == 0) return;
+
+  i32 limb_shift = exponent >> 5;
+  i32 bit_shift  = exponent & 31;
+  reserve_count(count, count->size + limb_shift + 1);
+
+  count->limbs[count->size + limb_shift] = 0;
+  for (i32 i = count->size - 1; i >= 0; --i) {
+    u64 shifted = u64(count->limbs[i]) << bit_shift;
+    count->limbs[i + limb_shift + 1] |= u32(shifted >> 32);
+    count->limbs[i + limb_shift] = u32(shifted);
+  }
+  for (i32 i = 0; i < limb_shift; ++i) {
+    count->limbs[i] = 0;
+  }
+
+  count->size += limb_shift + 1;
+  while (count->size > 0 && count->limbs[count->size - 1] == 0) --count->size;
+}
+
+bool is_zero(BigCount *count) { return count->size == 0; }
+
+char *count_to_string(BigCount *count) {
+  // Every 32-bit limb needs at most 10 decimal digits
+  i32 capacity = count->size * 10 + 2;
+  char *string = CAllocator::construct<char>(capacity);
+
+  BigCount remaining = init_count(0);
+  copy_count(&remaining, count);
+
+  i32 length = 0;
+  do {
+    // Divide by 10 in place and collect the remainder as the next digit
+    u64 remainder = 0;
+    for (i32 i = remaining.size - 1; i >= 0; --i) {
+      u64 current        = (remainder << 32) | remaining.limbs[i];
+      remaining.limbs[i] = u32(current / 10);
+      remainder          = current % 10;
+    }
+    while (remaining.size > 0 && remaining.limbs[remaining.size - 1] == 0) --remaining.size;
+
+    string[length++] = char('0' + remainder);
+  } while (!is_zero(&remaining));
+  destroy_count(&remaining);
+
+  for (i32 i = 0; i < length / 2; ++i) {
+    char temp              = string[i];
+    string[i]              = string[length - 1 - i];
+    string[length - 1 - i] = temp;
+  }
+  string[length] = '\0';
+
+  return string;
+}
+
+struct CacheEntry {
+  u64 hash[2];
+  bool used;
+  BigCount count;
+};
+
+struct Counter {
+  Problem *problem;
+  i32 word_count;
+  CountStats *stats;
+
+  // Union-find over variables used to split the residual formula into components
+  i32 *parent;
+
+  // Scratch occurrence counts used to pick the branching variable
+  i32 *occurrences;
+
+  CacheEntry *cache;
+  i64 cache_capacity;
+  i64 cache_size;
+};
+
+u64 mix_hash(u64 value) {
+  value ^= value >> 33;
+  value *= 0xFF51AFD7ED558CCD;
+  value ^= value >> 33;
+  value *= 0xC4CEB9FE1A85EC53;
+  value ^= value >> 33;
+  return value;
+}
+
+i32 find_root(Counter *counter, i32 variable_id) {
+  while (counter->parent[variable_id] != variable_id) {
+    counter->parent[variable_id] = counter->parent[counter->parent[variable_id]];
+    variable_id                  = counter->parent[variable_id];
+  }
+  return variable_id;
+}
+
+bool clause_is_satisfied(Counter *counter, i32 clause_id) {
+  Problem *problem    = counter->problem;
+  u64 *clause_words   = problem->clauses + size(clause_id) * counter->word_count;
+  u64 *negation_words = problem->negations + size(clause_id) * counter->word_count;
+  for (i32 k = 0; k < counter->word_count; ++k) {
+    if (clause_words[k] & ~problem->unassigned[k] & (problem->assigned_values[k] ^ negation_words[k])) return true;
+  }
+  return false;
+}
+
+// Hash of the residual clauses of a component in clause order. Only the unassigned literals are hashed since every
+// assigned literal of an unsatisfied clause is false
+void hash_component(Counter *counter, i32 *clause_ids, i32 clause_count, u64 *hash) {
+  Problem *problem = counter->problem;
+
+  hash[0] = 0x8D7C1A2B3E4F5061;
+  hash[1] = 0x1F2E3D4C5B6A7988;
+  for (i32 i = 0; i < clause_count; ++i) {
+    u64 *clause_words   = problem->clauses + size(clause_ids[i]) * counter->word_count;
+    u64 *negation_words = problem->negations + size(clause_ids[i]) * counter->word_count;
+    for (i32 k = 0; k < counter->word_count; ++k) {
+      u64 unknown = clause_words[k] & problem->unassigned[k];
+      if (!unknown) continue;
+
+      hash[0] = mix_hash(hash[0] ^ unknown) + u64(k);
+      hash[0] = mix_hash(hash[0] ^ (negation_words[k] & unknown));
+      hash[1] = mix_hash(hash[1] + unknown * 0x9E3779B97F4A7C15) ^ u64(k);
+      hash[1] = mix_hash(hash[1] + (negation_words[k] & unknown));
+    }
+
+    // Separate clauses so that different splits of the same literals do not collide
+    hash[0] = mix_hash(hash[0] ^ 0xC1A05E);
+    hash[1] = mix_hash(hash[1] + 0xC1A05E);
+  }
+}
+
+CacheEntry *find_cache_entry(Counter *counter, u64 *hash) {
+  u64 mask = u64(counter->cache_capacity - 1);
+  for (u64 i = hash[0] & mask;; i = (i + 1) & mask) {
+    CacheEntry *entry = &counter->cache[i];
+    if (!entry->used || (entry->hash[0] == hash[0] && entry->hash[1] == hash[1])) return entry;
+  }
+}
+
+void insert_cache(Counter *counter, u64 *hash, BigCount *count) {
+  // Keep the load factor below one half
+  if (2 * (counter->cache_size + 1) > counter->cache_capacity) {
+    CacheEntry *old_cache = counter->cache;
+    i64 old_capacity      = counter->cache_capacity;
+
+    counter->cache_capacity = old_capacity * 2;
+    counter->cache          = CAllocator::construct<CacheEntry>(counter->cache_capacity);
+    for (i64 i = 0; i < counter->cache_capacity; ++i) {
+      counter->cache[i].used = false;
+    }
+    for (i64 i = 0; i < old_capacity; ++i) {
+      if (old_cache[i].used) *find_cache_entry(counter, old_cache[i].hash) = old_cache[i];
+    }
+    CAllocator::destruct(old_cache);
+  }
+
+  CacheEntry *entry = find_cache_entry(counter, hash);
+  assert(!entry->used);
+  entry->hash[0] = hash[0];
+  entry->hash[1] = hash[1];
+  entry->used    = true;
+  entry->count   = init_count(0);
+  copy_count(&entry->count, count);
+  ++counter->cache_size;
+}
+
+BigCount count_residual(Counter *counter, i32 *clause_ids, i32 clause_count, u64 *scope);
+
+// Counts the models of a single connected component over exactly the variables in its clauses
+BigCount count_component(Counter *counter, i32 *clause_ids, i32 clause_count, u64 *scope) {
+  Problem *problem = counter->problem;
+  ++counter->stats->components;
+
+  u64 hash[2];
+  hash_component(counter, clause_ids, clause_count, hash);
+
+  CacheEntry *entry = find_cache_entry(counter, hash);
+  if (entry->used) {
+    ++counter->stats->cache_hits;
+    BigCount count = init_count(0);
+    copy_count(&count, &entry->count);
+    return count;
+  }
+
+  // Branch on the variable with the most occurrences within the component
+  i32 branch_variable_id = -1;
+  for (i32 pass = 0; pass < 2; ++pass) {
+    for (i32 i = 0; i < clause_count; ++i) {
+      u64 *clause_words = problem->clauses + size(clause_ids[i]) * counter->word_count;
+      for (i32 k = 0; k < counter->word_count; ++k) {
+        u64 unknown = clause_words[k] & problem->unassigned[k];
+        while (unknown) {
+          i32 variable_id = (k << 6) | __builtin_ctzll(unknown);
+          if (pass == 0) {
+            ++counter->occurrences[variable_id];
+          } else {
+            if (branch_variable_id == -1 ||
+                counter->occurrences[variable_id] > counter->occurrences[branch_variable_id]) {
+              branch_variable_id = variable_id;
+            }
+          }
+          unknown &= unknown - 1;
+        }
+      }
+    }
+  }
+  for (i32 i = 0; i < clause_count; ++i) {
+    u64 *clause_words = problem->clauses + size(clause_ids[i]) * counter->word_count;
+    for (i32 k = 0; k < counter->word_count; ++k) {
+      u64 unknown = clause_words[k] & problem->unassigned[k];
+      while (unknown) {
+        counter->occurrences[(k << 6) | __builtin_ctzll(unknown)] = 0;
+        unknown &= unknown - 1;
+      }
+    }
+  }
+  assert(branch_variable_id > 0);
+
+  BigCount total = init_count(0);
+  u64 *previous  = CAllocator::construct<u64>(counter->word_count);
+  memcpy(previous, problem->unassigned, usize(counter->word_count) * sizeof(u64));
+
+  for (i32 value = 0; value < 2; ++value) {
+    ++counter->stats->decisions;
+
+    set_variable(problem, branch_variable_id, value);
+    if (propagate(problem) == NO_CONFLICT) {
+      BigCount count = count_residual(counter, clause_ids, clause_count, scope);
+      add_count(&total, &count);
+      destroy_count(&count);
+    }
+
+    memcpy(problem->unassigned, previous, usize(counter->word_count) * sizeof(u64));
+  }
+  CAllocator::destruct(previous);
+
+  insert_cache(counter, hash, &total);
+  return total;
+}
+
+// Counts the models over the unassigned variables of the scope given that only the listed clauses can still be
+// unsatisfied
+BigCount count_residual(Counter *counter, i32 *clause_ids, i32 clause_count, u64 *scope) {
+  Problem *problem = counter->problem;
+
+  i32 *residual      = CAllocator::construct<i32>(clause_count);
+  i32 residual_count = 0;
+  for (i32 i = 0; i < clause_count; ++i) {
+    if (!clause_is_satisfied(counter, clause_ids[i])) residual[residual_count++] = clause_ids[i];
+  }
+
+  // Variables of the scope which no residual clause mentions can take either value
+  u64 *covered = CAllocator::construct<u64>(counter->word_count);
+  memset(covered, 0, usize(counter->word_count) * sizeof(u64));
+
+  bool has_falsified_clause = false;
+  for (i32 i = 0; i < residual_count; ++i) {
+    u64 *clause_words = problem->clauses + size(residual[i]) * counter->word_count;
+
+    u64 any_unknown = 0;
+    for (i32 k = 0; k < counter->word_count; ++k) {
+      u64 unknown = clause_words[k] & problem->unassigned[k];
+      covered[k] |= unknown;
+      any_unknown |= unknown;
+
+      while (unknown) {
+        i32 variable_id              = (k << 6) | __builtin_ctzll(unknown);
+        counter->parent[variable_id] = variable_id;
+        unknown &= unknown - 1;
+      }
+    }
+
+    // Only possible when the fixed variables of the problem already contradict a clause
+    if (!any_unknown) has_falsified_clause = true;
+  }
+
+  if (has_falsified_clause) {
+    CAllocator::destruct(covered);
+    CAllocator::destruct(residual);
+    return init_count(0);
+  }
+
+  i32 free_count = 0;
+  for (i32 k = 0; k < counter->word_count; ++k) {
+    free_count += __builtin_popcountll(scope[k] & problem->unassigned[k] & ~covered[k]);
+  }
+
+  BigCount result = init_count(1);
+  shift_count(&result, free_count);
+
+  // Join the variables of every clause
+  for (i32 i = 0; i < residual_count; ++i) {
+    u64 *clause_words = problem->clauses + size(residual[i]) * counter->word_count;
+    i32 first_root    = -1;
+    for (i32 k = 0; k < counter->word_count; ++k) {
+      u64 unknown = clause_words[k] & problem->unassigned[k];
+      while (unknown) {
+        i32 root = find_root(counter, (k << 6) | __builtin_ctzll(unknown));
+        if (first_root == -1) {
+          first_root = root;
+        } else if (root != first_root) {
+          counter->parent[root] = first_root;
+        }
+        unknown &= unknown - 1;
+      }
+    }
+  }
+
+  // Group the residual clauses by component while keeping clause order within each component stable
+  i32 *roots = CAllocator::construct<i32>(residual_count);
+  for (i32 i = 0; i < residual_count; ++i) {
+    u64 *clause_words = problem->clauses + size(residual[i]) * counter->word_count;
+    i32 k             = 0;
+    while (!(clause_words[k] & problem->unassigned[k])) ++k;
+    roots[i] = find_root(counter, (k << 6) | __builtin_ctzll(clause_words[k] & problem->unassigned[k]));
+  }
+
+  u8 *grouped          = CAllocator::construct<u8>(residual_count);
+  i32 *component       = CAllocator::construct<i32>(residual_count);
+  u64 *component_scope = CAllocator::construct<u64>(counter->word_count);
+  memset(grouped, 0, usize(residual_count));
+
+  for (i32 i = 0; i < residual_count && !is_zero(&result); ++i) {
+    if (grouped[i]) continue;
+
+    i32 component_count = 0;
+    memset(component_scope, 0, usize(counter->word_count) * sizeof(u64));
+    for (i32 k = i; k < residual_count; ++k) {
+      if (grouped[k] || roots[k] != roots[i]) continue;
+
+      grouped[k]                   = 1;
+      component[component_count++] = residual[k];
+
+      u64 *clause_words = problem->clauses + size(residual[k]) * counter->word_count;
+      for (i32 m = 0; m < counter->word_count; ++m) {
+        component_scope[m] |= clause_words[m] & problem->unassigned[m];
+      }
+    }
+
+    BigCount count = count_component(counter, component, component_count, component_scope);
+    multiply_count(&result, &count);
+    destroy_count(&count);
+  }
+
+  CAllocator::destruct(component_scope);
+  CAllocator::destruct(component);
+  CAllocator::destruct(grouped);
+  CAllocator::destruct(roots);
+  CAllocator::destruct(covered);
+  CAllocator::destruct(residual);
+
+  return result;
+}
+
+Result count_models(Problem *problem, BigCount *count, CountStats *stats) {
+  stats->decisions  = 0;
+  stats->components = 0;
+  stats->cache_hits = 0;
+
+  if (problem->cardinality_count > 0) {
+    error("Model counting does not support cardinality constraints\n");
+    return err;
+  }
+  if (problem->xor_system) {
+    error("Model counting does not support xor constraints\n");
+    return err;
+  }
+
+  prepare_search(problem);
+  if (propagate(problem) == CONFLICT) {
+    *count = init_count(0);
+    return ok;
+  }
+
+  Counter counter;
+  counter.problem        = problem;
+  counter.word_count     = words_per_clause(problem);
+  counter.stats          = stats;
+  counter.parent         = CAllocator::construct<i32>(problem->variable_count);
+  counter.occurrences    = CAllocator::construct<i32>(problem->variable_count);
+  counter.cache_capacity = 1024;
+  counter.cache_size     = 0;
+  counter.cache          = CAllocator::construct<CacheEntry>(counter.cache_capacity);
+  memset(counter.occurrences, 0, usize(problem->variable_count) * sizeof(i32));
+  for (i64 i = 0; i < counter.cache_capacity; ++i) {
+    counter.cache[i].used = false;
+  }
+
+  i32 *clause_ids = CAllocator::construct<i32>(problem->clause_count);
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    clause_ids[i] = i;
+  }
+
+  // Every variable left unassigned by the root propagation is counted, x0 is always assigned
+  u64 *scope = CAllocator::construct<u64>(counter.word_count);
+  memcpy(scope, problem->unassigned, usize(counter.word_count) * sizeof(u64));
+
+  *count = count_residual(&counter, clause_ids, problem->clause_count, scope);
+
+  debug("Model count: %ld decisions, %ld components, %ld cache hits\n", stats->decisions, stats->components,
+        stats->cache_hits);
+
+  for (i64 i = 0; i < counter.cache_capacity; ++i) {
+    if (counter.cache[i].used) destroy_count(&counter.cache[i].count);
+  }
+  CAllocator::destruct(counter.cache);
+  CAllocator::destruct(counter.occurrences);
+  CAllocator::destruct(counter.parent);
+  CAllocator::destruct(clause_ids);
+  CAllocator::destruct(scope);
+
+  return ok;
+}
+
+} // namespace sat
@@ -0,0 +1,47 @@
+#ifndef COUNTER_HPP
+#define COUNTER_HPP
+
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+// Arbitrary precision unsigned integer stored as little endian 32-bit limbs
+struct BigCount {
+  u32 *limbs;
+  i32 size;
+  i32 capacity;
+};
+
+BigCount init_count(u32 value);
+
+void destroy_count(BigCount *count);
+
+void copy_count(BigCount *destination, BigCount *source);
+
+void add_count(BigCount *destination, BigCount *source);
+
+void multiply_count(BigCount *destination, BigCount *source);
+
+// Multiplies by 2^exponent
+void shift_count(BigCount *count, i32 exponent);
+
+bool is_zero(BigCount *count);
+
+// Returns a malloc'd decimal representation
+char *count_to_string(BigCount *count);
+
+struct CountStats {
+  i64 decisions;
+  i64 components;
+  i64 cache_hits;
+};
+
+// Counts the models of the problem over all of its variables. The residual formula below every decision is split into
+// independent components which are counted separately and cached under a hash of their clauses. Returns err if the
+// problem has cardinality or xor constraints
+Result count_models(Problem *problem, BigCount *count, CountStats *stats);
+
+} // namespace sat
+
+#endif
@@ -1,13 +1,32 @@
 #include "general.hpp"
 
+#include "backbone.hpp"
+#include "batch.hpp"
+#include "bva.hpp"
+#include "cache.hpp"
+#include "cardinality.hpp"
+#include "checkpoint.hpp"
+#include "core.hpp"
+#include "counter.hpp"
+#include "features.hpp"
+#include "formula.hpp"
+#include "gauss.hpp"
+#include "local_search.hpp"
+#include "mem.hpp"
 #include "os.hpp"
+#include "perf.hpp"
+#include "renumber.hpp"
 #include "solver.hpp"
+#include "symmetry.hpp"
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
 
 namespace sat {
 
 struct Parser {
-  i32 line;
-  i32 idx;
+  i64 line;
+  size idx;
   File file;
 };
 
@@ -35,23 +54,142 @@ bool eat_whitespace(Parser *parser) {
 }
 
 i32 read_int(Parser *parser) {
-  i32 number = 0;
+  i64 number = 0;
   while (!is_eof(parser) && !is_whitespace(at(parser))) {
     char ch = at(parser);
-    if ('0' > ch || ch > '9') panic("Found non-digit but expected number at line %d\n", parser->line);
+    if ('0' > ch || ch > '9') panic("Found non-digit but expected number at line %ld\n", parser->line);
     number = 10 * number + (ch - '0');
+    if (number > INT32_MAX) panic("Number does not fit into 32 bits at line %ld\n", parser->line);
     eat(parser);
   }
-  return number;
+  return i32(number);
+}
+
+// Cardinality line "k <=|>=|= BOUND LITERALS 0", it does not count towards the clause count of the problem line
+void parse_cardinality(Parser *parser, Problem *problem) {
+  i64 line = parser->line;
+  if (eat(parser) || eat_whitespace(parser)) panic("Expected operator after 'k' on line %ld\n", line);
+
+  char op[3]    = {};
+  i32 op_length = 0;
+  while (!is_eof(parser) && !is_whitespace(at(parser))) {
+    if (op_length == 2) panic("Unknown cardinality operator on line %ld\n", line);
+    op[op_length++] = at(parser);
+    eat(parser);
+  }
+
+  CardinalityKind kind;
+  if (!strcmp(op, "<=")) {
+    kind = AT_MOST;
+  } else if (!strcmp(op, ">=")) {
+    kind = AT_LEAST;
+  } else if (!strcmp(op, "=")) {
+    kind = EXACTLY;
+  } else {
+    panic("Unknown cardinality operator '%s' on line %ld\n", op, line);
+  }
+
+  if (eat_whitespace(parser)) panic("Expected bound after operator on line %ld\n", line);
+  i32 bound = read_int(parser);
+
+  i32 *literals = CAllocator::construct<i32>(problem->variable_count);
+  u8 *seen      = CAllocator::construct<u8>(problem->variable_count);
+  memset(seen, 0, usize(problem->variable_count));
+
+  i32 size = 0;
+  while (true) {
+    if (eat_whitespace(parser)) panic("Expected 0 at the end of cardinality line %ld\n", line);
+
+    bool is_negated = false;
+    if (at(parser) == '-') {
+      if (eat(parser)) panic("Expected number after '-' on line %ld\n", parser->line);
+      is_negated = true;
+    }
+
+    i32 variable_id = read_int(parser);
+    if (!variable_id) break;
+
+    if (variable_id >= problem->variable_count) panic("Unknown variable %d on line %ld\n", variable_id, line);
+    if (seen[variable_id]) panic("Variable %d appears twice on cardinality line %ld\n", variable_id, line);
+    seen[variable_id] = 1;
+
+    literals[size++] = make_literal(variable_id, is_negated);
+  }
+
+  debug("k %s %d over %d literals\n", op, bound, size);
+  if (add_cardinality(problem, literals, size, kind, bound)) {
+    panic("Cardinality constraint on line %ld can never be satisfied\n", line);
+  }
+
+  CAllocator::destruct(seen);
+  CAllocator::destruct(literals);
+
+  eat_whitespace(parser);
+}
+
+// Xor line "x LITERALS 0" in the CryptoMiniSat form: the literals xor to true, so every negated literal flips the
+// parity and a variable which appears twice cancels out. It does not count towards the clause count of the problem line
+void parse_xor(Parser *parser, Problem *problem) {
+  i64 line = parser->line;
+  eat(parser);
+
+  u8 *odd = CAllocator::construct<u8>(problem->variable_count);
+  memset(odd, 0, usize(problem->variable_count));
+
+  bool parity = true;
+  while (true) {
+    if (eat_whitespace(parser)) panic("Expected 0 at the end of xor line %ld\n", line);
+
+    if (at(parser) == '-') {
+      if (eat(parser)) panic("Expected number after '-' on line %ld\n", parser->line);
+      parity = !parity;
+    }
+
+    i32 variable_id = read_int(parser);
+    if (!variable_id) break;
+
+    if (variable_id >= problem->variable_count) panic("Unknown variable %d on line %ld\n", variable_id, line);
+    odd[variable_id] ^= 1;
+  }
+
+  i32 *variable_ids = CAllocator::construct<i32>(problem->variable_count);
+  i32 size          = 0;
+  for (i32 i = 1; i < problem->variable_count; ++i) {
+    if (odd[i]) variable_ids[size++] = i;
+  }
+
+  debug("x over %d variables = %d\n", size, parity);
+  if (add_xor(problem, variable_ids, size, parity)) panic("Xor constraint on line %ld can never be satisfied\n", line);
+
+  CAllocator::destruct(variable_ids);
+  CAllocator::destruct(odd);
+
+  eat_whitespace(parser);
 }
 
-Result parse(Problem *problem, cstr input_path, SplittingHeuristic splitting_heuristic) {
+// Also computes the canonical hash of the clauses for the result cache and the clause length histogram
+Result parse(Problem *problem, CnfHash *hash, FormulaFeatures *features, cstr input_path,
+             SplittingHeuristic splitting_heuristic) {
   Parser parser;
   parser.line = 1;
   parser.idx  = 0;
   parser.file = read_file(input_path);
   if (!parser.file.data) return err;
 
+  // Formulas written by test_gen in the binary format skip the text parser
+  if (is_binary_formula(&parser.file)) {
+    Formula formula;
+    if (read_binary(&formula, &parser.file)) panic("Invalid binary formula\n");
+    CAllocator::destruct(parser.file.data);
+    *hash = hash_formula(&formula);
+    count_formula_clause_lengths(features, &formula);
+
+    Result result = load_problem(problem, &formula, splitting_heuristic);
+    if (!result) printf("c CNF Problem: %d variables, %d clauses\n", formula.variable_count, formula.clause_count);
+    destroy_formula(&formula);
+    return result;
+  }
+
   if (eat_whitespace(&parser)) panic("File is empty\n");
 
   bool has_problem_line = false;
@@ -86,17 +224,23 @@ Result parse(Problem *problem, cstr input_path, SplittingHeuristic splitting_heu
 
       break;
     } else {
-      panic("Expected 'c' or 'p' but found character '%c' at start of line %d\n", at(&parser), parser.line);
+      panic("Expected 'c' or 'p' but found character '%c' at start of line %ld\n", at(&parser), parser.line);
     }
   }
 
   if (!has_problem_line) panic("Expected a problem line in the preamble starting with 'p'\n");
   if (variable_count <= 0) panic("Problem must have more than 0 variables\n");
-  if (clause_count <= 0) panic("Problem must have more than 0 clauses\n");
+  // A formula can consist of cardinality or xor constraints alone
+  if (clause_count < 0) panic("Problem cannot have a negative number of clauses\n");
+  if (variable_count > max_variable_count) panic("Problem cannot have more than %d variables\n", max_variable_count);
 
-  *problem = init_problem(variable_count, clause_count, splitting_heuristic);
-  printf("CNF Problem: %d variables, %d clauses\n", variable_count, clause_count);
+  if (init_problem(problem, variable_count, clause_count, splitting_heuristic)) {
+    panic("Could not allocate the clause matrix of %d clauses\n", clause_count);
+  }
+  printf("c CNF Problem: %d variables, %d clauses\n", variable_count, clause_count);
 
+  *hash                        = init_cnf_hash();
+  ClauseHash clause_hash       = init_clause_hash();
   i32 variable_count_in_clause = 0;
   i32 one_variable_id;
   bool one_variable_value;
@@ -106,9 +250,21 @@ Result parse(Problem *problem, cstr input_path, SplittingHeuristic splitting_heu
     char ch = at(&parser);
     assert(!is_whitespace(ch));
 
+    if (ch == 'k') {
+      if (variable_count_in_clause > 0) panic("Cardinality line inside a clause at line %ld\n", parser.line);
+      parse_cardinality(&parser, problem);
+      continue;
+    }
+
+    if (ch == 'x') {
+      if (variable_count_in_clause > 0) panic("Xor line inside a clause at line %ld\n", parser.line);
+      parse_xor(&parser, problem);
+      continue;
+    }
+
     bool is_negated = false;
     if (ch == '-') {
-      if (eat(&parser)) panic("Expected number after '-' on line %d\n", parser.line);
+      if (eat(&parser)) panic("Expected number after '-' on line %ld\n", parser.line);
       is_negated = true;
     }
 
@@ -116,22 +272,30 @@ Result parse(Problem *problem, cstr input_path, SplittingHeuristic splitting_heu
 
     i32 variable_id = read_int(&parser);
     if (variable_id) {
+      if (variable_id > variable_count) panic("Unknown variable %d on line %ld\n", variable_id, parser.line);
+      if (clause_id >= clause_count) panic("More clauses than the %d of the problem line\n", clause_count);
+
       debug(is_negated ? "-" : " ");
       debug("%-3d ", variable_id);
 
       add_variable(problem, clause_id, variable_id, is_negated);
+      hash_literal(&clause_hash, is_negated ? -variable_id : variable_id);
       ++variable_count_in_clause;
 
       one_variable_id    = variable_id;
       one_variable_value = !is_negated;
     } else {
-      if (variable_count_in_clause == 0) panic("Empty clause at line %d\n", parser.line);
+      if (variable_count_in_clause == 0) panic("Empty clause at line %ld\n", parser.line);
 
-      if (variable_count_in_clause == 1) {
+      // A unit clause which contradicts an earlier one is left falsified, the same as in load_problem
+      u64 one_mask = get_word_mask(one_variable_id);
+      if (variable_count_in_clause == 1 && (problem->unassigned[one_variable_id >> 6] & one_mask)) {
         set_variable(problem, one_variable_id, one_variable_value);
         debug("\t\t// Optimize 1-literal x%d to %d", one_variable_id, one_variable_value);
       }
       debug("\n");
+      finish_clause(hash, &clause_hash);
+      count_clause_length(features, variable_count_in_clause);
 
       ++clause_id;
       debug("clause%d: ", clause_id);
@@ -143,6 +307,8 @@ Result parse(Problem *problem, cstr input_path, SplittingHeuristic splitting_heu
 
   if (variable_count_in_clause > 0) {
     debug("\n");
+    finish_clause(hash, &clause_hash);
+    count_clause_length(features, variable_count_in_clause);
     ++clause_id;
   }
 
@@ -151,39 +317,828 @@ Result parse(Problem *problem, cstr input_path, SplittingHeuristic splitting_heu
   return ok;
 }
 
-Result solve(cstr input_path, char splitting_heuristic_arg) {
+enum SolveMode {
+  DPLL,
+  LOCAL_SEARCH,
+  HYBRID,
+  COUNT,
+  ENUMERATE,
+  BACKBONE,
+  CORE,
+  MUS,
+  BATCH,
+};
+
+struct Options {
+  char splitting_heuristic_arg;
+  cstr input_path;
+
+  SolveMode mode;
+  LocalSearchConfig local_search;
+
+  // Maximum number of models to enumerate, 0 for all of them
+  i64 model_limit;
+
+  bool double_lookahead;
+  bool amo_detection;
+  bool xor_detection;
+  bool symmetry_breaking;
+  bool variable_addition;
+  bool renumbering;
+  bool perf_counters;
+
+  // File for the "v" lines of the model, nullptr for stdout
+  cstr model_path;
+
+  // File for the DIMACS clauses of an unsatisfiable core, nullptr for none
+  cstr core_path;
+
+  // Result log of solved formulas, nullptr for no caching
+  cstr cache_path;
+
+  // Checkpoint file of the search, nullptr for no checkpoints
+  cstr checkpoint_path;
+  f64 checkpoint_interval;
+  bool resume;
+
+  SolveLimits limits;
+};
+
+// Parses "--name=value" numbers and panics on anything else
+i64 read_option_int(cstr arg, cstr value) {
+  char *end;
+  i64 number = strtoll(value, &end, 10);
+  if (!*value || *end) panic("Expected number in option %s\n", arg);
+  return number;
+}
+
+bool is_option(cstr arg, cstr name, cstr *value) {
+  usize length = strlen(name);
+  if (strncmp(arg, name, length)) return false;
+  if (arg[length] == '=') {
+    *value = arg + length + 1;
+    return true;
+  }
+  return false;
+}
+
+Result parse_options(Options *options, i32 argc, char **argv) {
+  if (argc < 3) return err;
+
+  options->splitting_heuristic_arg = argv[1][0];
+  options->input_path              = argv[argc - 1];
+  options->mode                    = DPLL;
+  options->local_search            = default_local_search_config();
+  options->model_limit             = 0;
+  options->double_lookahead        = false;
+  options->amo_detection           = false;
+  options->xor_detection           = false;
+  options->symmetry_breaking       = false;
+  options->variable_addition       = false;
+  options->renumbering             = false;
+  options->perf_counters           = false;
+  options->model_path              = nullptr;
+  options->core_path               = nullptr;
+  options->cache_path              = nullptr;
+  options->checkpoint_path         = nullptr;
+  options->checkpoint_interval     = 300;
+  options->resume                  = false;
+  options->limits                  = {0, 0, 0, 0, 0};
+
+  for (i32 i = 2; i < argc - 1; ++i) {
+    cstr arg = argv[i];
+    cstr value;
+    if (!strcmp(arg, "--sls")) {
+      options->mode = LOCAL_SEARCH;
+    } else if (!strcmp(arg, "--hybrid")) {
+      options->mode = HYBRID;
+    } else if (!strcmp(arg, "--count")) {
+      options->mode = COUNT;
+    } else if (!strcmp(arg, "--backbone")) {
+      options->mode = BACKBONE;
+    } else if (!strcmp(arg, "--core")) {
+      options->mode = CORE;
+    } else if (!strcmp(arg, "--mus")) {
+      options->mode = MUS;
+    } else if (!strcmp(arg, "--batch")) {
+      options->mode = BATCH;
+    } else if (!strcmp(arg, "--enumerate")) {
+      options->mode = ENUMERATE;
+    } else if (is_option(arg, "--enumerate", &value)) {
+      options->mode        = ENUMERATE;
+      options->model_limit = read_option_int(arg, value);
+    } else if (!strcmp(arg, "--double-lookahead")) {
+      options->double_lookahead = true;
+    } else if (!strcmp(arg, "--detect-amo")) {
+      options->amo_detection = true;
+    } else if (!strcmp(arg, "--detect-xor")) {
+      options->xor_detection = true;
+    } else if (is_option(arg, "--model", &value)) {
+      options->model_path = value;
+    } else if (is_option(arg, "--core-output", &value)) {
+      options->core_path = value;
+    } else if (is_option(arg, "--cache", &value)) {
+      options->cache_path = value;
+    } else if (is_option(arg, "--checkpoint", &value)) {
+      options->checkpoint_path = value;
+    } else if (is_option(arg, "--checkpoint-interval", &value)) {
+      options->checkpoint_interval = f64(read_option_int(arg, value));
+      if (options->checkpoint_interval <= 0) panic("Expected a positive checkpoint interval\n");
+    } else if (!strcmp(arg, "--resume")) {
+      options->resume = true;
+    } else if (!strcmp(arg, "--perf")) {
+      options->perf_counters = true;
+    } else if (!strcmp(arg, "--symmetry")) {
+      options->symmetry_breaking = true;
+    } else if (!strcmp(arg, "--bva")) {
+      options->variable_addition = true;
+    } else if (!strcmp(arg, "--renumber")) {
+      options->renumbering = true;
+    } else if (is_option(arg, "--flips", &value)) {
+      options->local_search.max_flips = read_option_int(arg, value);
+    } else if (is_option(arg, "--threads", &value)) {
+      options->local_search.thread_count = i32(read_option_int(arg, value));
+      if (options->local_search.thread_count <= 0) panic("Expected at least one thread\n");
+    } else if (is_option(arg, "--seed", &value)) {
+      options->local_search.seed = u64(read_option_int(arg, value));
+    } else if (is_option(arg, "--time-limit", &value)) {
+      options->limits.time_limit = f64(read_option_int(arg, value));
+    } else if (is_option(arg, "--decisions", &value)) {
+      options->limits.decision_limit = read_option_int(arg, value);
+    } else if (is_option(arg, "--conflicts", &value)) {
+      options->limits.conflict_limit = read_option_int(arg, value);
+    } else if (is_option(arg, "--propagations", &value)) {
+      options->limits.propagation_limit = read_option_int(arg, value);
+    } else if (is_option(arg, "--memory-limit", &value)) {
+      options->limits.memory_limit = read_option_int(arg, value) * 1024 * 1024;
+    } else {
+      error("Unknown option %s\n", arg);
+      return err;
+    }
+  }
+
+  // Symmetry breaking removes models so they could no longer be counted, listed or checked for a backbone
+  bool needs_all_models = options->mode == COUNT || options->mode == ENUMERATE || options->mode == BACKBONE;
+  if (options->symmetry_breaking && needs_all_models) {
+    error("--symmetry cannot be combined with --count, --enumerate or --backbone\n");
+    return err;
+  }
+
+  // Auxiliary variables of bounded variable addition can take both values in a model of the input, so models would be
+  // counted or listed more than once
+  if (options->variable_addition && needs_all_models) {
+    error("--bva cannot be combined with --count, --enumerate or --backbone\n");
+    return err;
+  }
+
+  // Model counting has no cardinality propagation, and enumeration lists the models of the clauses as they are given
+  if (options->amo_detection && (options->mode == COUNT || options->mode == ENUMERATE)) {
+    error("--detect-amo cannot be combined with --count or --enumerate\n");
+    return err;
+  }
+
+  // Nor does model counting eliminate xor constraints
+  if (options->xor_detection && options->mode == COUNT) {
+    error("--detect-xor cannot be combined with --count\n");
+    return err;
+  }
+
+  // Only a single result and model is cached per formula
+  if (options->cache_path && needs_all_models) {
+    error("--cache cannot be combined with --count, --enumerate or --backbone\n");
+    return err;
+  }
+
+  // Core clauses are reported by their position in the input
+  bool finds_core = options->mode == CORE || options->mode == MUS;
+  if (finds_core && (options->symmetry_breaking || options->variable_addition || options->renumbering ||
+                     options->amo_detection || options->cache_path)) {
+    error("--core and --mus cannot be combined with --symmetry, --bva, --renumber, --detect-amo or --cache\n");
+    return err;
+  }
+  if (options->core_path && !finds_core) {
+    error("--core-output needs --core or --mus\n");
+    return err;
+  }
+
+  // The batch engine has its own search and reads plain clauses
+  bool changes_search = options->double_lookahead || options->amo_detection || options->xor_detection ||
+                        options->symmetry_breaking || options->variable_addition || options->renumbering ||
+                        options->perf_counters;
+  if (options->mode == BATCH && (changes_search || options->model_path || options->cache_path)) {
+    error("--batch cannot be combined with --double-lookahead, --detect-amo, --detect-xor, --symmetry, --bva, "
+          "--renumber, --perf, --model or --cache\n");
+    return err;
+  }
+
+  // Checkpoints only cover the state of a single dpll_solve
+  if (options->checkpoint_path && options->mode != DPLL) {
+    error("--checkpoint cannot be combined with --sls, --hybrid, --count, --enumerate, --backbone, --core, --mus or "
+          "--batch\n");
+    return err;
+  }
+  if (options->resume && !options->checkpoint_path) {
+    error("--resume needs a --checkpoint file\n");
+    return err;
+  }
+
+  return ok;
+}
+
+// Replaces the problem with one that has lex-leader clauses for the symmetries that were found
+Result break_problem_symmetries(Problem *problem) {
+  if (problem->cardinality_count > 0 || problem->xor_system) {
+    error("--symmetry does not support cardinality or xor constraints\n");
+    return err;
+  }
+
+  Formula formula     = formula_from_problem(problem);
+  SymmetryStats stats = break_symmetries(&formula);
+  printf("c Symmetry: %d generators, %d clauses, %d auxiliary variables\n", stats.generator_count, stats.clause_count,
+         stats.variable_count);
+  if (stats.generator_count == 0) {
+    destroy_formula(&formula);
+    return ok;
+  }
+
+  SplittingHeuristic splitting_heuristic = problem->splitting_heuristic;
+  destroy_problem(problem);
+  Result result = load_problem(problem, &formula, splitting_heuristic);
+  destroy_formula(&formula);
+  return result;
+}
+
+// Replaces the problem with one where products of clauses are factored through auxiliary variables
+Result add_problem_variables(Problem *problem) {
+  if (problem->cardinality_count > 0 || problem->xor_system) {
+    error("--bva does not support cardinality or xor constraints\n");
+    return err;
+  }
+
+  Formula formula = formula_from_problem(problem);
+  BvaStats stats  = add_bounded_variables(&formula);
+  printf("c BVA: %d auxiliary variables, %d clauses removed\n", stats.variable_count, stats.removed_clause_count);
+  if (stats.replacement_count == 0) {
+    destroy_formula(&formula);
+    return ok;
+  }
+
+  SplittingHeuristic splitting_heuristic = problem->splitting_heuristic;
+  destroy_problem(problem);
+  Result result = load_problem(problem, &formula, splitting_heuristic);
+  destroy_formula(&formula);
+  return result;
+}
+
+// Replaces the problem with one whose variables and clauses are renumbered for locality of the clause words and
+// watchlists
+Result renumber_problem(Problem *problem, Renumbering *renumbering) {
+  if (problem->cardinality_count > 0 || problem->xor_system) {
+    error("--renumber does not support cardinality or xor constraints\n");
+    return err;
+  }
+
+  Formula formula = formula_from_problem(problem);
+  *renumbering    = renumber_formula(&formula);
+
+  SplittingHeuristic splitting_heuristic = problem->splitting_heuristic;
+  destroy_problem(problem);
+  Result result = load_problem(problem, &formula, splitting_heuristic);
+  destroy_formula(&formula);
+  return result;
+}
+
+// Values over the variables of the input. Renumbered values are written to the buffer, otherwise they are returned as
+// they are
+u64 *input_values(Renumbering *renumbering, u64 *values, u64 *buffer) {
+  if (!renumbering) return values;
+  restore_numbering(renumbering, values, buffer);
+  return buffer;
+}
+
+// Exit codes of the SAT competition, errors keep using err
+enum ExitCode : i32 {
+  EXIT_UNKNOWN       = 0,
+  EXIT_SATISFIABLE   = 10,
+  EXIT_UNSATISFIABLE = 20,
+};
+
+struct Enumeration {
+  Writer *writer;
+  Renumbering *renumbering;
+  u64 *values;
+  i32 variable_count;
+  i64 model_count;
+  i64 model_limit;
+};
+
+// Streams every model as "v" lines of signed literals
+bool print_model(Problem *problem, void *data) {
+  auto *enumeration = (Enumeration *)data;
+  ++enumeration->model_count;
+
+  u64 *values = input_values(enumeration->renumbering, problem->assigned_values, enumeration->values);
+  write_model(enumeration->writer, "v", values, nullptr, enumeration->variable_count);
+
+  return enumeration->model_limit == 0 || enumeration->model_count < enumeration->model_limit;
+}
+
+// Prints a backbone literal in the input numbering as soon as it is confirmed, data is the renumbering or nullptr
+void print_backbone_literal(i32 literal, void *data) {
+  auto *renumbering = (Renumbering *)data;
+  if (renumbering) literal = literal < 0 ? -renumbering->original_ids[-literal] : renumbering->original_ids[literal];
+  printf("b %d\n", literal);
+  fflush(stdout);
+}
+
+// Writes the positions of the core clauses in the input, starting at 1, as "u" lines which end with 0
+void write_clause_numbers(Writer *writer, u8 *in_core, i32 clause_count) {
+  append_string(writer, "u");
+  i32 line_length = 0;
+  for (i32 i = 0; i < clause_count; ++i) {
+    if (!in_core[i]) continue;
+
+    if (line_length >= max_model_line_length) {
+      append_string(writer, "\nu");
+      line_length = 0;
+    }
+    append_string(writer, " ");
+    append_int(writer, i + 1);
+    for (i32 number = i + 1; number; number /= 10) {
+      ++line_length;
+    }
+    ++line_length;
+  }
+  append_string(writer, " 0\n");
+}
+
+// Writes the core clauses as DIMACS in the order of the input
+Result write_core(cstr path, Problem *problem, u8 *in_core, i32 core_size) {
+  Formula formula = formula_from_problem(problem);
+  Formula core    = init_formula(formula.variable_count);
+  i32 clause_id   = 0;
+  size start      = 0;
+  for (size i = 0; i < formula.literal_count; ++i) {
+    if (formula.literals[i]) continue;
+    if (in_core[clause_id]) push_clause(&core, formula.literals + start, i32(i - start));
+    ++clause_id;
+    start = i + 1;
+  }
+
+  char comment[64];
+  snprintf(comment, sizeof(comment), "Unsatisfiable core of %d out of %d clauses", core_size, problem->clause_count);
+  Result result = write_dimacs(&core, path, comment);
+  destroy_formula(&core);
+  destroy_formula(&formula);
+  return result;
+}
+
+// Problem which is interrupted by SIGINT and SIGTERM so that a cancelled run still reports its statistics and writes
+// its last checkpoint
+Problem *running_problem = nullptr;
+
+void handle_interrupt(i32) {
+  if (running_problem) interrupt(running_problem);
+}
+
+void print_statistics(Problem *problem) {
+  printf("c Decisions: %ld, conflicts: %ld, propagations: %ld, time: %.3fs\n", problem->split_count,
+         problem->conflict_count, problem->propagation_count, current_time() - problem->start_time);
+}
+
+// Writes the model to the model file if one was given and to stdout otherwise
+i32 print_solution(Options *options, Writer *out, u64 *values, i32 variable_count) {
+  printf("s SATISFIABLE\n");
+  if (!options->model_path) {
+    write_model(out, "v", values, nullptr, variable_count);
+    return EXIT_SATISFIABLE;
+  }
+
+  FILE *file = fopen(options->model_path, "w");
+  if (!file) {
+    error("Could not open model file %s\n", options->model_path);
+    return err;
+  }
+  // stdio keeps its own buffer, so a full disk may only show up when the file is closed
+  Writer *writer = init_writer(file);
+  write_model(writer, "v", values, nullptr, variable_count);
+  Result result = destroy_writer(writer);
+  if (fclose(file) || result) {
+    error("Could not write model file %s\n", options->model_path);
+    return err;
+  }
+  return EXIT_SATISFIABLE;
+}
+
+// Answers from the result cache. A cached model is checked against the clauses first, so a hash collision or a corrupt
+// entry only costs the lookup. Returns EXIT_UNKNOWN when the formula has to be solved
+i32 solve_from_cache(Options *options, Problem *problem, CnfHash hash) {
+  u64 *values         = CAllocator::construct<u64>(words_per_clause(problem));
+  CachedResult cached = lookup_result(options->cache_path, hash, problem->variable_count, values);
+  if (cached == CACHE_SAT && !model_satisfies(problem, values)) {
+    printf("c Cached model does not satisfy the formula, solving it\n");
+    cached = CACHE_MISS;
+  }
+
+  i32 exit_code = EXIT_UNKNOWN;
+  if (cached == CACHE_SAT) {
+    printf("c Result cache hit\n");
+    Writer *out = init_writer(stdout);
+    exit_code   = print_solution(options, out, values, problem->variable_count);
+    destroy_writer(out);
+  } else if (cached == CACHE_UNSAT) {
+    printf("c Result cache hit\n");
+    printf("s UNSATISFIABLE\n");
+    exit_code = EXIT_UNSATISFIABLE;
+  }
+  CAllocator::destruct(values);
+  return exit_code;
+}
+
+// Adds a SAT or UNSAT result to the cache, values are only read for SAT
+void cache_result(cstr cache_path, CnfHash hash, i32 exit_code, u64 *values, i32 variable_count) {
+  if (!cache_path || (exit_code != EXIT_SATISFIABLE && exit_code != EXIT_UNSATISFIABLE)) return;
+  if (store_result(cache_path, hash, variable_count, exit_code == EXIT_SATISFIABLE, values)) {
+    error("Could not write result cache %s\n", cache_path);
+  }
+}
+
+// Reads a formula for the batch engine in DIMACS or the binary format of test_gen
+Result read_batch_formula(Formula *formula, cstr path) {
+  File file = read_file(path);
+  if (!file.data) {
+    error("Could not read formula %s\n", path);
+    return err;
+  }
+
+  Result result = is_binary_formula(&file) ? read_binary(formula, &file) : read_dimacs(formula, &file);
+  CAllocator::destruct(file.data);
+  if (result) {
+    error("Invalid formula %s, the batch engine only reads comments, the problem line and clauses\n", path);
+    return err;
+  }
+  if (formula->variable_count > max_batch_variable_count || formula->clause_count == 0) {
+    error("Formula %s must have at most %d variables and at least one clause for the batch engine\n", path,
+          max_batch_variable_count);
+    destroy_formula(formula);
+    return err;
+  }
+
+  // The lanes keep a clause as two masks, which cannot hold both polarities of a variable
+  normalize_formula(formula);
+  return ok;
+}
+
+// Solves every formula named on a line of the input file with the batch engine and prints the answers in the order of
+// the list. The exit code does not depend on the answers since there is more than one
+i32 solve_batch_list(Options *options) {
+  File list = read_file(options->input_path);
+  if (!list.data) return err;
+
+  // Every line but an empty one is a path, so the line count bounds the path count
+  i32 line_count = 1;
+  for (size i = 0; i < list.length; ++i) {
+    line_count += list.data[i] == '\n';
+  }
+
+  i32 path_count = 0;
+  char **paths   = CAllocator::construct<char *>(line_count);
+  for (size start = 0; start < list.length;) {
+    size end = start;
+    while (end < list.length && list.data[end] != '\n') ++end;
+    size length = end;
+    while (length > start && (list.data[length - 1] == '\r' || list.data[length - 1] == ' ')) --length;
+    if (length > start) {
+      char *path = CAllocator::construct<char>(length - start + 1);
+      memcpy(path, list.data + start, usize(length - start));
+      path[length - start] = 0;
+      paths[path_count++]  = path;
+    }
+    start = end + 1;
+  }
+  CAllocator::destruct(list.data);
+
+  Formula *formulas = CAllocator::construct<Formula>(path_count);
+  i32 read_count    = 0;
+  Result result     = ok;
+  for (; read_count < path_count && !result; ++read_count) {
+    result = read_batch_formula(&formulas[read_count], paths[read_count]);
+  }
+  if (result) --read_count;
+  if (!result) printf("c Parsed %d formulas\n", path_count);
+
+  if (!result && path_count > 0) {
+    auto *results  = CAllocator::construct<ProblemResult>(path_count);
+    u64 *models    = CAllocator::construct<u64>(path_count);
+    f64 start_time = current_time();
+    BatchStats stats;
+    solve_batch(formulas, path_count, results, models, &stats);
+    f64 elapsed = current_time() - start_time;
+
+    Writer *out         = init_writer(stdout);
+    i32 satisfied_count = 0;
+    for (i32 i = 0; i < path_count; ++i) {
+      printf("c Instance %s\n", paths[i]);
+      if (results[i] == SAT) {
+        ++satisfied_count;
+        printf("s SATISFIABLE\n");
+        write_model(out, "v", &models[i], nullptr, formulas[i].variable_count + 1);
+        flush(out);
+      } else {
+        printf("s UNSATISFIABLE\n");
+      }
+    }
+    destroy_writer(out);
+
+    f64 utilization = stats.sweeps ? 100.0 * f64(stats.busy_lanes) / f64(stats.sweeps * batch_lane_count) : 0;
+    printf("c Batch: %d instances, %d satisfiable, %d lanes, decisions: %ld, conflicts: %ld, lane utilization: "
+           "%.1f%%, time: %.3fs, %.2f instances/ms\n",
+           path_count, satisfied_count, batch_lane_count, stats.decisions, stats.conflicts, utilization, elapsed,
+           elapsed > 0 ? f64(path_count) / (elapsed * 1000) : 0);
+    CAllocator::destruct(models);
+    CAllocator::destruct(results);
+  }
+
+  for (i32 i = 0; i < read_count; ++i) {
+    destroy_formula(&formulas[i]);
+  }
+  CAllocator::destruct(formulas);
+  for (i32 i = 0; i < path_count; ++i) {
+    CAllocator::destruct(paths[i]);
+  }
+  CAllocator::destruct(paths);
+  fflush(stdout);
+  if (result) return err;
+  return EXIT_UNKNOWN;
+}
+
+// Indexed by SplittingHeuristic
+const cstr heuristic_names[] = {"random", "two-clause", "polarity", "lookahead", "MOMS", "Jeroslow-Wang"};
+
+i32 solve(Options *options) {
   SplittingHeuristic splitting_heuristic;
-  switch (splitting_heuristic_arg) {
+  switch (options->splitting_heuristic_arg) {
   case 'r': splitting_heuristic = RANDOM; break;
   case 't': splitting_heuristic = TWO_CLAUSE; break;
   case 'p': splitting_heuristic = POLARITY; break;
-  default: panic("Unimplemented heuristic argument: %c\n", splitting_heuristic_arg);
+  case 'l': splitting_heuristic = LOOKAHEAD; break;
+  case 'm': splitting_heuristic = MOMS; break;
+  case 'j': splitting_heuristic = JEROSLOW_WANG; break;
+  case 'a': splitting_heuristic = POLARITY; break; // Its polarity counts are features, it is switched after the parse
+  default: panic("Unimplemented heuristic argument: %c\n", options->splitting_heuristic_arg);
   }
 
+  // The batch engine always decides on the variable with the most occurrences
+  if (options->mode == BATCH) return solve_batch_list(options);
+
+  PerfCounters *perf_counters = options->perf_counters ? init_perf_counters() : nullptr;
+  begin_phase(perf_counters, PHASE_PARSE);
   Problem problem;
-  if (parse(&problem, input_path, splitting_heuristic)) return err;
+  CnfHash hash;
+  FormulaFeatures features = init_features();
+  if (parse(&problem, &hash, &features, options->input_path, splitting_heuristic)) return err;
+  end_phase(perf_counters, PHASE_PARSE);
 
-  if (dpll_solve(&problem) == SAT) {
-    fprintf(stderr, "%d", problem.split_count);
-    // TODO: uncomment print_sat_solution(&problem);
-    return ok;
+  if (options->splitting_heuristic_arg == 'a') {
+    finish_features(&features, &problem);
+    AutoConfig config = select_configuration(&features);
+    print_features(&features);
+    printf("c Auto: heuristic %s (%s)\n", heuristic_names[config.splitting_heuristic], config.description);
+    set_splitting_heuristic(&problem, config.splitting_heuristic);
+
+    // Model counting, backbones and cores do not support xor constraints
+    bool supports_xors = options->mode != COUNT && options->mode != BACKBONE && options->mode != CORE &&
+                         options->mode != MUS;
+    if (config.xor_detection && supports_xors) options->xor_detection = true;
+  }
+
+  // The hash only covers clauses, so formulas with cardinality or xor lines are not cached
+  cstr cache_path = problem.cardinality_count == 0 && !problem.xor_system ? options->cache_path : nullptr;
+  if (cache_path) {
+    i32 exit_code = solve_from_cache(options, &problem, hash);
+    if (exit_code != EXIT_UNKNOWN) {
+      if (perf_counters) destroy_perf_counters(perf_counters);
+      fflush(stdout);
+      return exit_code;
+    }
+  }
+
+  // Auxiliary variables of symmetry breaking and bounded variable addition are not part of the model
+  i32 model_variable_count = problem.variable_count;
+  if (options->symmetry_breaking && break_problem_symmetries(&problem)) return err;
+  if (options->variable_addition && add_problem_variables(&problem)) return err;
+
+  // Models are mapped back to the input numbering before they are printed or cached
+  Renumbering renumbering_data;
+  Renumbering *renumbering = nullptr;
+  u64 *model_values        = nullptr;
+  u64 *model_unassigned    = nullptr;
+  if (options->renumbering) {
+    if (renumber_problem(&problem, &renumbering_data)) return err;
+    renumbering      = &renumbering_data;
+    model_values     = CAllocator::construct<u64>(words_per_clause(&problem));
+    model_unassigned = CAllocator::construct<u64>(words_per_clause(&problem));
+    printf("c Renumbered %d variables and %d clauses\n", problem.variable_count - 1, problem.clause_count);
+  }
+  problem.perf_counters    = perf_counters;
+  problem.double_lookahead = options->double_lookahead;
+  if (options->amo_detection) detect_at_most_one(&problem);
+  if (options->xor_detection) printf("c Detected %d xor constraints\n", detect_xors(&problem));
+
+  // Everything else on stdout goes through printf, so the writer is flushed before anything else is printed
+  Writer *out = init_writer(stdout);
+  i32 exit_code;
+
+  if (options->mode == LOCAL_SEARCH) {
+    // Local search is incomplete so it can only ever prove satisfiability
+    LocalSearchResult result = local_search(&problem, options->local_search);
+    printf("c Flips: %ld\n", result.flip_count);
+    if (result.solved) {
+      u64 *values = input_values(renumbering, result.best_assignment, model_values);
+      exit_code   = print_solution(options, out, values, model_variable_count);
+      cache_result(cache_path, hash, exit_code, values, model_variable_count);
+    } else {
+      printf("s UNKNOWN\n");
+      exit_code = EXIT_UNKNOWN;
+    }
+    destroy_local_search_result(&result);
+  } else if (options->mode == COUNT) {
+    CountStats stats;
+    BigCount count;
+    if (count_models(&problem, &count, &stats)) return err;
+    char *string = count_to_string(&count);
+    printf("c Decisions: %ld\n", stats.decisions);
+    printf("c Models: %s\n", string);
+    printf(is_zero(&count) ? "s UNSATISFIABLE\n" : "s SATISFIABLE\n");
+
+    exit_code = is_zero(&count) ? EXIT_UNSATISFIABLE : EXIT_SATISFIABLE;
+    CAllocator::destruct(string);
+    destroy_count(&count);
+  } else if (options->mode == BACKBONE) {
+    if (problem.cardinality_count > 0 || problem.xor_system) {
+      error("--backbone does not support cardinality or xor constraints\n");
+      return err;
+    }
+
+    problem.limits = options->limits;
+    BackboneStats stats;
+    ProblemResult result;
+    if (find_backbone(&problem, print_backbone_literal, renumbering, &stats, &result)) return err;
+    printf("c Backbone: %d literals, %d solver calls, time: %.3fs\n", stats.literal_count, stats.solve_count,
+           current_time() - problem.start_time);
+
+    if (result == SAT) {
+      printf("s SATISFIABLE\n");
+      exit_code = EXIT_SATISFIABLE;
+    } else if (result == UNSAT) {
+      printf("s UNSATISFIABLE\n");
+      exit_code = EXIT_UNSATISFIABLE;
+    } else {
+      printf("s UNKNOWN\n");
+      exit_code = EXIT_UNKNOWN;
+    }
+  } else if (options->mode == CORE || options->mode == MUS) {
+    if (problem.cardinality_count > 0 || problem.xor_system) {
+      error("--core and --mus do not support cardinality or xor constraints\n");
+      return err;
+    }
+
+    f64 start_time       = current_time();
+    problem.limits       = options->limits;
+    u8 *in_core          = CAllocator::construct<u8>(problem.clause_count);
+    u64 *values          = CAllocator::construct<u64>(words_per_clause(&problem));
+    CoreStats stats;
+    ProblemResult result = find_core(&problem, options->mode == MUS, in_core, values, &stats);
+    if (result == SAT) {
+      exit_code = print_solution(options, out, values, model_variable_count);
+    } else if (result == UNSAT) {
+      printf("c Core: %d of %d clauses (%s), %d solver calls, %d found by model rotation, time: %.3fs\n",
+             stats.clause_count, problem.clause_count, stats.minimal ? "minimal" : "not minimal", stats.solve_count,
+             stats.rotation_count, current_time() - start_time);
+      write_clause_numbers(out, in_core, problem.clause_count);
+      flush(out);
+      // Like the model file, a core file which cannot be written turns the answer into an error
+      bool core_written = !options->core_path || !write_core(options->core_path, &problem, in_core, stats.clause_count);
+      if (!core_written) error("Could not write core file %s\n", options->core_path);
+      printf("s UNSATISFIABLE\n");
+      exit_code = core_written ? EXIT_UNSATISFIABLE : i32(err);
+    } else {
+      printf("s UNKNOWN\n");
+      exit_code = EXIT_UNKNOWN;
+    }
+    CAllocator::destruct(values);
+    CAllocator::destruct(in_core);
   } else {
-    fprintf(stderr, "%d", problem.split_count);
-    printf("UNSAT\n");
-    return err;
+    Enumeration enumeration;
+    if (options->mode == ENUMERATE) {
+      enumeration.writer          = out;
+      enumeration.renumbering     = renumbering;
+      enumeration.values          = model_values;
+      enumeration.variable_count  = model_variable_count;
+      enumeration.model_count     = 0;
+      enumeration.model_limit     = options->model_limit;
+      problem.model_callback      = print_model;
+      problem.model_callback_data = &enumeration;
+    }
+
+    // A missing checkpoint is not an error so that a job can always be started with --resume
+    Checkpoint checkpoint;
+    if (options->resume && access(options->checkpoint_path, F_OK)) {
+      printf("c No checkpoint at %s, starting a new search\n", options->checkpoint_path);
+    } else if (options->resume) {
+      if (read_checkpoint(&checkpoint, &problem, options->checkpoint_path)) return err;
+      printf("c Resuming from %s at %ld decisions\n", options->checkpoint_path, checkpoint.header.split_count);
+      problem.resume_checkpoint = &checkpoint;
+    }
+    if (options->checkpoint_path) {
+      problem.checkpointer = init_checkpointer(&problem, options->checkpoint_path, options->checkpoint_interval);
+    }
+
+    problem.limits  = options->limits;
+    running_problem = &problem;
+    signal(SIGINT, handle_interrupt);
+    signal(SIGTERM, handle_interrupt);
+
+    ProblemResult result;
+    if (options->mode == HYBRID) {
+      result = hybrid_solve(&problem, options->local_search);
+    } else {
+      result = dpll_solve(&problem);
+    }
+
+    running_problem = nullptr;
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    flush(out);
+
+    if (problem.checkpointer) destroy_checkpointer(problem.checkpointer);
+    if (problem.resume_checkpoint) {
+      bool replay_failed = checkpoint.replay_failed;
+      destroy_checkpoint(&checkpoint);
+      if (replay_failed) {
+        error("Checkpoint %s does not match the search of this problem\n", options->checkpoint_path);
+        return err;
+      }
+    }
+
+    print_statistics(&problem);
+    if (options->mode == ENUMERATE) printf("c Models: %ld\n", enumeration.model_count);
+
+    if (result == SAT && options->mode == ENUMERATE) {
+      printf("s SATISFIABLE\n");
+      exit_code = EXIT_SATISFIABLE;
+    } else if (result == SAT) {
+      exit_code = print_solution(options, out, input_values(renumbering, problem.assigned_values, model_values),
+                                 model_variable_count);
+    } else if (result == UNKNOWN) {
+      // The deepest partial assignment is only a hint so it is written as a comment. Like the model it leaves out the
+      // auxiliary variables
+      u64 *best_values     = input_values(renumbering, problem.best_values, model_values);
+      u64 *best_unassigned = input_values(renumbering, problem.best_unassigned, model_unassigned);
+      i32 assigned_count   = 0;
+      for (i32 i = 1; i < model_variable_count; ++i) {
+        if (!(best_unassigned[i >> 6] & get_word_mask(i))) ++assigned_count;
+      }
+      if (problem.out_of_memory) printf("c Search ran out of memory\n");
+      printf("c Best partial assignment: %d/%d variables\n", assigned_count, model_variable_count - 1);
+      write_model(out, "c v", best_values, best_unassigned, model_variable_count);
+      flush(out);
+      printf("s UNKNOWN\n");
+      exit_code = EXIT_UNKNOWN;
+    } else {
+      printf("s UNSATISFIABLE\n");
+      exit_code = EXIT_UNSATISFIABLE;
+    }
+    cache_result(cache_path, hash, exit_code, input_values(renumbering, problem.assigned_values, model_values),
+                 model_variable_count);
+  }
+
+  destroy_writer(out);
+  if (renumbering) {
+    destroy_renumbering(renumbering);
+    CAllocator::destruct(model_values);
+    CAllocator::destruct(model_unassigned);
+  }
+  if (perf_counters) {
+    print_perf_report(perf_counters, problem.propagation_count);
+    destroy_perf_counters(perf_counters);
   }
+  fflush(stdout);
+  return exit_code;
 }
 
 } // namespace sat
 
 i32 main(i32 argc, char **argv) {
-  if (argc != 3) {
-    error("Expected usage: sat [r|t|p] [input].cnf\n");
+  sat::Options options;
+  if (sat::parse_options(&options, argc, argv)) {
+    error("Expected usage: sat [r|t|p|l|m|j|a] "
+          "[--sls|--hybrid|--count|--enumerate[=N]|--backbone|--core|--mus|--batch] [--flips=N] [--threads=N] "
+          "[--seed=N] [--double-lookahead] [--detect-amo] [--detect-xor] [--symmetry] [--bva] [--renumber] [--perf] "
+          "[--model=PATH] [--core-output=PATH] [--cache=PATH] [--checkpoint=PATH [--checkpoint-interval=S] [--resume]] "
+          "[--time-limit=S] [--decisions=N] [--conflicts=N] [--propagations=N] [--memory-limit=MB] [input].cnf\n");
     return err;
   }
 
-  if (sat::solve(argv[2], argv[1][0])) return err;
-
-  return ok;
+  return sat::solve(&options);
 }
-
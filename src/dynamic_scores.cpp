@@ -0,0 +1,209 @@
+#include "dynamic_scores.hpp"
+
+#include "heap.hpp"
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+// Every clause which is not satisfied contributes the weight of its live length to each of its literals. Weights are
+// fixed point so that undoing a change restores the exact same sums
+struct DynamicScores {
+  i32 word_count;
+  bool moms;
+
+  // Number of literals which have not been propagated yet, only maintained while the clause is not satisfied
+  i32 *clause_length;
+  u8 *clause_satisfied;
+
+  // Weight of a clause by its live length
+  u64 *length_weight;
+  i32 max_length;
+
+  // Sum of the weights of the unsatisfied clauses containing the literal, indexed by make_literal
+  u64 *literal_score;
+
+  // Changes of the clauses as clause_id << 1 | satisfied, with the trail size at the start of every decision level
+  i64 *trail;
+  size trail_size;
+  size trail_capacity;
+  size *trail_marks;
+
+  // Holds every unassigned variable and possibly some assigned ones which are skipped when popped
+  VariableHeap heap;
+};
+
+// Jeroslow-Wang weighs a clause of length L with 2^-L, MOMS with 16^-L so that the shortest clauses dominate
+const i32 weight_scale_bits = 40;
+
+u64 length_weight_for(bool moms, i32 length) {
+  i32 shift = weight_scale_bits - (moms ? 4 * length : length);
+  return shift > 0 ? 1ul << shift : 1;
+}
+
+void update_variable_score(DynamicScores *scores, i32 variable_id) {
+  f64 positive = f64(scores->literal_score[make_literal(variable_id, false)]) / f64(1ul << weight_scale_bits);
+  f64 negative = f64(scores->literal_score[make_literal(variable_id, true)]) / f64(1ul << weight_scale_bits);
+
+  // Two-sided Jeroslow-Wang sums both literals, MOMS also rewards variables which are balanced between both
+  if (scores->moms) {
+    scores->heap.score[variable_id] = 1024 * positive * negative + positive + negative;
+  } else {
+    scores->heap.score[variable_id] = positive + negative;
+  }
+  heap_update(&scores->heap, variable_id);
+}
+
+// Moves every literal of the clause from the weight before to the weight after
+void shift_clause_weight(Problem *problem, DynamicScores *scores, i32 clause_id, u64 before, u64 after) {
+  u64 *clause_words   = problem->clauses + size(clause_id) * scores->word_count;
+  u64 *negation_words = problem->negations + size(clause_id) * scores->word_count;
+  for (i32 i = 0; i < scores->word_count; ++i) {
+    u64 clause_word = clause_words[i];
+    while (clause_word) {
+      i32 offset      = __builtin_ctzll(clause_word);
+      i32 variable_id = (i << 6) | offset;
+      i32 literal     = make_literal(variable_id, negation_words[i] & (1ul << offset));
+
+      scores->literal_score[literal] = scores->literal_score[literal] - before + after;
+      update_variable_score(scores, variable_id);
+
+      clause_word &= clause_word - 1;
+    }
+  }
+}
+
+u64 clause_weight(DynamicScores *scores, i32 clause_id) {
+  return scores->length_weight[scores->clause_length[clause_id]];
+}
+
+DynamicScores *init_dynamic_scores(Problem *problem) {
+  auto *scores       = CAllocator::construct<DynamicScores>();
+  scores->word_count = words_per_clause(problem);
+  scores->moms       = problem->splitting_heuristic == MOMS;
+
+  scores->clause_length    = CAllocator::construct<i32>(problem->clause_count);
+  scores->clause_satisfied = CAllocator::construct<u8>(problem->clause_count);
+  scores->literal_score    = CAllocator::construct<u64>(2 * problem->variable_count);
+  memset(scores->literal_score, 0, usize(2 * problem->variable_count) * sizeof(u64));
+
+  // A clause can shrink once per literal and be satisfied once between two backtracks over it
+  scores->max_length     = 0;
+  scores->trail_capacity = problem->clause_count;
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    i32 length    = 0;
+    bool satisfied = false;
+    for (i32 k = 0; k < scores->word_count; ++k) {
+      u64 clause_word = problem->clauses[size(i) * scores->word_count + k];
+      u64 negate_word = problem->negations[size(i) * scores->word_count + k];
+      length += __builtin_popcountll(clause_word & problem->unassigned[k]);
+      satisfied |= (clause_word & ~problem->unassigned[k] & (problem->assigned_values[k] ^ negate_word)) != 0;
+    }
+    scores->clause_length[i]    = length;
+    scores->clause_satisfied[i] = satisfied;
+    scores->trail_capacity += length;
+    if (length > scores->max_length) scores->max_length = length;
+  }
+
+  scores->length_weight = CAllocator::construct<u64>(scores->max_length + 1);
+  for (i32 i = 0; i <= scores->max_length; ++i) {
+    scores->length_weight[i] = length_weight_for(scores->moms, i);
+  }
+
+  scores->trail       = CAllocator::construct<i64>(scores->trail_capacity);
+  scores->trail_size  = 0;
+  scores->trail_marks = CAllocator::construct<size>(problem->variable_count);
+
+  // Scores are complete before the heap is filled so that it is built in one pass
+  scores->heap = init_heap(problem->variable_count);
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    if (!scores->clause_satisfied[i]) shift_clause_weight(problem, scores, i, 0, clause_weight(scores, i));
+  }
+  for (i32 i = 0; i < scores->word_count; ++i) {
+    u64 unassigned = problem->unassigned[i];
+    while (unassigned) {
+      heap_insert(&scores->heap, (i << 6) | __builtin_ctzll(unassigned));
+      unassigned &= unassigned - 1;
+    }
+  }
+
+  return scores;
+}
+
+void destroy_dynamic_scores(DynamicScores *scores) {
+  CAllocator::destruct(scores->clause_length);
+  CAllocator::destruct(scores->clause_satisfied);
+  CAllocator::destruct(scores->length_weight);
+  CAllocator::destruct(scores->literal_score);
+  CAllocator::destruct(scores->trail);
+  CAllocator::destruct(scores->trail_marks);
+  destroy_heap(&scores->heap);
+  CAllocator::destruct(scores);
+}
+
+// Lengths of satisfied clauses are left alone, they are correct again by the time the satisfaction is undone
+void shrink_clause(Problem *problem, i32 clause_id) {
+  DynamicScores *scores = problem->dynamic_scores;
+  if (scores->clause_satisfied[clause_id]) return;
+
+  assert(scores->clause_length[clause_id] > 0);
+  assert(scores->trail_size < scores->trail_capacity);
+  u64 before = clause_weight(scores, clause_id);
+  --scores->clause_length[clause_id];
+  scores->trail[scores->trail_size++] = i64(clause_id) << 1;
+  shift_clause_weight(problem, scores, clause_id, before, clause_weight(scores, clause_id));
+}
+
+void satisfy_scored_clause(Problem *problem, i32 clause_id) {
+  DynamicScores *scores = problem->dynamic_scores;
+  if (scores->clause_satisfied[clause_id]) return;
+
+  assert(scores->trail_size < scores->trail_capacity);
+  scores->clause_satisfied[clause_id] = 1;
+  scores->trail[scores->trail_size++] = (i64(clause_id) << 1) | 1;
+  shift_clause_weight(problem, scores, clause_id, clause_weight(scores, clause_id), 0);
+}
+
+void push_score_level(Problem *problem, i32 level) {
+  problem->dynamic_scores->trail_marks[level] = problem->dynamic_scores->trail_size;
+}
+
+void backtrack_dynamic_scores(Problem *problem, u64 *previous_unassigned, i32 level) {
+  DynamicScores *scores = problem->dynamic_scores;
+  while (scores->trail_size > scores->trail_marks[level]) {
+    i64 entry     = scores->trail[--scores->trail_size];
+    i32 clause_id = i32(entry >> 1);
+    if (entry & 1) {
+      scores->clause_satisfied[clause_id] = 0;
+      shift_clause_weight(problem, scores, clause_id, 0, clause_weight(scores, clause_id));
+    } else {
+      u64 before = clause_weight(scores, clause_id);
+      ++scores->clause_length[clause_id];
+      shift_clause_weight(problem, scores, clause_id, before, clause_weight(scores, clause_id));
+    }
+  }
+
+  for (i32 i = 0; i < scores->word_count; ++i) {
+    u64 unassigned_again = previous_unassigned[i] & ~problem->unassigned[i];
+    while (unassigned_again) {
+      i32 variable_id = (i << 6) | __builtin_ctzll(unassigned_again);
+      if (!heap_contains(&scores->heap, variable_id)) heap_insert(&scores->heap, variable_id);
+      unassigned_again &= unassigned_again - 1;
+    }
+  }
+}
+
+i32 dynamic_decision(Problem *problem, bool *value) {
+  DynamicScores *scores = problem->dynamic_scores;
+  while (scores->heap.size > 0) {
+    i32 variable_id = heap_pop(&scores->heap);
+    if (!(problem->unassigned[variable_id >> 6] & get_word_mask(variable_id))) continue;
+
+    *value = scores->literal_score[make_literal(variable_id, false)] >
+             scores->literal_score[make_literal(variable_id, true)];
+    return variable_id;
+  }
+  return -1;
+}
+
+} // namespace sat
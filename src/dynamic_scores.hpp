@@ -0,0 +1,32 @@
+#ifndef DYNAMIC_SCORES_HPP
+#define DYNAMIC_SCORES_HPP
+
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+// Builds the live clause lengths and literal scores of the MOMS and JEROSLOW_WANG heuristics from the current
+// assignment. Only dpll_solve drives the search which keeps them up to date
+DynamicScores *init_dynamic_scores(Problem *problem);
+
+void destroy_dynamic_scores(DynamicScores *scores);
+
+// Called by unit propagation when the literal of the clause watched by the propagated variable became false or true
+void shrink_clause(Problem *problem, i32 clause_id);
+void satisfy_scored_clause(Problem *problem, i32 clause_id);
+
+// Marks the start of the decision level which is pushed next
+void push_score_level(Problem *problem, i32 level);
+
+// Undoes every change since the start of level and puts the variables which are unassigned again (assigned in
+// problem->unassigned but not in previous_unassigned) back into the heap. Called before the snapshot is restored
+void backtrack_dynamic_scores(Problem *problem, u64 *previous_unassigned, i32 level);
+
+// Pops the unassigned variable with the best score and the value which satisfies its heavier literal, -1 when every
+// variable is assigned
+i32 dynamic_decision(Problem *problem, bool *value);
+
+} // namespace sat
+
+#endif
@@ -0,0 +1,98 @@
+#include "features.hpp"
+
+#include <cstring>
+
+namespace sat {
+
+// Inner node of the decision tree which continues with below if the feature is smaller than the threshold and with
+// above otherwise. Negative children are leaves with the configuration -1 - child
+struct DecisionNode {
+  Feature feature;
+  f64 threshold;
+  i32 below;
+  i32 above;
+};
+
+const AutoConfig auto_configs[] = {
+    {TWO_CLAUSE, true, "balanced polarities, xor detection"},
+    {POLARITY, false, "mostly binary clauses"},
+    {LOOKAHEAD, false, "random-like with low degree"},
+    {MOMS, false, "random-like with high degree"},
+};
+
+// The thresholds are hand-picked, not fitted: they separate the ksat, pigeonhole, coloring, parity and riddle families
+// of test_gen by the heuristic which was fastest on them. Xor encodings have exactly balanced polarities (a low mean
+// skew is not enough, dense random formulas get there as well), the structured families are mostly binary at-most-one
+// clauses where polarity wins, and on random formulas lookahead wins until the clauses get long and dense enough for
+// MOMS
+const DecisionNode decision_tree[] = {
+    {BALANCED_FRACTION, 0.9, 1, -1},
+    {BINARY_FRACTION, 0.5, 2, -2},
+    {MEAN_DEGREE, 30, -3, -4},
+};
+
+FormulaFeatures init_features() {
+  FormulaFeatures features;
+  memset(&features, 0, sizeof(features));
+  return features;
+}
+
+void count_formula_clause_lengths(FormulaFeatures *features, Formula *formula) {
+  i32 length = 0;
+  for (size i = 0; i < formula->literal_count; ++i) {
+    if (formula->literals[i]) {
+      ++length;
+    } else {
+      count_clause_length(features, length);
+      length = 0;
+    }
+  }
+}
+
+void finish_features(FormulaFeatures *features, Problem *problem) {
+  assert(problem->splitting_heuristic == POLARITY);
+
+  i32 *true_count  = problem->polarity_info.true_count;
+  i32 *false_count = problem->polarity_info.false_count;
+
+  i64 literal_count   = 0;
+  i32 occurring_count = 0;
+  i32 balanced_count  = 0;
+  for (i32 i = 1; i < problem->variable_count; ++i) {
+    i32 degree = true_count[i] + false_count[i];
+    if (degree == 0) continue;
+
+    ++occurring_count;
+    literal_count += degree;
+    balanced_count += true_count[i] == false_count[i];
+  }
+
+  f64 *values               = features->values;
+  values[BINARY_FRACTION]   = f64(features->length_histogram[2]) / f64(problem->clause_count);
+  values[BALANCED_FRACTION] = occurring_count ? f64(balanced_count) / occurring_count : 0;
+  values[MEAN_DEGREE]       = occurring_count ? f64(literal_count) / occurring_count : 0;
+}
+
+void print_features(FormulaFeatures *features) {
+  f64 *values = features->values;
+  printf("c Features: binary %.2f, balanced %.2f, degree %.1f\n", values[BINARY_FRACTION], values[BALANCED_FRACTION],
+         values[MEAN_DEGREE]);
+
+  printf("c Clause lengths:");
+  for (i32 i = 1; i <= max_histogram_clause_length; ++i) {
+    if (features->length_histogram[i] == 0) continue;
+    printf(" %d%s:%ld", i, i == max_histogram_clause_length ? "+" : "", features->length_histogram[i]);
+  }
+  printf("\n");
+}
+
+AutoConfig select_configuration(FormulaFeatures *features) {
+  i32 node = 0;
+  while (node >= 0) {
+    const DecisionNode *decision = &decision_tree[node];
+    node = features->values[decision->feature] < decision->threshold ? decision->below : decision->above;
+  }
+  return auto_configs[-1 - node];
+}
+
+} // namespace sat
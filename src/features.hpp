@@ -0,0 +1,52 @@
+#ifndef FEATURES_HPP
+#define FEATURES_HPP
+
+#include "formula.hpp"
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+// Clauses of this length and longer share the last bucket of the histogram
+const i32 max_histogram_clause_length = 8;
+
+// Only the features which the decision tree looks at are computed
+enum Feature {
+  BINARY_FRACTION,
+  BALANCED_FRACTION, // Occurring variables with as many positive as negative occurrences
+  MEAN_DEGREE,       // Occurrences of the occurring variables
+  FEATURE_COUNT,
+};
+
+// Statistics gathered while a formula is loaded. The clause lengths are counted by the parser and everything else is
+// taken from the polarity counts of the POLARITY heuristic, so nothing has to be read again
+struct FormulaFeatures {
+  i64 length_histogram[max_histogram_clause_length + 1];
+  f64 values[FEATURE_COUNT];
+};
+
+FormulaFeatures init_features();
+
+inline void count_clause_length(FormulaFeatures *features, i32 length) {
+  ++features->length_histogram[length < max_histogram_clause_length ? length : max_histogram_clause_length];
+}
+
+void count_formula_clause_lengths(FormulaFeatures *features, Formula *formula);
+
+// Needs a problem which was loaded with the POLARITY heuristic
+void finish_features(FormulaFeatures *features, Problem *problem);
+
+void print_features(FormulaFeatures *features);
+
+struct AutoConfig {
+  SplittingHeuristic splitting_heuristic;
+  bool xor_detection;
+  cstr description;
+};
+
+// Looks the features up in a small decision tree with hand-picked thresholds for the benchmark families of test_gen
+AutoConfig select_configuration(FormulaFeatures *features);
+
+} // namespace sat
+
+#endif
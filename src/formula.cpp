@@ -0,0 +1,320 @@
+#include "formula.hpp"
+
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+const char binary_magic[4] = {'S', 'A', 'T', 'B'};
+
+Formula init_formula(i32 variable_count) {
+  Formula formula;
+  formula.variable_count   = variable_count;
+  formula.clause_count     = 0;
+  formula.literal_count    = 0;
+  formula.literal_capacity = 256;
+  formula.literals         = CAllocator::construct<i32>(formula.literal_capacity);
+  return formula;
+}
+
+void destroy_formula(Formula *formula) { CAllocator::destruct(formula->literals); }
+
+Result reserve_literals(Formula *formula, size capacity) {
+  if (capacity <= formula->literal_capacity) return ok;
+
+  size new_capacity = formula->literal_capacity;
+  while (new_capacity < capacity) new_capacity *= 2;
+
+  i32 *literals = CAllocator::construct<i32>(new_capacity);
+  if (!literals) return err;
+  memcpy(literals, formula->literals, usize(formula->literal_count) * sizeof(i32));
+  CAllocator::destruct(formula->literals);
+  formula->literals         = literals;
+  formula->literal_capacity = new_capacity;
+  return ok;
+}
+
+void push_literal(Formula *formula, i32 literal) {
+  assert(literal >= -formula->variable_count && literal <= formula->variable_count);
+
+  if (formula->literal_count == formula->literal_capacity && reserve_literals(formula, formula->literal_count + 1)) {
+    panic("Could not grow the formula to %ld literals\n", formula->literal_capacity * 2);
+  }
+
+  formula->literals[formula->literal_count++] = literal;
+  if (literal == 0) ++formula->clause_count;
+}
+
+void push_clause(Formula *formula, i32 *literals, i32 size) {
+  for (i32 i = 0; i < size; ++i) {
+    push_literal(formula, literals[i]);
+  }
+  push_literal(formula, 0);
+}
+
+i32 normalize_clause(i32 *literals, i32 size, i8 *marks) {
+  i32 clause_size = 0;
+  bool tautology  = false;
+  for (i32 i = 0; i < size; ++i) {
+    i32 literal = literals[i];
+    i32 sign    = literal > 0 ? 1 : -1;
+    i8 *mark    = &marks[abs(literal)];
+    if (*mark == sign) continue;
+    if (*mark == -sign) {
+      tautology = true;
+      continue;
+    }
+    *mark                   = i8(sign);
+    literals[clause_size++] = literal;
+  }
+  for (i32 i = 0; i < clause_size; ++i) {
+    marks[abs(literals[i])] = 0;
+  }
+  return tautology ? -1 : clause_size;
+}
+
+void normalize_formula(Formula *formula) {
+  i8 *marks = CAllocator::construct<i8>(formula->variable_count + 1);
+  memset(marks, 0, usize(formula->variable_count + 1));
+
+  // Clauses only get shorter, so every clause is moved down over the literals removed before it
+  size literal_count    = 0;
+  size start            = 0;
+  formula->clause_count = 0;
+  for (size i = 0; i < formula->literal_count; ++i) {
+    if (formula->literals[i]) continue;
+
+    i32 *clause = formula->literals + literal_count;
+    memmove(clause, formula->literals + start, usize(i - start) * sizeof(i32));
+    i32 clause_size = normalize_clause(clause, i32(i - start), marks);
+    if (clause_size >= 0) {
+      literal_count += clause_size;
+      formula->literals[literal_count++] = 0;
+      ++formula->clause_count;
+    }
+    start = i + 1;
+  }
+  formula->literal_count = literal_count;
+
+  CAllocator::destruct(marks);
+}
+
+Result write_dimacs(Formula *formula, cstr path, cstr comment) {
+  FILE *file = fopen(path, "w");
+  if (!file) return err;
+  Writer *writer = init_writer(file);
+
+  if (comment) {
+    append_string(writer, "c ");
+    append_string(writer, comment);
+    append_string(writer, "\n");
+  }
+  append_string(writer, "p cnf ");
+  append_int(writer, formula->variable_count);
+  append_string(writer, " ");
+  append_int(writer, formula->clause_count);
+  append_string(writer, "\n");
+
+  for (size i = 0; i < formula->literal_count; ++i) {
+    append_int(writer, formula->literals[i]);
+    append_string(writer, formula->literals[i] ? " " : "\n");
+  }
+
+  Result result = destroy_writer(writer);
+  if (fclose(file) || result) return err;
+  return ok;
+}
+
+Result write_binary(Formula *formula, cstr path) {
+  FILE *file = fopen(path, "wb");
+  if (!file) return err;
+
+  i32 counts[2]     = {formula->variable_count, formula->clause_count};
+  i64 literal_count = formula->literal_count;
+  usize literal_bytes = usize(formula->literal_count) * sizeof(i32);
+  bool written        = fwrite(binary_magic, 1, sizeof(binary_magic), file) == sizeof(binary_magic);
+  written             = written && fwrite(counts, sizeof(i32), 2, file) == 2;
+  written             = written && fwrite(&literal_count, sizeof(i64), 1, file) == 1;
+  written             = written && fwrite(formula->literals, 1, literal_bytes, file) == literal_bytes;
+
+  if (fclose(file) || !written) return err;
+  return ok;
+}
+
+bool is_binary_formula(File *file) {
+  return file->length >= size(sizeof(binary_magic)) && !memcmp(file->data, binary_magic, sizeof(binary_magic));
+}
+
+Result read_binary(Formula *formula, File *file) {
+  size header_size = size(sizeof(binary_magic) + 2 * sizeof(i32) + sizeof(i64));
+  if (!is_binary_formula(file) || file->length < header_size) return err;
+
+  i32 counts[2];
+  i64 literal_count;
+  memcpy(counts, file->data + sizeof(binary_magic), sizeof(counts));
+  memcpy(&literal_count, file->data + sizeof(binary_magic) + sizeof(counts), sizeof(literal_count));
+
+  // Checked against the file length by division so that a corrupt count cannot overflow
+  size literal_bytes = file->length - header_size;
+  if (counts[0] <= 0 || counts[0] > max_variable_count || counts[1] < 0 || literal_count < 0 ||
+      literal_bytes % size(sizeof(i32)) || literal_bytes / size(sizeof(i32)) != literal_count) {
+    return err;
+  }
+
+  formula->variable_count   = counts[0];
+  formula->clause_count     = counts[1];
+  formula->literal_count    = literal_count;
+  formula->literal_capacity = literal_count ? literal_count : 1;
+  formula->literals         = CAllocator::construct<i32>(formula->literal_capacity);
+  if (!formula->literals) return err;
+  memcpy(formula->literals, file->data + header_size, usize(literal_bytes));
+
+  // The clause count of the header has to match the clause terminators
+  i32 clause_count = 0;
+  bool valid       = true;
+  for (size i = 0; i < formula->literal_count; ++i) {
+    i32 literal = formula->literals[i];
+    if (literal < -formula->variable_count || literal > formula->variable_count) valid = false;
+    if (literal == 0 && ++clause_count < 0) valid = false;
+  }
+  if (clause_count != formula->clause_count) valid = false;
+  if (formula->literal_count && formula->literals[formula->literal_count - 1] != 0) valid = false;
+
+  if (!valid) {
+    destroy_formula(formula);
+    return err;
+  }
+  return ok;
+}
+
+bool is_dimacs_whitespace(char ch) { return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r'; }
+
+// Skips whitespace and reads a signed 32-bit number. Returns false if there is none
+bool read_dimacs_number(File *file, size *position, i64 *number) {
+  size i = *position;
+  while (i < file->length && is_dimacs_whitespace(file->data[i])) ++i;
+
+  bool negative = i < file->length && file->data[i] == '-';
+  if (negative) ++i;
+  if (i >= file->length || file->data[i] < '0' || file->data[i] > '9') return false;
+
+  i64 value = 0;
+  while (i < file->length && file->data[i] >= '0' && file->data[i] <= '9') {
+    value = 10 * value + (file->data[i++] - '0');
+    if (value > INT32_MAX) return false;
+  }
+  *number   = negative ? -value : value;
+  *position = i;
+  return true;
+}
+
+Result read_dimacs(Formula *formula, File *file) {
+  size i = 0;
+  for (;;) {
+    while (i < file->length && is_dimacs_whitespace(file->data[i])) ++i;
+    if (i >= file->length) return err;
+    if (file->data[i] != 'c') break;
+    while (i < file->length && file->data[i] != '\n') ++i;
+  }
+
+  // The format of the problem line is not checked, like in the parser of the driver
+  if (file->data[i++] != 'p') return err;
+  while (i < file->length && is_dimacs_whitespace(file->data[i])) ++i;
+  while (i < file->length && !is_dimacs_whitespace(file->data[i])) ++i;
+
+  i64 variable_count;
+  i64 clause_count;
+  if (!read_dimacs_number(file, &i, &variable_count) || !read_dimacs_number(file, &i, &clause_count)) return err;
+  if (variable_count <= 0 || variable_count > max_variable_count || clause_count < 0) return err;
+
+  *formula        = init_formula(i32(variable_count));
+  i64 literal     = 0;
+  i32 clause_size = 0;
+  bool valid      = true;
+  while (valid && read_dimacs_number(file, &i, &literal)) {
+    valid = literal >= -variable_count && literal <= variable_count && (literal || clause_size > 0);
+    if (!valid) break;
+    push_literal(formula, i32(literal));
+    clause_size = literal ? clause_size + 1 : 0;
+  }
+
+  // The last clause may end without 0 and the clauses may be followed by a '%' line
+  if (valid && clause_size > 0) push_literal(formula, 0);
+  while (i < file->length && is_dimacs_whitespace(file->data[i])) ++i;
+  if (i < file->length && file->data[i] != '%') valid = false;
+  if (formula->clause_count != clause_count) valid = false;
+
+  if (!valid) {
+    destroy_formula(formula);
+    return err;
+  }
+  return ok;
+}
+
+Result load_problem(Problem *problem, Formula *formula, SplittingHeuristic splitting_heuristic) {
+  if (formula->variable_count <= 0 || formula->clause_count <= 0) {
+    error("Problem must have more than 0 variables and clauses\n");
+    return err;
+  }
+  if (formula->variable_count > max_variable_count) {
+    error("Problem cannot have more than %d variables\n", max_variable_count);
+    return err;
+  }
+
+  if (init_problem(problem, formula->variable_count, formula->clause_count, splitting_heuristic)) {
+    error("Could not allocate the clause matrix of %d clauses\n", formula->clause_count);
+    return err;
+  }
+
+  i32 clause_id   = 0;
+  i32 clause_size = 0;
+  for (size i = 0; i < formula->literal_count; ++i) {
+    i32 literal = formula->literals[i];
+    if (literal) {
+      add_variable(problem, clause_id, literal < 0 ? -literal : literal, literal < 0);
+      ++clause_size;
+      continue;
+    }
+
+    if (clause_size == 0) {
+      error("Empty clause%d\n", clause_id);
+      destroy_problem(problem);
+      return err;
+    }
+    if (clause_size == 1) {
+      i32 variable_id = abs(formula->literals[i - 1]);
+      bool value      = formula->literals[i - 1] > 0;
+
+      // Repeated unit clauses are only assigned once. A unit clause which contradicts an earlier one is falsified at
+      // the root, so dpll_solve reports the formula as unsatisfiable
+      if (problem->unassigned[variable_id >> 6] & get_word_mask(variable_id)) set_variable(problem, variable_id, value);
+    }
+
+    ++clause_id;
+    clause_size = 0;
+  }
+
+  return ok;
+}
+
+Formula formula_from_problem(Problem *problem) {
+  Formula formula = init_formula(problem->variable_count - 1);
+  i32 word_count  = words_per_clause(problem);
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    u64 *clause_words   = problem->clauses + size(i) * word_count;
+    u64 *negation_words = problem->negations + size(i) * word_count;
+    for (i32 k = 0; k < word_count; ++k) {
+      u64 clause_word = clause_words[k];
+      while (clause_word) {
+        i32 offset      = __builtin_ctzll(clause_word);
+        i32 variable_id = (k << 6) | offset;
+        push_literal(&formula, negation_words[k] & (1ul << offset) ? -variable_id : variable_id);
+        clause_word &= clause_word - 1;
+      }
+    }
+    push_literal(&formula, 0);
+  }
+  return formula;
+}
+
+} // namespace sat
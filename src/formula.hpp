@@ -0,0 +1,67 @@
+#ifndef FORMULA_HPP
+#define FORMULA_HPP
+
+#include "general.hpp"
+#include "os.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+// Clauses in DIMACS form before they are loaded into the clause matrix: signed variable ids with every clause
+// terminated by 0 in one flat buffer
+struct Formula {
+  i32 variable_count;
+  i32 clause_count;
+
+  size literal_count;
+  size literal_capacity;
+  i32 *literals;
+};
+
+Formula init_formula(i32 variable_count);
+
+void destroy_formula(Formula *formula);
+
+// Grows the literal buffer to hold at least capacity literals. Returns err and keeps the buffer if it cannot be
+// allocated
+Result reserve_literals(Formula *formula, size capacity);
+
+// Appends a literal to the current clause, 0 ends the clause. Panics if the buffer cannot grow, so the library
+// reserves the literals of a clause first
+void push_literal(Formula *formula, i32 literal);
+
+void push_clause(Formula *formula, i32 *literals, i32 size);
+
+// Merges duplicate literals of the clause in place and returns the new size, or -1 if the clause contains both
+// polarities of a variable. marks has an entry for every variable id of the clause and is all 0 before and after
+i32 normalize_clause(i32 *literals, i32 size, i8 *marks);
+
+// Normalizes every clause of the formula in place and removes the tautologies
+void normalize_formula(Formula *formula);
+
+// Writes the formula in DIMACS with an optional comment line
+Result write_dimacs(Formula *formula, cstr path, cstr comment);
+
+// Binary format: the magic bytes, the 32-bit variable and clause counts and the 64-bit literal count followed by the
+// flat literal buffer of 32-bit literals, all little endian
+Result write_binary(Formula *formula, cstr path);
+
+bool is_binary_formula(File *file);
+
+Result read_binary(Formula *formula, File *file);
+
+// Reads a DIMACS file with nothing but comments, the problem line and clauses, for tools which do not need the parser
+// of the driver with its cardinality and xor lines
+Result read_dimacs(Formula *formula, File *file);
+
+// Builds the problem from the formula the same way the DIMACS parser does. Conflicting unit clauses are not an error,
+// the formula is unsatisfiable. Returns err for an empty formula or clause and when the problem cannot be allocated
+Result load_problem(Problem *problem, Formula *formula, SplittingHeuristic splitting_heuristic);
+
+// Reads the clauses back out of the clause matrix, unit clauses included. Cardinality constraints are not clauses and
+// are left out
+Formula formula_from_problem(Problem *problem);
+
+} // namespace sat
+
+#endif
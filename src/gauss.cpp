@@ -0,0 +1,283 @@
+#include "gauss.hpp"
+
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+// Xor constraints as rows over GF(2) in the same word layout as the clause matrix. Row operations never change the
+// solutions of the system, so the rows are reduced in place during the search and nothing has to be undone when the
+// search backtracks. Every row with a pivot owns that column: no other row contains the pivot variable
+struct XorSystem {
+  i32 word_count;
+  i32 row_count;
+  i32 row_capacity;
+  u64 *rows;
+  u8 *parities;
+  i32 *pivots;
+};
+
+// Largest xor which is recovered from clauses, it takes 2^(size - 1) clauses
+const i32 max_detected_xor_size = 6;
+
+XorSystem *init_xor_system(Problem *problem) {
+  auto *system         = CAllocator::construct<XorSystem>();
+  system->word_count   = words_per_clause(problem);
+  system->row_count    = 0;
+  system->row_capacity = 0;
+  system->rows         = nullptr;
+  system->parities     = nullptr;
+  system->pivots       = nullptr;
+  return system;
+}
+
+void destroy_xor_system(XorSystem *system) {
+  CAllocator::destruct(system->rows);
+  CAllocator::destruct(system->parities);
+  CAllocator::destruct(system->pivots);
+  CAllocator::destruct(system);
+}
+
+void grow_xor_rows(XorSystem *system) {
+  i32 capacity   = system->row_capacity ? system->row_capacity * 2 : 16;
+  auto *rows     = CAllocator::construct<u64>(size(capacity) * system->word_count);
+  auto *parities = CAllocator::construct<u8>(capacity);
+  auto *pivots   = CAllocator::construct<i32>(capacity);
+  if (!rows) panic("Could not grow the xor matrix to %d rows\n", capacity);
+  if (system->row_count) {
+    memcpy(rows, system->rows, usize(system->row_count) * usize(system->word_count) * sizeof(u64));
+    memcpy(parities, system->parities, usize(system->row_count));
+    memcpy(pivots, system->pivots, usize(system->row_count) * sizeof(i32));
+  }
+  CAllocator::destruct(system->rows);
+  CAllocator::destruct(system->parities);
+  CAllocator::destruct(system->pivots);
+  system->rows         = rows;
+  system->parities     = parities;
+  system->pivots       = pivots;
+  system->row_capacity = capacity;
+}
+
+Result add_xor(Problem *problem, i32 *variable_ids, i32 size, bool parity) {
+  if (!problem->xor_system) problem->xor_system = init_xor_system(problem);
+  XorSystem *system = problem->xor_system;
+  if (system->row_count == system->row_capacity) grow_xor_rows(system);
+
+  u64 *row = system->rows + i64(system->row_count) * system->word_count;
+  memset(row, 0, usize(system->word_count) * sizeof(u64));
+  for (i32 i = 0; i < size; ++i) {
+    assert(variable_ids[i] > 0 && variable_ids[i] < problem->variable_count);
+    row[variable_ids[i] >> 6] ^= get_word_mask(variable_ids[i]);
+  }
+
+  bool empty = true;
+  for (i32 i = 0; i < system->word_count; ++i) {
+    if (row[i]) empty = false;
+  }
+  if (empty) return parity ? err : ok;
+
+  system->parities[system->row_count] = parity;
+  system->pivots[system->row_count]   = -1;
+  ++system->row_count;
+  return ok;
+}
+
+struct ClauseKey {
+  u64 hash;
+  i32 clause_id;
+};
+
+i32 compare_clause_keys(const void *left, const void *right) {
+  auto *a = (const ClauseKey *)left;
+  auto *b = (const ClauseKey *)right;
+  if (a->hash != b->hash) return a->hash < b->hash ? -1 : 1;
+  return a->clause_id < b->clause_id ? -1 : a->clause_id > b->clause_id;
+}
+
+// Adds the xor of one group of clauses over the same variables if the group has every sign pattern of one parity.
+// Returns the number of constraints created
+i32 detect_xor_group(Problem *problem, i32 *group, i32 group_size) {
+  i32 word_count = words_per_clause(problem);
+  u64 *variables = problem->clauses + size(group[0]) * word_count;
+  i32 variable_ids[max_detected_xor_size];
+  i32 length = 0;
+  for (i32 i = 0; i < word_count; ++i) {
+    u64 word = variables[i];
+    while (word) {
+      variable_ids[length++] = (i << 6) | __builtin_ctzll(word);
+      word &= word - 1;
+    }
+  }
+  if (group_size < 1 << (length - 1)) return 0;
+
+  // Pattern bit k is set when the k-th variable is negated in the clause
+  u64 seen = 0;
+  for (i32 i = 0; i < group_size; ++i) {
+    u64 *negations = problem->negations + size(group[i]) * word_count;
+    i32 pattern    = 0;
+    for (i32 k = 0; k < length; ++k) {
+      if (negations[variable_ids[k] >> 6] & get_word_mask(variable_ids[k])) pattern |= 1 << k;
+    }
+    seen |= 1ul << pattern;
+  }
+
+  // A clause rules out the assignment which makes all of its literals false, the negated variables are true in it. So
+  // the clauses with an odd number of negations together rule out every assignment with odd parity
+  i32 created = 0;
+  for (i32 odd = 0; odd < 2; ++odd) {
+    bool complete = true;
+    for (i32 pattern = 0; pattern < 1 << length; ++pattern) {
+      if ((__builtin_popcount(u32(pattern)) & 1) == odd && !(seen & (1ul << pattern))) complete = false;
+    }
+    if (!complete) continue;
+
+    debug("Xor over %d variables from %d clauses\n", length, group_size);
+    if (add_xor(problem, variable_ids, length, !odd)) panic("Unexpected empty xor\n");
+    ++created;
+  }
+  return created;
+}
+
+i32 detect_xors(Problem *problem) {
+  i32 word_count = words_per_clause(problem);
+  auto *keys     = CAllocator::construct<ClauseKey>(problem->clause_count);
+  i32 key_count  = 0;
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    u64 *clause = problem->clauses + size(i) * word_count;
+    i32 length  = 0;
+    u64 hash    = 0xCBF29CE484222325;
+    for (i32 k = 0; k < word_count; ++k) {
+      length += __builtin_popcountll(clause[k]);
+      hash = (hash ^ clause[k]) * 0x100000001B3;
+      hash ^= hash >> 29;
+    }
+    if (length >= 2 && length <= max_detected_xor_size) keys[key_count++] = {hash, i};
+  }
+  qsort(keys, usize(key_count), sizeof(ClauseKey), compare_clause_keys);
+
+  // Runs of equal hashes are split into groups of identical variable sets
+  i32 *group  = CAllocator::construct<i32>(key_count + 1);
+  u8 *grouped = CAllocator::construct<u8>(key_count + 1);
+  i32 created = 0;
+  memset(grouped, 0, usize(key_count));
+  for (i32 start = 0, end = 0; start < key_count; start = end) {
+    while (end < key_count && keys[end].hash == keys[start].hash) ++end;
+
+    for (i32 i = start; i < end; ++i) {
+      if (grouped[i]) continue;
+
+      u64 *reference = problem->clauses + size(keys[i].clause_id) * word_count;
+      i32 group_size = 0;
+      for (i32 k = i; k < end; ++k) {
+        u64 *clause = problem->clauses + size(keys[k].clause_id) * word_count;
+        if (grouped[k] || memcmp(clause, reference, usize(word_count) * sizeof(u64))) continue;
+
+        grouped[k]          = 1;
+        group[group_size++] = keys[k].clause_id;
+      }
+      created += detect_xor_group(problem, group, group_size);
+    }
+  }
+
+  CAllocator::destruct(grouped);
+  CAllocator::destruct(group);
+  CAllocator::destruct(keys);
+  return created;
+}
+
+bool row_parity(u64 *row, u64 *values, i32 word_count) {
+  i32 count = 0;
+  for (i32 i = 0; i < word_count; ++i) {
+    count += __builtin_popcountll(row[i] & values[i]);
+  }
+  return count & 1;
+}
+
+// Values of unassigned variables are stale after backtracking so they are masked out
+bool assigned_row_parity(Problem *problem, u64 *row, i32 word_count) {
+  i32 count = 0;
+  for (i32 i = 0; i < word_count; ++i) {
+    count += __builtin_popcountll(row[i] & ~problem->unassigned[i] & problem->assigned_values[i]);
+  }
+  return count & 1;
+}
+
+// Picks an unassigned variable of the row as its pivot and removes it from every other row. The new pivot cannot be
+// the pivot of another row since those columns are already clear in this row
+void eliminate_row(XorSystem *system, i32 row_index, u64 *unassigned) {
+  u64 *row = system->rows + size(row_index) * system->word_count;
+
+  i32 pivot = -1;
+  for (i32 i = 0; i < system->word_count && pivot < 0; ++i) {
+    u64 free = row[i] & unassigned[i];
+    if (free) pivot = (i << 6) | __builtin_ctzll(free);
+  }
+  system->pivots[row_index] = pivot;
+  if (pivot < 0) return;
+
+  i32 pivot_word = pivot >> 6;
+  u64 pivot_mask = get_word_mask(pivot);
+  for (i32 r = 0; r < system->row_count; ++r) {
+    u64 *other = system->rows + size(r) * system->word_count;
+    if (r == row_index || !(other[pivot_word] & pivot_mask)) continue;
+
+    for (i32 i = 0; i < system->word_count; ++i) {
+      other[i] ^= row[i];
+    }
+    system->parities[r] ^= system->parities[row_index];
+  }
+}
+
+UnitPropagateResult propagate_xors(Problem *problem) {
+  XorSystem *system = problem->xor_system;
+
+  // Rows whose pivot has been assigned since the last call need a new one
+  for (i32 r = 0; r < system->row_count; ++r) {
+    i32 pivot = system->pivots[r];
+    if (pivot < 0 || !(problem->unassigned[pivot >> 6] & get_word_mask(pivot))) {
+      eliminate_row(system, r, problem->unassigned);
+    }
+  }
+
+  // Every pivot only occurs in its own row, so a combination of rows has at least as many unassigned variables as it
+  // has rows with a pivot. Conflicts and implications of the whole system are therefore visible in single rows
+  for (i32 r = 0; r < system->row_count; ++r) {
+    u64 *row  = system->rows + size(r) * system->word_count;
+    i32 pivot = system->pivots[r];
+    if (pivot < 0) {
+      if (assigned_row_parity(problem, row, system->word_count) != bool(system->parities[r])) {
+        debug("  - Conflict from xor%d\n", r);
+        problem->propagation_stack_size = 0;
+        return CONFLICT;
+      }
+      continue;
+    }
+
+    bool single = true;
+    for (i32 i = 0; i < system->word_count && single; ++i) {
+      u64 free = row[i] & problem->unassigned[i];
+      if (i == pivot >> 6) free &= ~get_word_mask(pivot);
+      if (free) single = false;
+    }
+    if (!single) continue;
+
+    bool value = bool(system->parities[r]) != assigned_row_parity(problem, row, system->word_count);
+    debug("  - From xor%d: x%d = %d\n", r, pivot, value);
+    set_variable(problem, pivot, value);
+  }
+
+  return NO_CONFLICT;
+}
+
+bool xors_satisfied(Problem *problem, u64 *values) {
+  XorSystem *system = problem->xor_system;
+  if (!system) return true;
+
+  for (i32 r = 0; r < system->row_count; ++r) {
+    u64 *row = system->rows + size(r) * system->word_count;
+    if (row_parity(row, values, system->word_count) != bool(system->parities[r])) return false;
+  }
+  return true;
+}
+
+} // namespace sat
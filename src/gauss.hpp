@@ -0,0 +1,28 @@
+#ifndef GAUSS_HPP
+#define GAUSS_HPP
+
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+// Adds the constraint x_1 xor ... xor x_size = parity. Variables which appear twice cancel out. Returns err if the
+// constraint is empty and can never be satisfied
+Result add_xor(Problem *problem, i32 *variable_ids, i32 size, bool parity);
+
+// Finds sets of clauses over the same variables which contain every sign pattern of one parity (the CNF encoding of a
+// xor) and adds them as xor constraints. The clauses are kept. Returns the number of constraints created
+i32 detect_xors(Problem *problem);
+
+// Brings the xor rows into reduced form over the unassigned variables and assigns every variable which is implied by a
+// single row. Called by unit propagation whenever the clauses have nothing left to propagate
+UnitPropagateResult propagate_xors(Problem *problem);
+
+// Checks every xor constraint against a complete assignment
+bool xors_satisfied(Problem *problem, u64 *values);
+
+void destroy_xor_system(XorSystem *system);
+
+} // namespace sat
+
+#endif
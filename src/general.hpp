@@ -71,12 +71,34 @@ inline void error(cstr msg, ...) {
   abort();
 }
 
-inline i32 fast_random(i32 upper) {
-  static u32 seed = 0x765;
-  seed            = 98612337607 * seed + 19827359879823;
-  return upper * ((f64)seed / (1ull << 32));
+// Random number generator (xorshift64*) with explicit state so that every thread can own one
+struct Random {
+  u64 state;
+};
+
+inline Random init_random(u64 seed) {
+  // Scramble the seed with splitmix64 so that consecutive seeds give unrelated streams
+  seed += 0x9E3779B97F4A7C15;
+  seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9;
+  seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EB;
+  seed ^= seed >> 31;
+
+  Random random;
+  random.state = seed ? seed : 1;
+  return random;
 }
 
+inline u64 next_random(Random *random) {
+  random->state ^= random->state >> 12;
+  random->state ^= random->state << 25;
+  random->state ^= random->state >> 27;
+  return random->state * 0x2545F4914F6CDD1D;
+}
+
+inline i32 random_range(Random *random, i32 upper) { return i32((next_random(random) >> 32) * u64(upper) >> 32); }
+
+inline f64 random_unit(Random *random) { return f64(next_random(random) >> 11) * (1.0 / f64(1ull << 53)); }
+
 #if DEBUG
 #define DEFINE_MEM u32 check;
 #define INIT_MEM check = 0xFEEEFEEE;
@@ -0,0 +1,363 @@
+#include "generator.hpp"
+
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+GeneratorConfig default_generator_config(InstanceFamily family) {
+  GeneratorConfig config;
+  config.family = family;
+  switch (family) {
+  case RANDOM_KSAT:
+    config.size  = 50;
+    config.width = 3;
+    config.ratio = 4.26;
+    break;
+  case PIGEONHOLE:
+    config.size  = 8;
+    config.width = 0;
+    config.ratio = 0;
+    break;
+  case COLORING:
+    config.size  = 100;
+    config.width = 3;
+    config.ratio = 2.3;
+    break;
+  case PARITY:
+    config.size  = 20;
+    config.width = 2;
+    config.ratio = 0;
+    break;
+  case RIDDLE:
+    config.size  = 5;
+    config.width = 0;
+    config.ratio = 3;
+    break;
+  }
+  return config;
+}
+
+Result validate_generator_config(GeneratorConfig *config) {
+  if (config->size <= 0) return err;
+
+  switch (config->family) {
+  case RANDOM_KSAT:
+    // Unit clauses would have to be deduplicated to be loaded
+    if (config->width < 2 || config->width > config->size || config->ratio <= 0) return err;
+    break;
+  case PIGEONHOLE: break;
+  case COLORING: {
+    f64 max_edges = 0.5 * f64(config->size) * f64(config->size - 1);
+    if (config->width <= 0 || config->ratio < 0 || config->ratio * config->size > max_edges) return err;
+    break;
+  }
+  case PARITY:
+    if (config->size < 2 || config->width <= 0) return err;
+    break;
+  case RIDDLE:
+    if (config->size < 2 || config->ratio < 0) return err;
+    break;
+  }
+  return ok;
+}
+
+cstr family_name(InstanceFamily family) {
+  switch (family) {
+  case RANDOM_KSAT: return "ksat";
+  case PIGEONHOLE: return "pigeonhole";
+  case COLORING: return "coloring";
+  case PARITY: return "parity";
+  case RIDDLE: return "riddle";
+  }
+  return "unknown";
+}
+
+void shuffle(Random *random, i32 *values, i32 count) {
+  for (i32 i = count - 1; i > 0; --i) {
+    i32 k     = random_range(random, i + 1);
+    i32 temp  = values[i];
+    values[i] = values[k];
+    values[k] = temp;
+  }
+}
+
+i32 clause_count_for(GeneratorConfig *config) { return i32(f64(config->size) * config->ratio + 0.5); }
+
+Formula generate_ksat(GeneratorConfig *config, Random *random) {
+  Formula formula = init_formula(config->size);
+
+  i32 *clause = CAllocator::construct<i32>(config->width);
+  for (i32 i = clause_count_for(config); i > 0; --i) {
+    for (i32 k = 0; k < config->width; ++k) {
+      // Ensure no duplicates in a clause
+      i32 variable_id;
+      bool duplicate;
+      do {
+        variable_id = random_range(random, config->size) + 1;
+        duplicate   = false;
+        for (i32 l = 0; l < k && !duplicate; ++l) {
+          duplicate = abs(clause[l]) == variable_id;
+        }
+      } while (duplicate);
+
+      clause[k] = next_random(random) & 1 ? -variable_id : variable_id;
+    }
+    push_clause(&formula, clause, config->width);
+  }
+  CAllocator::destruct(clause);
+
+  return formula;
+}
+
+Formula generate_pigeonhole(GeneratorConfig *config) {
+  i32 holes   = config->size;
+  i32 pigeons = holes + 1;
+  auto var    = [holes](i32 pigeon, i32 hole) { return pigeon * holes + hole + 1; };
+
+  Formula formula = init_formula(pigeons * holes);
+
+  // Every pigeon sits in some hole
+  for (i32 p = 0; p < pigeons; ++p) {
+    for (i32 h = 0; h < holes; ++h) {
+      push_literal(&formula, var(p, h));
+    }
+    push_literal(&formula, 0);
+  }
+
+  // No two pigeons share a hole
+  for (i32 h = 0; h < holes; ++h) {
+    for (i32 p = 0; p < pigeons; ++p) {
+      for (i32 q = p + 1; q < pigeons; ++q) {
+        i32 clause[2] = {-var(p, h), -var(q, h)};
+        push_clause(&formula, clause, 2);
+      }
+    }
+  }
+
+  return formula;
+}
+
+i32 compare_packed_edges(const void *left, const void *right) {
+  u64 a = *(const u64 *)left;
+  u64 b = *(const u64 *)right;
+  return a < b ? -1 : a > b;
+}
+
+Formula generate_coloring(GeneratorConfig *config, Random *random) {
+  i32 vertices = config->size;
+  i32 colors   = config->width;
+  auto var     = [colors](i32 vertex, i32 color) { return vertex * colors + color + 1; };
+
+  // Draw distinct edges (u < v packed into one word) by sorting away the duplicates until enough are left
+  i32 edge_count = clause_count_for(config);
+  u64 *edges     = CAllocator::construct<u64>(edge_count > 0 ? edge_count : 1);
+  i32 unique     = 0;
+  while (unique < edge_count) {
+    for (i32 i = unique; i < edge_count; ++i) {
+      i32 u, v;
+      do {
+        u = random_range(random, vertices);
+        v = random_range(random, vertices);
+      } while (u == v);
+      if (u > v) {
+        i32 temp = u;
+        u        = v;
+        v        = temp;
+      }
+      edges[i] = (u64(u) << 32) | u64(v);
+    }
+
+    qsort(edges, usize(edge_count), sizeof(u64), compare_packed_edges);
+    unique = edge_count ? 1 : 0;
+    for (i32 i = 1; i < edge_count; ++i) {
+      if (edges[i] != edges[unique - 1]) edges[unique++] = edges[i];
+    }
+  }
+
+  Formula formula = init_formula(vertices * colors);
+
+  // Every vertex has exactly one color
+  for (i32 v = 0; v < vertices; ++v) {
+    for (i32 c = 0; c < colors; ++c) {
+      push_literal(&formula, var(v, c));
+    }
+    push_literal(&formula, 0);
+
+    for (i32 c = 0; c < colors; ++c) {
+      for (i32 d = c + 1; d < colors; ++d) {
+        i32 clause[2] = {-var(v, c), -var(v, d)};
+        push_clause(&formula, clause, 2);
+      }
+    }
+  }
+
+  // Adjacent vertices have different colors
+  for (i32 i = 0; i < edge_count; ++i) {
+    i32 u = i32(edges[i] >> 32);
+    i32 v = i32(edges[i] & 0xFFFFFFFF);
+    for (i32 c = 0; c < colors; ++c) {
+      i32 clause[2] = {-var(u, c), -var(v, c)};
+      push_clause(&formula, clause, 2);
+    }
+  }
+  CAllocator::destruct(edges);
+
+  return formula;
+}
+
+Formula generate_parity(GeneratorConfig *config, Random *random) {
+  i32 variables = config->size;
+  i32 chains    = config->width;
+
+  // Every chain introduces one auxiliary variable per link: t_i = t_(i - 1) xor x_i with t_1 = x_1
+  Formula formula = init_formula(variables + chains * (variables - 1));
+
+  i32 *order         = CAllocator::construct<i32>(variables);
+  i32 next_auxiliary = variables + 1;
+  for (i32 c = 0; c < chains; ++c) {
+    for (i32 i = 0; i < variables; ++i) {
+      order[i] = i + 1;
+    }
+    shuffle(random, order, variables);
+
+    i32 previous = order[0];
+    for (i32 i = 1; i < variables; ++i) {
+      i32 a = previous;
+      i32 b = order[i];
+      i32 t = next_auxiliary++;
+
+      i32 clauses[4][3] = {{-t, a, b}, {-t, -a, -b}, {t, -a, b}, {t, a, -b}};
+      for (i32 k = 0; k < 4; ++k) {
+        push_clause(&formula, clauses[k], 3);
+      }
+      previous = t;
+    }
+
+    i32 parity = next_random(random) & 1 ? previous : -previous;
+    push_clause(&formula, &parity, 1);
+  }
+  CAllocator::destruct(order);
+
+  return formula;
+}
+
+Formula generate_riddle(GeneratorConfig *config, Random *random) {
+  // Every one of the size attributes (color, nationality, pet...) has size values and every item (attribute value) is
+  // in exactly one of the size houses
+  i32 houses = config->size;
+  i32 items  = houses * houses;
+  auto var   = [houses](i32 item, i32 house) { return item * houses + house + 1; };
+
+  // Hidden solution which all clues agree with
+  i32 *house_of = CAllocator::construct<i32>(items);
+  i32 *item_at  = CAllocator::construct<i32>(items);
+  u8 *placed    = CAllocator::construct<u8>(items);
+  memset(placed, 0, usize(items));
+  for (i32 a = 0; a < houses; ++a) {
+    i32 *houses_of_attribute = house_of + a * houses;
+    for (i32 v = 0; v < houses; ++v) {
+      houses_of_attribute[v] = v;
+    }
+    shuffle(random, houses_of_attribute, houses);
+    for (i32 v = 0; v < houses; ++v) {
+      item_at[a * houses + houses_of_attribute[v]] = a * houses + v;
+    }
+  }
+
+  Formula formula = init_formula(items * houses);
+
+  for (i32 item = 0; item < items; ++item) {
+    for (i32 h = 0; h < houses; ++h) {
+      push_literal(&formula, var(item, h));
+    }
+    push_literal(&formula, 0);
+
+    for (i32 m = 0; m < houses; ++m) {
+      for (i32 n = m + 1; n < houses; ++n) {
+        i32 clause[2] = {-var(item, m), -var(item, n)};
+        push_clause(&formula, clause, 2);
+      }
+    }
+  }
+
+  // A house has at most one value of every attribute
+  for (i32 h = 0; h < houses; ++h) {
+    for (i32 a = 0; a < houses; ++a) {
+      for (i32 m = 0; m < houses; ++m) {
+        for (i32 n = m + 1; n < houses; ++n) {
+          i32 clause[2] = {-var(a * houses + m, h), -var(a * houses + n, h)};
+          push_clause(&formula, clause, 2);
+        }
+      }
+    }
+  }
+
+  for (i32 i = clause_count_for(config); i > 0; --i) {
+    i32 item  = random_range(random, items);
+    i32 house = house_of[item];
+
+    // Clue about another attribute in the same or a neighbouring house of the hidden solution
+    i32 other_attribute = (item / houses + 1 + random_range(random, houses - 1)) % houses;
+    i32 kind            = random_range(random, 4);
+    if (kind == 2 && house + 1 == houses) kind = 0;
+
+    i32 other;
+    switch (kind) {
+    case 0: other = item_at[other_attribute * houses + house]; break;
+    case 1: {
+      // Next to
+      i32 neighbour = house == 0 ? 1 : house + 1 == houses ? house - 1 : house + (next_random(random) & 1 ? 1 : -1);
+      other         = item_at[other_attribute * houses + neighbour];
+      break;
+    }
+    case 2: other = item_at[other_attribute * houses + house + 1]; break; // Left of
+    default: {
+      // The item is in its house, given only once as a unit clause
+      if (placed[item]) continue;
+      placed[item] = 1;
+
+      i32 clause = var(item, house);
+      push_clause(&formula, &clause, 1);
+      continue;
+    }
+    }
+
+    for (i32 m = 0; m < houses; ++m) {
+      for (i32 n = 0; n < houses; ++n) {
+        bool allowed = false;
+        switch (kind) {
+        case 0: allowed = m == n; break;
+        case 1: allowed = m - n == 1 || n - m == 1; break;
+        case 2: allowed = m + 1 == n; break;
+        }
+        if (allowed) continue;
+
+        i32 clause[2] = {-var(item, m), -var(other, n)};
+        push_clause(&formula, clause, 2);
+      }
+    }
+  }
+
+  CAllocator::destruct(placed);
+  CAllocator::destruct(item_at);
+  CAllocator::destruct(house_of);
+
+  return formula;
+}
+
+Formula generate_instance(GeneratorConfig *config, u64 seed) {
+  assert(!validate_generator_config(config));
+
+  Random random = init_random(seed);
+  switch (config->family) {
+  case RANDOM_KSAT: return generate_ksat(config, &random);
+  case PIGEONHOLE: return generate_pigeonhole(config);
+  case COLORING: return generate_coloring(config, &random);
+  case PARITY: return generate_parity(config, &random);
+  case RIDDLE: return generate_riddle(config, &random);
+  }
+  panic("Unknown instance family %d\n", config->family);
+}
+
+} // namespace sat
@@ -0,0 +1,42 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include "formula.hpp"
+#include "general.hpp"
+
+namespace sat {
+
+enum InstanceFamily {
+  RANDOM_KSAT,
+  PIGEONHOLE,
+  COLORING,
+  PARITY,
+  RIDDLE,
+};
+
+// The meaning of the parameters depends on the family:
+// - RANDOM_KSAT: size variables, clauses of width literals, ratio clauses per variable
+// - PIGEONHOLE: size holes and size + 1 pigeons, always unsatisfiable
+// - COLORING: size vertices, width colors, ratio edges per vertex
+// - PARITY: width xor chains over the same size variables in random orders, satisfiable iff all parities agree
+// - RIDDLE: size houses with size attributes of size values, ratio clues per house taken from a hidden solution
+struct GeneratorConfig {
+  InstanceFamily family;
+  i32 size;
+  i32 width;
+  f64 ratio;
+};
+
+GeneratorConfig default_generator_config(InstanceFamily family);
+
+// Returns err if the family cannot be generated with the given parameters
+Result validate_generator_config(GeneratorConfig *config);
+
+// Instances only depend on the config and the seed so they can be generated on any thread in any order
+Formula generate_instance(GeneratorConfig *config, u64 seed);
+
+cstr family_name(InstanceFamily family);
+
+} // namespace sat
+
+#endif
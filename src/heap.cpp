@@ -0,0 +1,105 @@
+#include "heap.hpp"
+
+#include "mem.hpp"
+
+namespace sat {
+
+VariableHeap init_heap(i32 variable_count) {
+  VariableHeap heap;
+  heap.size     = 0;
+  heap.capacity = variable_count;
+  heap.heap     = CAllocator::construct<i32>(variable_count);
+  heap.index    = CAllocator::construct<i32>(variable_count);
+  heap.score    = CAllocator::construct<f64>(variable_count);
+  for (i32 i = 0; i < variable_count; ++i) {
+    heap.index[i] = -1;
+    heap.score[i] = 0;
+  }
+  return heap;
+}
+
+void destroy_heap(VariableHeap *heap) {
+  CAllocator::destruct(heap->heap);
+  CAllocator::destruct(heap->index);
+  CAllocator::destruct(heap->score);
+}
+
+bool heap_before(VariableHeap *heap, i32 left, i32 right) {
+  return heap->score[left] > heap->score[right] || (heap->score[left] == heap->score[right] && left > right);
+}
+
+void sift_up(VariableHeap *heap, i32 position) {
+  i32 variable_id = heap->heap[position];
+  while (position > 0) {
+    i32 parent = (position - 1) >> 1;
+    if (!heap_before(heap, variable_id, heap->heap[parent])) break;
+
+    heap->heap[position]              = heap->heap[parent];
+    heap->index[heap->heap[position]] = position;
+    position                          = parent;
+  }
+  heap->heap[position]     = variable_id;
+  heap->index[variable_id] = position;
+}
+
+void sift_down(VariableHeap *heap, i32 position) {
+  i32 variable_id = heap->heap[position];
+  for (;;) {
+    i32 child = 2 * position + 1;
+    if (child >= heap->size) break;
+    if (child + 1 < heap->size && heap_before(heap, heap->heap[child + 1], heap->heap[child])) ++child;
+    if (!heap_before(heap, heap->heap[child], variable_id)) break;
+
+    heap->heap[position]              = heap->heap[child];
+    heap->index[heap->heap[position]] = position;
+    position                          = child;
+  }
+  heap->heap[position]     = variable_id;
+  heap->index[variable_id] = position;
+}
+
+void heap_insert(VariableHeap *heap, i32 variable_id) {
+  assert(!heap_contains(heap, variable_id));
+  assert(heap->size < heap->capacity);
+
+  heap->heap[heap->size] = variable_id;
+  sift_up(heap, heap->size++);
+}
+
+i32 heap_pop(VariableHeap *heap) {
+  assert(heap->size > 0);
+
+  i32 top          = heap->heap[0];
+  heap->index[top] = -1;
+  if (--heap->size > 0) {
+    heap->heap[0] = heap->heap[heap->size];
+    sift_down(heap, 0);
+  }
+  return top;
+}
+
+void heap_update(VariableHeap *heap, i32 variable_id) {
+  i32 position = heap->index[variable_id];
+  if (position < 0) return;
+
+  sift_up(heap, position);
+  sift_down(heap, heap->index[variable_id]);
+}
+
+void heap_build(VariableHeap *heap, i32 count) {
+  assert(count <= heap->capacity);
+
+  for (i32 i = 0; i < heap->size; ++i) {
+    heap->index[heap->heap[i]] = -1;
+  }
+  heap->size = count;
+  for (i32 i = 0; i < count; ++i) {
+    heap->heap[i]  = i;
+    heap->index[i] = i;
+  }
+  for (i32 i = (count >> 1) - 1; i >= 0; --i) {
+    sift_down(heap, i);
+  }
+}
+
+} // namespace sat
@@ -0,0 +1,39 @@
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+#include "general.hpp"
+
+namespace sat {
+
+// Binary max heap of variables ordered by score, ties are broken by the larger variable id. Every variable knows its
+// position so that its score can be changed in place while it is in the heap
+struct VariableHeap {
+  i32 size;
+  i32 capacity;
+  i32 *heap;
+
+  // Position of every variable in heap or -1
+  i32 *index;
+  f64 *score;
+};
+
+// Scores start at 0 and the heap starts empty
+VariableHeap init_heap(i32 variable_count);
+
+void destroy_heap(VariableHeap *heap);
+
+inline bool heap_contains(VariableHeap *heap, i32 variable_id) { return heap->index[variable_id] >= 0; }
+
+void heap_insert(VariableHeap *heap, i32 variable_id);
+
+i32 heap_pop(VariableHeap *heap);
+
+// Restores the heap order after the score of the variable changed, does nothing when it is not in the heap
+void heap_update(VariableHeap *heap, i32 variable_id);
+
+// Replaces the content of the heap with every variable from 0 to count - 1 in linear time
+void heap_build(VariableHeap *heap, i32 count);
+
+} // namespace sat
+
+#endif
@@ -0,0 +1,283 @@
+#include "libsat.h"
+
+#include "formula.hpp"
+#include "general.hpp"
+#include "mem.hpp"
+#include "os.hpp"
+#include "solver.hpp"
+#include <climits>
+#include <cstring>
+
+using namespace sat;
+
+struct sat_solver {
+  Formula formula;
+  bool has_empty_clause;
+
+  SplittingHeuristic splitting_heuristic;
+  u64 seed;
+  SolveLimits limits;
+
+  // Problem of the running sat_solve. has_problem and interrupt_requested are only accessed atomically
+  Problem problem;
+  bool has_problem;
+  bool interrupt_requested;
+
+  i32 result;
+  i32 model_variable_count;
+  u64 *model;
+  sat_stats stats;
+
+  // Sign of every variable in the clause being added (or in the unit clauses while solving), 0 when absent
+  i8 *marks;
+  i32 mark_capacity;
+
+  i32 *clause;
+  i32 clause_capacity;
+};
+
+// Both keep the old buffer and return err if the new one cannot be allocated
+Result reserve_marks(sat_solver *solver, i32 variable_count) {
+  if (variable_count < solver->mark_capacity) return ok;
+
+  i32 capacity = solver->mark_capacity;
+  while (capacity <= variable_count) capacity *= 2;
+
+  i8 *marks = CAllocator::construct<i8>(capacity);
+  if (!marks) return err;
+  memset(marks, 0, usize(capacity));
+  CAllocator::destruct(solver->marks);
+  solver->marks         = marks;
+  solver->mark_capacity = capacity;
+  return ok;
+}
+
+Result reserve_clause(sat_solver *solver, i32 size) {
+  if (size <= solver->clause_capacity) return ok;
+
+  i32 *clause = CAllocator::construct<i32>(size);
+  if (!clause) return err;
+  CAllocator::destruct(solver->clause);
+  solver->clause          = clause;
+  solver->clause_capacity = size;
+  return ok;
+}
+
+// Unit clauses which contradict each other make the formula unsatisfiable before the clause matrix is even built
+bool has_conflicting_units(sat_solver *solver) {
+  Formula *formula = &solver->formula;
+
+  // The second pass clears the marks again
+  bool conflict = false;
+  for (i32 pass = 0; pass < 2; ++pass) {
+    size start = 0;
+    for (size i = 0; i < formula->literal_count; ++i) {
+      if (formula->literals[i]) continue;
+
+      if (i - start == 1) {
+        i32 literal = formula->literals[start];
+        i32 sign    = literal > 0 ? 1 : -1;
+        i8 *mark    = &solver->marks[abs(literal)];
+        if (pass == 0) {
+          if (*mark == -sign) conflict = true;
+          *mark = i8(sign);
+        } else {
+          *mark = 0;
+        }
+      }
+      start = i + 1;
+    }
+  }
+  return conflict;
+}
+
+sat_solver *sat_create(void) {
+  auto *solver = CAllocator::construct<sat_solver>();
+  if (!solver) return nullptr;
+
+  solver->formula             = init_formula(0);
+  solver->has_empty_clause    = false;
+  solver->splitting_heuristic = TWO_CLAUSE;
+  solver->seed                = 0x765;
+  solver->limits              = {0, 0, 0, 0, 0};
+  solver->has_problem         = false;
+  solver->interrupt_requested = false;
+
+  solver->result               = SAT_RESULT_UNKNOWN;
+  solver->model_variable_count = 0;
+  solver->model                = nullptr;
+  solver->stats                = {0, 0, 0, 0};
+
+  solver->mark_capacity   = 64;
+  solver->marks           = CAllocator::construct<i8>(solver->mark_capacity);
+  solver->clause_capacity = 64;
+  solver->clause          = CAllocator::construct<i32>(solver->clause_capacity);
+  if (!solver->formula.literals || !solver->marks || !solver->clause) {
+    sat_destroy(solver);
+    return nullptr;
+  }
+  memset(solver->marks, 0, usize(solver->mark_capacity));
+
+  return solver;
+}
+
+void sat_destroy(sat_solver *solver) {
+  if (!solver) return;
+
+  destroy_formula(&solver->formula);
+  CAllocator::destruct(solver->model);
+  CAllocator::destruct(solver->marks);
+  CAllocator::destruct(solver->clause);
+  CAllocator::destruct(solver);
+}
+
+int sat_set_heuristic(sat_solver *solver, sat_heuristic heuristic) {
+  if (!solver) return SAT_ERROR_INVALID_ARGUMENT;
+
+  switch (heuristic) {
+  case SAT_HEURISTIC_RANDOM: solver->splitting_heuristic = RANDOM; break;
+  case SAT_HEURISTIC_TWO_CLAUSE: solver->splitting_heuristic = TWO_CLAUSE; break;
+  case SAT_HEURISTIC_POLARITY: solver->splitting_heuristic = POLARITY; break;
+  case SAT_HEURISTIC_LOOKAHEAD: solver->splitting_heuristic = LOOKAHEAD; break;
+  case SAT_HEURISTIC_MOMS: solver->splitting_heuristic = MOMS; break;
+  case SAT_HEURISTIC_JEROSLOW_WANG: solver->splitting_heuristic = JEROSLOW_WANG; break;
+  default: return SAT_ERROR_INVALID_ARGUMENT;
+  }
+  return SAT_OK;
+}
+
+int sat_set_seed(sat_solver *solver, unsigned long long seed) {
+  if (!solver) return SAT_ERROR_INVALID_ARGUMENT;
+
+  solver->seed = seed;
+  return SAT_OK;
+}
+
+int sat_set_limits(sat_solver *solver, const sat_limits *limits) {
+  if (!solver || !limits) return SAT_ERROR_INVALID_ARGUMENT;
+  if (limits->time_limit < 0 || limits->decision_limit < 0 || limits->conflict_limit < 0 ||
+      limits->propagation_limit < 0 || limits->memory_limit < 0) {
+    return SAT_ERROR_INVALID_ARGUMENT;
+  }
+
+  solver->limits.time_limit        = limits->time_limit;
+  solver->limits.decision_limit    = limits->decision_limit;
+  solver->limits.conflict_limit    = limits->conflict_limit;
+  solver->limits.propagation_limit = limits->propagation_limit;
+  solver->limits.memory_limit      = limits->memory_limit;
+  return SAT_OK;
+}
+
+int sat_add_clause(sat_solver *solver, const int *literals, int size) {
+  if (!solver || size < 0 || (size > 0 && !literals)) return SAT_ERROR_INVALID_ARGUMENT;
+
+  i32 max_variable = 0;
+  for (i32 i = 0; i < size; ++i) {
+    if (literals[i] == 0 || literals[i] == INT_MIN || abs(literals[i]) > max_variable_count) {
+      return SAT_ERROR_INVALID_LITERAL;
+    }
+    if (abs(literals[i]) > max_variable) max_variable = abs(literals[i]);
+  }
+  if (reserve_marks(solver, max_variable) || reserve_clause(solver, size)) return SAT_ERROR_OUT_OF_MEMORY;
+
+  // Merge duplicate literals and drop the clause if it contains both polarities of a variable
+  memcpy(solver->clause, literals, usize(size) * sizeof(i32));
+  i32 clause_size = normalize_clause(solver->clause, size, solver->marks);
+  if (clause_size < 0) return SAT_OK;
+  if (clause_size == 0) {
+    solver->has_empty_clause = true;
+    return SAT_OK;
+  }
+
+  if (solver->formula.clause_count == INT_MAX) return SAT_ERROR_INVALID_ARGUMENT;
+  // push_clause panics if the formula cannot grow
+  if (reserve_literals(&solver->formula, solver->formula.literal_count + clause_size + 1)) {
+    return SAT_ERROR_OUT_OF_MEMORY;
+  }
+  if (max_variable > solver->formula.variable_count) solver->formula.variable_count = max_variable;
+  push_clause(&solver->formula, solver->clause, clause_size);
+  return SAT_OK;
+}
+
+int sat_solve(sat_solver *solver) {
+  if (!solver) return SAT_ERROR_INVALID_ARGUMENT;
+
+  f64 start_time               = current_time();
+  solver->result               = SAT_RESULT_UNKNOWN;
+  solver->model_variable_count = solver->formula.variable_count;
+  solver->stats                = {0, 0, 0, 0};
+
+  CAllocator::destruct(solver->model);
+  i32 word_count = (solver->formula.variable_count >> 6) + 1;
+  solver->model  = CAllocator::construct<u64>(word_count);
+  if (!solver->model) return SAT_ERROR_OUT_OF_MEMORY;
+  memset(solver->model, 0, usize(word_count) * sizeof(u64));
+
+  if (solver->has_empty_clause || has_conflicting_units(solver)) {
+    solver->result = SAT_RESULT_UNSAT;
+  } else if (solver->formula.clause_count == 0) {
+    // Every variable can stay false
+    solver->result = SAT_RESULT_SAT;
+  } else if (__atomic_exchange_n(&solver->interrupt_requested, false, __ATOMIC_SEQ_CST)) {
+    // A request which came in after the last search is used up here
+    solver->result = SAT_RESULT_UNKNOWN;
+  } else {
+    Problem *problem = &solver->problem;
+    // The formula is checked while the clauses are added, so only the allocation of the problem can fail
+    if (load_problem(problem, &solver->formula, solver->splitting_heuristic)) return SAT_ERROR_OUT_OF_MEMORY;
+    problem->random = init_random(solver->seed);
+    problem->limits = solver->limits;
+
+    // Either sat_interrupt sees the problem or the problem sees the interrupt request
+    __atomic_store_n(&solver->has_problem, true, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&solver->interrupt_requested, __ATOMIC_SEQ_CST)) interrupt(problem);
+
+    ProblemResult result = dpll_solve(problem);
+    __atomic_store_n(&solver->has_problem, false, __ATOMIC_SEQ_CST);
+
+    // The request which stopped the search is used up. One which came in after the search finished on its own stays for
+    // the next sat_solve
+    if (result == UNKNOWN && __atomic_load_n(&problem->interrupted, __ATOMIC_SEQ_CST)) {
+      __atomic_store_n(&solver->interrupt_requested, false, __ATOMIC_SEQ_CST);
+    }
+
+    switch (result) {
+    case SAT:
+      solver->result = SAT_RESULT_SAT;
+      memcpy(solver->model, problem->assigned_values, usize(word_count) * sizeof(u64));
+      break;
+    case UNSAT: solver->result = SAT_RESULT_UNSAT; break;
+    case UNKNOWN: solver->result = problem->out_of_memory ? SAT_ERROR_OUT_OF_MEMORY : SAT_RESULT_UNKNOWN; break;
+    }
+
+    solver->stats.decisions    = problem->split_count;
+    solver->stats.conflicts    = problem->conflict_count;
+    solver->stats.propagations = problem->propagation_count;
+    destroy_problem(problem);
+  }
+
+  solver->stats.time = current_time() - start_time;
+  return solver->result;
+}
+
+int sat_value(sat_solver *solver, int variable) {
+  if (!solver) return SAT_ERROR_INVALID_ARGUMENT;
+  if (solver->result != SAT_RESULT_SAT) return SAT_ERROR_NO_MODEL;
+  if (variable <= 0 || variable > solver->model_variable_count) return SAT_ERROR_INVALID_LITERAL;
+
+  return solver->model[variable >> 6] & get_word_mask(variable) ? variable : -variable;
+}
+
+int sat_get_stats(sat_solver *solver, sat_stats *stats) {
+  if (!solver || !stats) return SAT_ERROR_INVALID_ARGUMENT;
+
+  *stats = solver->stats;
+  return SAT_OK;
+}
+
+void sat_interrupt(sat_solver *solver) {
+  if (!solver) return;
+
+  __atomic_store_n(&solver->interrupt_requested, true, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&solver->has_problem, __ATOMIC_SEQ_CST)) interrupt(&solver->problem);
+}
@@ -0,0 +1,86 @@
+#ifndef LIBSAT_H
+#define LIBSAT_H
+
+// C interface of libsat. Every solver is an opaque handle without any shared state so different handles can be used
+// from different threads. Literals are DIMACS style signed variable ids starting at 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SAT_API __attribute__((visibility("default")))
+
+typedef struct sat_solver sat_solver;
+
+// Results of sat_solve, the same codes as the competition exit codes
+#define SAT_RESULT_UNKNOWN 0
+#define SAT_RESULT_SAT 10
+#define SAT_RESULT_UNSAT 20
+
+// Errors are returned as negative codes, nothing in the library aborts on bad input or when memory runs out
+#define SAT_OK 0
+#define SAT_ERROR_INVALID_ARGUMENT -1
+#define SAT_ERROR_INVALID_LITERAL -2
+#define SAT_ERROR_NO_MODEL -3
+#define SAT_ERROR_OUT_OF_MEMORY -4
+
+typedef enum sat_heuristic {
+  SAT_HEURISTIC_RANDOM,
+  SAT_HEURISTIC_TWO_CLAUSE,
+  SAT_HEURISTIC_POLARITY,
+  SAT_HEURISTIC_LOOKAHEAD,
+  SAT_HEURISTIC_MOMS,
+  SAT_HEURISTIC_JEROSLOW_WANG,
+} sat_heuristic;
+
+// Budgets of one sat_solve call, 0 means unlimited
+typedef struct sat_limits {
+  double time_limit; // Seconds of wall time
+  long long decision_limit;
+  long long conflict_limit;
+  long long propagation_limit;
+  long long memory_limit; // Bytes of peak resident memory
+} sat_limits;
+
+typedef struct sat_stats {
+  long long decisions;
+  long long conflicts;
+  long long propagations;
+  double time; // Seconds spent in the last sat_solve
+} sat_stats;
+
+// Returns NULL if the handle cannot be allocated
+SAT_API sat_solver *sat_create(void);
+
+// Frees the handle and everything the solver allocated
+SAT_API void sat_destroy(sat_solver *solver);
+
+SAT_API int sat_set_heuristic(sat_solver *solver, sat_heuristic heuristic);
+
+SAT_API int sat_set_seed(sat_solver *solver, unsigned long long seed);
+
+SAT_API int sat_set_limits(sat_solver *solver, const sat_limits *limits);
+
+// Adds a clause of size literals, duplicate literals are merged and tautologies are dropped. The clauses added before
+// are kept when SAT_ERROR_OUT_OF_MEMORY is returned
+SAT_API int sat_add_clause(sat_solver *solver, const int *literals, int size);
+
+// Returns SAT_RESULT_SAT, SAT_RESULT_UNSAT, SAT_RESULT_UNKNOWN or a negative error. SAT_ERROR_OUT_OF_MEMORY is returned
+// when the problem or a decision level of the search cannot be allocated, the clauses are kept for another try
+SAT_API int sat_solve(sat_solver *solver);
+
+// Value of a variable in the model of the last satisfiable sat_solve: variable if true and -variable if false.
+// Returns SAT_ERROR_NO_MODEL without a model and SAT_ERROR_INVALID_LITERAL for an unknown variable
+SAT_API int sat_value(sat_solver *solver, int variable);
+
+SAT_API int sat_get_stats(sat_solver *solver, sat_stats *stats);
+
+// Makes the running or the next sat_solve of the handle return SAT_RESULT_UNKNOWN. Safe to call from any thread. A
+// sat_solve which is answered without a search leaves the request for the next one
+SAT_API void sat_interrupt(sat_solver *solver);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
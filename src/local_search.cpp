@@ -0,0 +1,425 @@
+#include "local_search.hpp"
+
+#include "cardinality.hpp"
+#include "gauss.hpp"
+#include "mem.hpp"
+#include "os.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <pthread.h>
+
+namespace sat {
+
+LocalSearchConfig default_local_search_config() {
+  LocalSearchConfig config;
+  config.max_flips    = 10000000;
+  config.thread_count = 1;
+  config.seed         = 0x765;
+  config.cb           = 2.5;
+  return config;
+}
+
+// Clauses which are not already satisfied by the fixed variables of the problem, stored as flat literal lists together
+// with the clauses each literal occurs in. Shared read-only between all threads
+struct ClauseView {
+  i32 variable_count;
+  i32 clause_count;
+  i32 max_clause_length;
+
+  size *clause_offsets;
+  i32 *literals;
+
+  size *occurrence_offsets;
+  i32 *occurrences;
+};
+
+// Returns false if some clause is falsified by the fixed variables alone
+bool init_clause_view(ClauseView *view, Problem *problem) {
+  i32 word_count = words_per_clause(problem);
+
+  view->variable_count    = problem->variable_count;
+  view->clause_count      = 0;
+  view->max_clause_length = 0;
+
+  size literal_count = 0;
+  for (size i = 0; i < size(problem->clause_count) * word_count; ++i) {
+    literal_count += __builtin_popcountll(problem->clauses[i]);
+  }
+
+  view->occurrences        = nullptr;
+  view->clause_offsets     = CAllocator::construct<size>(problem->clause_count + 1);
+  view->literals           = CAllocator::construct<i32>(literal_count);
+  view->occurrence_offsets = CAllocator::construct<size>(2 * problem->variable_count + 1);
+  memset(view->occurrence_offsets, 0, usize(2 * problem->variable_count + 1) * sizeof(size));
+
+  size literal_size = 0;
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    u64 *clause_words   = problem->clauses + size(i) * word_count;
+    u64 *negation_words = problem->negations + size(i) * word_count;
+
+    bool is_satisfied = false;
+    for (i32 k = 0; k < word_count; ++k) {
+      u64 assigned = clause_words[k] & ~problem->unassigned[k];
+      if (assigned & (problem->assigned_values[k] ^ negation_words[k])) {
+        is_satisfied = true;
+        break;
+      }
+    }
+    if (is_satisfied) continue;
+
+    view->clause_offsets[view->clause_count] = literal_size;
+    for (i32 k = 0; k < word_count; ++k) {
+      u64 unknown = clause_words[k] & problem->unassigned[k];
+      while (unknown) {
+        i32 offset      = __builtin_ctzll(unknown);
+        i32 variable_id = (k << 6) | offset;
+        i32 literal     = (variable_id << 1) | i32((negation_words[k] >> offset) & 1);
+
+        view->literals[literal_size++] = literal;
+        ++view->occurrence_offsets[literal + 1];
+
+        unknown &= unknown - 1;
+      }
+    }
+
+    i32 length = i32(literal_size - view->clause_offsets[view->clause_count]);
+    if (length == 0) return false;
+    if (length > view->max_clause_length) view->max_clause_length = length;
+    ++view->clause_count;
+  }
+  view->clause_offsets[view->clause_count] = literal_size;
+
+  for (i32 i = 0; i < 2 * problem->variable_count; ++i) {
+    view->occurrence_offsets[i + 1] += view->occurrence_offsets[i];
+  }
+
+  size *fill = CAllocator::construct<size>(2 * problem->variable_count);
+  memcpy(fill, view->occurrence_offsets, usize(2 * problem->variable_count) * sizeof(size));
+
+  view->occurrences = CAllocator::construct<i32>(literal_size);
+  for (i32 i = 0; i < view->clause_count; ++i) {
+    for (size k = view->clause_offsets[i]; k < view->clause_offsets[i + 1]; ++k) {
+      view->occurrences[fill[view->literals[k]]++] = i;
+    }
+  }
+  CAllocator::destruct(fill);
+
+  return true;
+}
+
+void destroy_clause_view(ClauseView *view) {
+  CAllocator::destruct(view->clause_offsets);
+  CAllocator::destruct(view->literals);
+  CAllocator::destruct(view->occurrence_offsets);
+  CAllocator::destruct(view->occurrences);
+}
+
+const i32 max_break_table = 64;
+
+struct Walker {
+  ClauseView *view;
+  Problem *problem;
+  LocalSearchConfig config;
+  Random random;
+  std::atomic<bool> *stop;
+
+  f64 break_probability[max_break_table];
+  f64 *probabilities;
+
+  u8 *values;
+  i32 *break_count;
+
+  // Number of true literals and the xor of the variables of those literals. Once only one literal is true the xor is
+  // exactly the variable which would break the clause when flipped
+  i32 *true_count;
+  i32 *critical;
+
+  // Unsatisfied clauses in no particular order with the index of each clause within the list
+  i32 *unsat;
+  i32 *unsat_position;
+  i32 unsat_size;
+
+  i32 best_unsat_count;
+  u8 *best_values;
+  i64 flip_count;
+};
+
+bool literal_is_true(Walker *walker, i32 literal) {
+  return walker->values[literal_variable(literal)] != literal_is_negated(literal);
+}
+
+void add_unsat(Walker *walker, i32 clause_id) {
+  walker->unsat_position[clause_id]   = walker->unsat_size;
+  walker->unsat[walker->unsat_size++] = clause_id;
+}
+
+void remove_unsat(Walker *walker, i32 clause_id) {
+  i32 position                 = walker->unsat_position[clause_id];
+  i32 last                     = walker->unsat[--walker->unsat_size];
+  walker->unsat[position]      = last;
+  walker->unsat_position[last] = position;
+}
+
+void init_walker(Walker *walker, ClauseView *view, Problem *problem, LocalSearchConfig config, u64 seed,
+                 std::atomic<bool> *stop) {
+  walker->view    = view;
+  walker->problem = problem;
+  walker->config  = config;
+  walker->random  = init_random(seed);
+  walker->stop    = stop;
+
+  for (i32 i = 0; i < max_break_table; ++i) {
+    walker->break_probability[i] = pow(config.cb, -f64(i));
+  }
+
+  walker->probabilities  = CAllocator::construct<f64>(view->max_clause_length);
+  walker->values         = CAllocator::construct<u8>(view->variable_count);
+  walker->best_values    = CAllocator::construct<u8>(view->variable_count);
+  walker->break_count    = CAllocator::construct<i32>(view->variable_count);
+  walker->true_count     = CAllocator::construct<i32>(view->clause_count);
+  walker->critical       = CAllocator::construct<i32>(view->clause_count);
+  walker->unsat          = CAllocator::construct<i32>(view->clause_count);
+  walker->unsat_position = CAllocator::construct<i32>(view->clause_count);
+  walker->unsat_size     = 0;
+  walker->flip_count     = 0;
+
+  for (i32 i = 0; i < view->variable_count; ++i) {
+    walker->values[i]      = u8(random_range(&walker->random, 2));
+    walker->break_count[i] = 0;
+  }
+
+  for (i32 i = 0; i < view->clause_count; ++i) {
+    walker->true_count[i] = 0;
+    walker->critical[i]   = 0;
+    for (size k = view->clause_offsets[i]; k < view->clause_offsets[i + 1]; ++k) {
+      if (literal_is_true(walker, view->literals[k])) {
+        ++walker->true_count[i];
+        walker->critical[i] ^= literal_variable(view->literals[k]);
+      }
+    }
+
+    if (walker->true_count[i] == 0) {
+      add_unsat(walker, i);
+    } else if (walker->true_count[i] == 1) {
+      ++walker->break_count[walker->critical[i]];
+    }
+  }
+
+  walker->best_unsat_count = walker->unsat_size;
+  memcpy(walker->best_values, walker->values, usize(view->variable_count));
+}
+
+void destroy_walker(Walker *walker) {
+  CAllocator::destruct(walker->probabilities);
+  CAllocator::destruct(walker->values);
+  CAllocator::destruct(walker->best_values);
+  CAllocator::destruct(walker->break_count);
+  CAllocator::destruct(walker->true_count);
+  CAllocator::destruct(walker->critical);
+  CAllocator::destruct(walker->unsat);
+  CAllocator::destruct(walker->unsat_position);
+}
+
+void flip_variable(Walker *walker, i32 variable_id) {
+  ClauseView *view = walker->view;
+
+  walker->values[variable_id] ^= 1;
+  i32 true_literal  = (variable_id << 1) | !walker->values[variable_id];
+  i32 false_literal = true_literal ^ 1;
+
+  for (size i = view->occurrence_offsets[true_literal]; i < view->occurrence_offsets[true_literal + 1]; ++i) {
+    i32 clause_id = view->occurrences[i];
+    i32 previous  = walker->true_count[clause_id]++;
+    if (previous == 0) {
+      remove_unsat(walker, clause_id);
+      ++walker->break_count[variable_id];
+    } else if (previous == 1) {
+      --walker->break_count[walker->critical[clause_id]];
+    }
+    walker->critical[clause_id] ^= variable_id;
+  }
+
+  for (size i = view->occurrence_offsets[false_literal]; i < view->occurrence_offsets[false_literal + 1]; ++i) {
+    i32 clause_id = view->occurrences[i];
+    i32 current   = --walker->true_count[clause_id];
+    walker->critical[clause_id] ^= variable_id;
+    if (current == 0) {
+      add_unsat(walker, clause_id);
+      --walker->break_count[variable_id];
+    } else if (current == 1) {
+      ++walker->break_count[walker->critical[clause_id]];
+    }
+  }
+}
+
+// Local search makes no decisions or conflicts, so of the limits of the problem only an interrupt and the time limit
+// can stop it. The walkers only read the problem, so unlike over_budget this is safe to call from every thread
+bool walker_over_budget(Walker *walker) {
+  Problem *problem = walker->problem;
+  if (__atomic_load_n(&problem->interrupted, __ATOMIC_RELAXED)) return true;
+  return problem->limits.time_limit > 0 && current_time() - problem->start_time >= problem->limits.time_limit;
+}
+
+void run_walker(Walker *walker) {
+  ClauseView *view    = walker->view;
+  f64 *probabilities = walker->probabilities;
+
+  while (walker->unsat_size > 0 && walker->flip_count < walker->config.max_flips) {
+    bool poll = (walker->flip_count & 1023) == 0;
+    if (poll && (walker->stop->load(std::memory_order_relaxed) || walker_over_budget(walker))) break;
+
+    i32 clause_id = walker->unsat[random_range(&walker->random, walker->unsat_size)];
+    size begin    = view->clause_offsets[clause_id];
+    i32 length    = i32(view->clause_offsets[clause_id + 1] - begin);
+
+    // probSAT: pick a variable of the clause with probability proportional to cb^-break
+    f64 sum = 0;
+    for (i32 i = 0; i < length; ++i) {
+      i32 breaks       = walker->break_count[literal_variable(view->literals[begin + i])];
+      probabilities[i] = walker->break_probability[breaks < max_break_table ? breaks : max_break_table - 1];
+      sum += probabilities[i];
+    }
+
+    f64 threshold = random_unit(&walker->random) * sum;
+    i32 pick      = 0;
+    for (; pick < length - 1; ++pick) {
+      threshold -= probabilities[pick];
+      if (threshold <= 0) break;
+    }
+
+    flip_variable(walker, literal_variable(view->literals[begin + pick]));
+    ++walker->flip_count;
+
+    // Copying the assignment is linear so improvements are only recorded once in a while until close to a model
+    if (walker->unsat_size < walker->best_unsat_count && (walker->unsat_size < 16 || (walker->flip_count & 255) == 0)) {
+      walker->best_unsat_count = walker->unsat_size;
+      memcpy(walker->best_values, walker->values, usize(view->variable_count));
+    }
+  }
+
+  if (walker->unsat_size < walker->best_unsat_count) {
+    walker->best_unsat_count = walker->unsat_size;
+    memcpy(walker->best_values, walker->values, usize(view->variable_count));
+  }
+
+  if (walker->unsat_size == 0) walker->stop->store(true);
+}
+
+void *walker_thread(void *walker) {
+  run_walker((Walker *)walker);
+  return nullptr;
+}
+
+LocalSearchResult local_search(Problem *problem, LocalSearchConfig config) {
+  assert(config.thread_count > 0);
+
+  LocalSearchResult result;
+  result.solved           = false;
+  result.best_unsat_count = problem->clause_count;
+  result.flip_count       = 0;
+
+  result.best_assignment = CAllocator::construct<u64>(words_per_clause(problem));
+  for (i32 i = 0; i < words_per_clause(problem); ++i) {
+    result.best_assignment[i] = problem->assigned_values[i] & ~problem->unassigned[i];
+  }
+
+  ClauseView view;
+  if (!init_clause_view(&view, problem)) {
+    destroy_clause_view(&view);
+    return result;
+  }
+
+  std::atomic<bool> stop(false);
+
+  auto *walkers = CAllocator::construct<Walker>(config.thread_count);
+  for (i32 i = 0; i < config.thread_count; ++i) {
+    init_walker(&walkers[i], &view, problem, config, config.seed + u64(i), &stop);
+  }
+
+  if (config.thread_count == 1) {
+    run_walker(&walkers[0]);
+  } else {
+    auto *threads = CAllocator::construct<pthread_t>(config.thread_count);
+    for (i32 i = 0; i < config.thread_count; ++i) {
+      if (pthread_create(&threads[i], nullptr, walker_thread, &walkers[i])) panic("Failed to create thread\n");
+    }
+    for (i32 i = 0; i < config.thread_count; ++i) {
+      pthread_join(threads[i], nullptr);
+    }
+    CAllocator::destruct(threads);
+  }
+
+  Walker *best = &walkers[0];
+  for (i32 i = 0; i < config.thread_count; ++i) {
+    result.flip_count += walkers[i].flip_count;
+    if (walkers[i].best_unsat_count < best->best_unsat_count) best = &walkers[i];
+  }
+
+  result.best_unsat_count = best->best_unsat_count;
+
+  // Fixed variables keep their value and free variables take the value of the best walker
+  for (i32 i = 1; i < problem->variable_count; ++i) {
+    if (!(problem->unassigned[i >> 6] & get_word_mask(i))) continue;
+
+    if (best->best_values[i]) {
+      result.best_assignment[i >> 6] |= get_word_mask(i);
+    } else {
+      result.best_assignment[i >> 6] &= ~get_word_mask(i);
+    }
+  }
+
+  // Cardinality and xor constraints are not part of the local search objective so a model still has to be checked
+  // against them
+  result.solved = result.best_unsat_count == 0 && cardinalities_satisfied(problem, result.best_assignment) &&
+                  xors_satisfied(problem, result.best_assignment);
+
+  debug("Local search: %ld flips, best %d unsatisfied clauses\n", result.flip_count, result.best_unsat_count);
+
+  for (i32 i = 0; i < config.thread_count; ++i) {
+    destroy_walker(&walkers[i]);
+  }
+  CAllocator::destruct(walkers);
+  destroy_clause_view(&view);
+
+  return result;
+}
+
+void destroy_local_search_result(LocalSearchResult *result) { CAllocator::destruct(result->best_assignment); }
+
+ProblemResult hybrid_solve(Problem *problem, LocalSearchConfig config) {
+  f64 start_time           = current_time();
+  problem->start_time      = start_time;
+  LocalSearchResult result = local_search(problem, config);
+
+  if (result.solved) {
+    for (i32 i = 0; i < words_per_clause(problem); ++i) {
+      problem->assigned_values[i] = result.best_assignment[i];
+      problem->unassigned[i]      = 0;
+    }
+    problem->propagation_stack_size = 0;
+    destroy_local_search_result(&result);
+
+    verify_solution(problem);
+    return SAT;
+  }
+
+  // The problem takes ownership of the best assignment
+  problem->initial_polarity = result.best_assignment;
+  if (__atomic_load_n(&problem->interrupted, __ATOMIC_RELAXED)) return UNKNOWN;
+
+  // The time of the local search is charged to the time limit of dpll_solve, and the statistics cover both
+  SolveLimits limits = problem->limits;
+  if (limits.time_limit > 0) {
+    f64 remaining = limits.time_limit - (current_time() - start_time);
+    if (remaining <= 0) return UNKNOWN;
+    problem->limits.time_limit = remaining;
+  }
+
+  ProblemResult dpll_result = dpll_solve(problem);
+  problem->limits           = limits;
+  problem->start_time       = start_time;
+  return dpll_result;
+}
+
+} // namespace sat
@@ -0,0 +1,46 @@
+#ifndef LOCAL_SEARCH_HPP
+#define LOCAL_SEARCH_HPP
+
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+struct LocalSearchConfig {
+  // Flip budget of every thread
+  i64 max_flips;
+  i32 thread_count;
+
+  // Thread i runs with seed + i
+  u64 seed;
+
+  // Base of the probSAT break distribution: a variable is picked with probability proportional to cb^-break
+  f64 cb;
+};
+
+LocalSearchConfig default_local_search_config();
+
+struct LocalSearchResult {
+  bool solved;
+
+  // Lowest number of unsatisfied clauses seen and the assignment which produced it
+  i32 best_unsat_count;
+  u64 *best_assignment;
+
+  i64 flip_count;
+};
+
+// Runs probSAT from a different seed on every thread until one of them satisfies all clauses, every thread has used up
+// its flip budget, the problem is interrupted or its time limit runs out. Variables which are assigned in the problem
+// at this point are kept fixed
+LocalSearchResult local_search(Problem *problem, LocalSearchConfig config);
+
+void destroy_local_search_result(LocalSearchResult *result);
+
+// Runs local search under its flip budget first. A model is copied into the problem directly and otherwise the best
+// assignment found is handed to dpll_solve as the initial polarities. Both searches share the time limit
+ProblemResult hybrid_solve(Problem *problem, LocalSearchConfig config);
+
+} // namespace sat
+
+#endif
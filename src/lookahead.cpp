@@ -0,0 +1,336 @@
+#include "lookahead.hpp"
+
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+// Candidate literals are indexed as 2 * candidate + value where the literal assigns value to the candidate variable
+struct Lookahead {
+  i32 word_count;
+
+  // Marks clauses already looked at while counting new binary clauses for the current literal
+  i32 *clause_stamp;
+  i32 stamp;
+
+  i32 *candidates;
+  i32 candidate_count;
+
+  // Map from variable to its index in candidates or -1
+  i32 *candidate_index;
+
+  // Index of a candidate literal implied through a binary clause which is evaluated first so that this literal can be
+  // propagated on top of its assignment, -1 for the roots of the lookahead forest
+  i32 *parent;
+
+  // Binary clause through which a literal implies its parent, marked as used when the literal fails with its parent
+  i32 *parent_clause;
+
+  i32 *diff;
+  u8 *failed;
+
+  // Copies of the unassigned bitset for the lookahead forest and double lookahead
+  u64 *snapshots;
+};
+
+const i32 min_lookahead_candidates  = 16;
+const i32 double_lookahead_literals = 16;
+
+Lookahead *init_lookahead(Problem *problem) {
+  auto *lookahead            = CAllocator::construct<Lookahead>();
+  lookahead->word_count      = words_per_clause(problem);
+  lookahead->clause_stamp    = CAllocator::construct<i32>(problem->clause_count);
+  lookahead->stamp           = 0;
+  lookahead->candidates      = CAllocator::construct<i32>(problem->variable_count);
+  lookahead->candidate_index = CAllocator::construct<i32>(problem->variable_count);
+  lookahead->parent          = CAllocator::construct<i32>(2 * problem->variable_count);
+  lookahead->parent_clause   = CAllocator::construct<i32>(2 * problem->variable_count);
+  lookahead->diff            = CAllocator::construct<i32>(2 * problem->variable_count);
+  lookahead->failed          = CAllocator::construct<u8>(2 * problem->variable_count);
+  lookahead->snapshots       = CAllocator::construct<u64>(3 * lookahead->word_count);
+  memset(lookahead->clause_stamp, 0, usize(problem->clause_count) * sizeof(i32));
+  for (i32 i = 0; i < problem->variable_count; ++i) {
+    lookahead->candidate_index[i] = -1;
+  }
+  return lookahead;
+}
+
+void destroy_lookahead(Lookahead *lookahead) {
+  CAllocator::destruct(lookahead->clause_stamp);
+  CAllocator::destruct(lookahead->candidates);
+  CAllocator::destruct(lookahead->candidate_index);
+  CAllocator::destruct(lookahead->parent);
+  CAllocator::destruct(lookahead->parent_clause);
+  CAllocator::destruct(lookahead->diff);
+  CAllocator::destruct(lookahead->failed);
+  CAllocator::destruct(lookahead->snapshots);
+  CAllocator::destruct(lookahead);
+}
+
+u64 *snapshot(Lookahead *lookahead, i32 level) { return lookahead->snapshots + level * lookahead->word_count; }
+
+void save_unassigned(Problem *problem, Lookahead *lookahead, i32 level) {
+  memcpy(snapshot(lookahead, level), problem->unassigned, usize(lookahead->word_count) * sizeof(u64));
+}
+
+void restore_unassigned(Problem *problem, Lookahead *lookahead, i32 level) {
+  memcpy(problem->unassigned, snapshot(lookahead, level), usize(lookahead->word_count) * sizeof(u64));
+}
+
+bool variable_is_assigned(Problem *problem, i32 variable_id) {
+  return !(problem->unassigned[variable_id >> 6] & get_word_mask(variable_id));
+}
+
+bool variable_value(Problem *problem, i32 variable_id) {
+  return problem->assigned_values[variable_id >> 6] & get_word_mask(variable_id);
+}
+
+// Counts the unsatisfied clauses with more than two unknowns before the assignments made since the snapshot at level
+// and exactly two now. Only clauses with a literal falsified since then can have shrunk
+i32 count_new_binaries(Problem *problem, Lookahead *lookahead, i32 level) {
+  ++lookahead->stamp;
+
+  u64 *before = snapshot(lookahead, level);
+  i32 count   = 0;
+  for (i32 k = 0; k < lookahead->word_count; ++k) {
+    u64 assigned = before[k] & ~problem->unassigned[k];
+    while (assigned) {
+      i32 variable_id = (k << 6) | __builtin_ctzll(assigned);
+      bool value      = variable_value(problem, variable_id);
+
+      for (size o = problem->occurrence_offsets[variable_id]; o < problem->occurrence_offsets[variable_id + 1]; ++o) {
+        bool term_negated = problem->occurrences[o].negated;
+        i32 clause_id     = problem->occurrences[o].clause_id;
+        if (value != term_negated || lookahead->clause_stamp[clause_id] == lookahead->stamp) continue;
+        lookahead->clause_stamp[clause_id] = lookahead->stamp;
+
+        u64 *clause_words   = problem->clauses + size(clause_id) * lookahead->word_count;
+        u64 *negation_words = problem->negations + size(clause_id) * lookahead->word_count;
+
+        u64 true_terms    = 0;
+        i32 unknown_count = 0;
+        for (i32 i = 0; i < lookahead->word_count; ++i) {
+          true_terms |= clause_words[i] & ~problem->unassigned[i] & (problem->assigned_values[i] ^ negation_words[i]);
+          unknown_count += __builtin_popcountll(clause_words[i] & problem->unassigned[i]);
+        }
+        if (!true_terms && unknown_count == 2) ++count;
+      }
+
+      assigned &= assigned - 1;
+    }
+  }
+  return count;
+}
+
+// Assigns the literal on top of the current assignment and propagates it. Returns false on a conflict
+bool assume_literal(Problem *problem, i32 variable_id, bool value) {
+  set_variable(problem, variable_id, value);
+  return propagate(problem) == NO_CONFLICT;
+}
+
+// Finds a candidate literal implied by the given candidate literal through a binary clause, or -1
+i32 find_implied_candidate(Problem *problem, Lookahead *lookahead, i32 literal, i32 *implied_clause_id) {
+  i32 variable_id = lookahead->candidates[literal >> 1];
+  bool value      = literal & 1;
+
+  for (size o = problem->occurrence_offsets[variable_id]; o < problem->occurrence_offsets[variable_id + 1]; ++o) {
+    bool term_negated = problem->occurrences[o].negated;
+    i32 clause_id     = problem->occurrences[o].clause_id;
+    if (value != term_negated) continue;
+
+    u64 *clause_words   = problem->clauses + size(clause_id) * lookahead->word_count;
+    u64 *negation_words = problem->negations + size(clause_id) * lookahead->word_count;
+
+    u64 true_terms    = 0;
+    i32 unknown_count = 0;
+    i32 other         = -1;
+    for (i32 i = 0; i < lookahead->word_count; ++i) {
+      u64 unknown = clause_words[i] & problem->unassigned[i];
+      true_terms |= clause_words[i] & ~problem->unassigned[i] & (problem->assigned_values[i] ^ negation_words[i]);
+      unknown_count += __builtin_popcountll(unknown);
+
+      if ((variable_id >> 6) == i) unknown &= ~get_word_mask(variable_id);
+      if (unknown) other = (i << 6) | __builtin_ctzll(unknown);
+    }
+    if (true_terms || unknown_count != 2 || other < 0 || lookahead->candidate_index[other] < 0) continue;
+
+    bool other_negated = negation_words[other >> 6] & get_word_mask(other);
+    *implied_clause_id = clause_id;
+    return 2 * lookahead->candidate_index[other] + !other_negated;
+  }
+  return -1;
+}
+
+// Second level lookahead below the literal which is currently assigned: the literal has failed if some other
+// candidate conflicts for both of its values
+bool double_lookahead_fails(Problem *problem, Lookahead *lookahead, i32 literal) {
+  for (i32 i = 0; i < lookahead->candidate_count; ++i) {
+    i32 variable_id = lookahead->candidates[i];
+    if (i == literal >> 1 || variable_is_assigned(problem, variable_id)) continue;
+
+    save_unassigned(problem, lookahead, 2);
+    bool false_ok = assume_literal(problem, variable_id, false);
+    restore_unassigned(problem, lookahead, 2);
+    if (false_ok) continue;
+
+    bool true_ok = assume_literal(problem, variable_id, true);
+    restore_unassigned(problem, lookahead, 2);
+    if (!true_ok) return true;
+  }
+  return false;
+}
+
+i32 lookahead_decision(Problem *problem, bool *value) {
+  Lookahead *lookahead = problem->lookahead;
+
+  // Units from the input are still pending before the first decision
+  if (propagate(problem) == CONFLICT) return LOOKAHEAD_CONFLICT;
+
+  i32 free_count = 0;
+  for (i32 k = 0; k < lookahead->word_count; ++k) {
+    free_count += __builtin_popcountll(problem->unassigned[k]);
+  }
+  if (free_count == 0) return -1;
+
+  // Preselect the free variables which occur most often
+  i32 max_candidates = free_count / 8 > min_lookahead_candidates ? free_count / 8 : min_lookahead_candidates;
+
+  lookahead->candidate_count = 0;
+  for (i32 i = 0; i < problem->variable_count && lookahead->candidate_count < max_candidates; ++i) {
+    i32 variable_id = problem->variable_priority[i];
+    if (variable_is_assigned(problem, variable_id)) continue;
+
+    lookahead->candidate_index[variable_id]             = lookahead->candidate_count;
+    lookahead->candidates[lookahead->candidate_count++] = variable_id;
+  }
+
+  i32 literal_count = 2 * lookahead->candidate_count;
+  for (i32 i = 0; i < literal_count; ++i) {
+    lookahead->parent[i] = -1;
+    lookahead->diff[i]   = 0;
+    lookahead->failed[i] = 0;
+  }
+
+  // Build a forest of depth one where a literal hangs below a root literal it implies. The root is propagated once and
+  // its children are propagated on top of it, sharing the implications of the root
+  for (i32 i = 0; i < literal_count; ++i) {
+    i32 implied_clause_id;
+    i32 implied = find_implied_candidate(problem, lookahead, i, &implied_clause_id);
+    if (implied < 0 || implied >> 1 == i >> 1 || lookahead->parent[implied] != -1) continue;
+
+    bool has_children = false;
+    for (i32 k = 0; k < i && !has_children; ++k) {
+      has_children = lookahead->parent[k] == i;
+    }
+    if (!has_children) {
+      lookahead->parent[i]        = implied;
+      lookahead->parent_clause[i] = implied_clause_id;
+    }
+  }
+
+  for (i32 i = 0; i < lookahead->candidate_count; ++i) {
+    lookahead->candidate_index[lookahead->candidates[i]] = -1;
+  }
+
+  i32 double_lookahead_budget = problem->double_lookahead ? double_lookahead_literals : 0;
+  save_unassigned(problem, lookahead, 0);
+  for (i32 root = 0; root < literal_count; ++root) {
+    if (lookahead->parent[root] != -1) continue;
+
+    i32 root_variable_id = lookahead->candidates[root >> 1];
+    if (assume_literal(problem, root_variable_id, root & 1)) {
+      lookahead->diff[root] = count_new_binaries(problem, lookahead, 0);
+      if (double_lookahead_budget > 0 && lookahead->diff[root] > 0) {
+        --double_lookahead_budget;
+        if (double_lookahead_fails(problem, lookahead, root)) lookahead->failed[root] = 1;
+      }
+    } else {
+      lookahead->failed[root] = 1;
+    }
+
+    if (lookahead->failed[root]) {
+      restore_unassigned(problem, lookahead, 0);
+
+      // Every child implies the root so it fails as well
+      for (i32 child = 0; child < literal_count; ++child) {
+        if (lookahead->parent[child] != root) continue;
+        lookahead->failed[child] = 1;
+        if (problem->used_clauses) problem->used_clauses[lookahead->parent_clause[child]] = 1;
+      }
+      continue;
+    }
+
+    for (i32 child = 0; child < literal_count; ++child) {
+      if (lookahead->parent[child] != root) continue;
+
+      i32 child_variable_id = lookahead->candidates[child >> 1];
+      if (variable_is_assigned(problem, child_variable_id)) {
+        // The root implies the child (same assignment) or its negation (child implies its own negation)
+        if (variable_value(problem, child_variable_id) == bool(child & 1)) {
+          lookahead->diff[child] = lookahead->diff[root];
+        } else {
+          lookahead->failed[child] = 1;
+          if (problem->used_clauses) problem->used_clauses[lookahead->parent_clause[child]] = 1;
+        }
+        continue;
+      }
+
+      save_unassigned(problem, lookahead, 1);
+      if (assume_literal(problem, child_variable_id, child & 1)) {
+        lookahead->diff[child] = lookahead->diff[root] + count_new_binaries(problem, lookahead, 1);
+      } else {
+        lookahead->failed[child] = 1;
+      }
+      restore_unassigned(problem, lookahead, 1);
+    }
+
+    restore_unassigned(problem, lookahead, 0);
+  }
+
+  // Failed literals become units in the current assignment
+  for (i32 i = 0; i < literal_count; ++i) {
+    if (!lookahead->failed[i]) continue;
+
+    i32 variable_id = lookahead->candidates[i >> 1];
+    if (variable_is_assigned(problem, variable_id)) {
+      if (variable_value(problem, variable_id) == bool(i & 1)) return LOOKAHEAD_CONFLICT;
+      continue;
+    }
+
+    debug("  - Failed literal x%d = %d\n", variable_id, i & 1);
+    if (!assume_literal(problem, variable_id, !(i & 1))) return LOOKAHEAD_CONFLICT;
+  }
+
+  // Pick the candidate with the best product of new binary clauses and branch first on the side which creates fewer
+  i32 best_variable_id = -1;
+  i64 best_score       = -1;
+  for (i32 i = 0; i < lookahead->candidate_count; ++i) {
+    i32 variable_id = lookahead->candidates[i];
+    if (variable_is_assigned(problem, variable_id)) continue;
+
+    i64 false_diff = lookahead->diff[2 * i];
+    i64 true_diff  = lookahead->diff[2 * i + 1];
+    i64 score      = 1024 * false_diff * true_diff + false_diff + true_diff;
+    if (score > best_score) {
+      best_score       = score;
+      best_variable_id = variable_id;
+      *value           = true_diff <= false_diff;
+    }
+  }
+
+  if (best_variable_id == -1) {
+    // Failed literals assigned every candidate so fall back to the first free variable
+    for (i32 i = 0; i < problem->variable_count; ++i) {
+      i32 variable_id = problem->variable_priority[i];
+      if (!variable_is_assigned(problem, variable_id)) {
+        *value = true;
+        return variable_id;
+      }
+    }
+    return -1;
+  }
+
+  return best_variable_id;
+}
+
+} // namespace sat
@@ -0,0 +1,23 @@
+#ifndef LOOKAHEAD_HPP
+#define LOOKAHEAD_HPP
+
+#include "general.hpp"
+#include "solver.hpp"
+
+namespace sat {
+
+// Returned by lookahead_decision when both values of some variable lead to a conflict
+const i32 LOOKAHEAD_CONFLICT = -2;
+
+Lookahead *init_lookahead(Problem *problem);
+
+void destroy_lookahead(Lookahead *lookahead);
+
+// March style decision: propagates both values of a preselected set of candidates, assigns failed literals on the way
+// and returns the candidate with the best product of newly created binary clauses. Returns -1 when every variable is
+// assigned and LOOKAHEAD_CONFLICT when the current assignment cannot be extended
+i32 lookahead_decision(Problem *problem, bool *value);
+
+} // namespace sat
+
+#endif
@@ -20,7 +20,7 @@ struct CAllocator {
 };
 
 struct BumpAllocator {
-  static const i32 capacity = 1024 * 1024;
+  static const size capacity = 1024 * 1024;
 
   void init() {
     INIT_MEM
@@ -39,7 +39,7 @@ struct BumpAllocator {
 
     // Ensure all allocations are aligned to the size of a pointer
     size pointer_size = size(sizeof(intptr_t));
-    i32 bytes         = i32((size(sizeof(T)) * n + pointer_size - 1) & ~(pointer_size - 1));
+    size bytes        = (size(sizeof(T)) * n + pointer_size - 1) & ~(pointer_size - 1);
 
 #if DEBUG
     if (offset + bytes <= capacity) {
@@ -49,12 +49,12 @@ struct BumpAllocator {
       return ptr;
 #if DEBUG
     }
-    panic("BumpAllocator cannot exceed total of %d bytes in allocation\n", capacity);
+    panic("BumpAllocator cannot exceed total of %ld bytes in allocation\n", capacity);
 #endif
   }
 
   i8 *data;
-  i32 offset;
+  size offset;
   DEFINE_MEM
 };
 
@@ -62,7 +62,7 @@ struct Allocator {
 
   struct Block {
     i8 *data;
-    i32 offset;
+    size offset;
   };
 
   DEFINE_MEM
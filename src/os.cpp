@@ -2,6 +2,9 @@
 
 #include "mem.hpp"
 #include <cstring>
+#include <ctime>
+#include <sys/resource.h>
+#include <sys/stat.h>
 
 namespace sat {
 
@@ -13,18 +16,29 @@ File read_file(cstr file_path) {
   auto *fstream = fopen(file_path, "rb");
   if (!fstream) return file;
 
-  u32 capacity = 0x100;
-  u32 length   = 0;
+  // Regular files are read into a buffer of their size right away, one byte more to see the end of the file without
+  // growing. Anything else (e.g. pipes) starts small and grows
+  struct stat status;
+  usize capacity = 0x100;
+  if (!fstat(fileno(fstream), &status) && S_ISREG(status.st_mode)) capacity = usize(status.st_size) + 1;
+  usize length = 0;
 
-  char *buffer = CAllocator::construct<char>(capacity);
+  char *buffer = CAllocator::construct<char>(size(capacity));
   for (;;) {
-    u32 remaining_capacity = capacity - length;
+    if (!buffer) {
+      fclose(fstream);
+      return file;
+    }
+
+    usize remaining_capacity = capacity - length;
     length += fread(buffer + length, 1, remaining_capacity, fstream);
 
     if (length != capacity) {
       if (feof(fstream)) {
         file.data   = buffer;
-        file.length = i32(length);
+        file.length = size(length);
+      } else {
+        CAllocator::destruct(buffer);
       }
 
       fclose(fstream);
@@ -32,11 +46,68 @@ File read_file(cstr file_path) {
     }
 
     capacity         = (capacity << 1) - (capacity >> 1) + 8;
-    char *new_buffer = CAllocator::construct<char>(capacity);
-    memcpy(new_buffer, buffer, length);
+    char *new_buffer = CAllocator::construct<char>(size(capacity));
+    if (new_buffer) memcpy(new_buffer, buffer, length);
     CAllocator::destruct(buffer);
     buffer = new_buffer;
   }
 }
 
+Writer *init_writer(FILE *file) {
+  auto *writer   = CAllocator::construct<Writer>();
+  writer->file   = file;
+  writer->length = 0;
+  writer->failed = false;
+  return writer;
+}
+
+Result destroy_writer(Writer *writer) {
+  flush(writer);
+  bool failed = writer->failed;
+  CAllocator::destruct(writer);
+  return failed ? err : ok;
+}
+
+void flush(Writer *writer) {
+  if (!writer->failed && fwrite(writer->data, 1, usize(writer->length), writer->file) != usize(writer->length)) {
+    writer->failed = true;
+  }
+  writer->length = 0;
+}
+
+void append_string(Writer *writer, cstr string) {
+  while (*string) {
+    if (writer->length == Writer::capacity) flush(writer);
+    writer->data[writer->length++] = *string++;
+  }
+}
+
+void append_int(Writer *writer, i32 value) {
+  if (writer->length + 12 > Writer::capacity) flush(writer);
+
+  u32 magnitude = value < 0 ? u32(-i64(value)) : u32(value);
+  if (value < 0) writer->data[writer->length++] = '-';
+
+  char buffer[10];
+  i32 digits = 0;
+  do {
+    buffer[digits++] = char('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude);
+
+  while (digits) writer->data[writer->length++] = buffer[--digits];
+}
+
+f64 current_time() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return f64(now.tv_sec) + f64(now.tv_nsec) * 1e-9;
+}
+
+i64 peak_memory_usage() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage)) return 0;
+  return i64(usage.ru_maxrss) * 1024;
+}
+
 } // namespace sat
@@ -7,11 +7,38 @@ namespace sat {
 
 struct File {
   char *data;
-  i32 length;
+  size length;
 };
 
 File read_file(cstr file_path);
 
+// Buffered writer so that large outputs are not written number by number through fprintf
+struct Writer {
+  static const i32 capacity = 1 << 16;
+
+  FILE *file;
+  i32 length;
+  bool failed; // Set when a flush was cut short, the output after it is dropped
+  char data[capacity];
+};
+
+Writer *init_writer(FILE *file);
+
+// Flushes the remaining output, the file stays open. Returns err if any of the output could not be written
+Result destroy_writer(Writer *writer);
+
+void flush(Writer *writer);
+
+void append_string(Writer *writer, cstr string);
+
+void append_int(Writer *writer, i32 value);
+
+// Monotonic wall time in seconds
+f64 current_time();
+
+// Peak resident memory of the process in bytes
+i64 peak_memory_usage();
+
 } // namespace sat
 
 #endif
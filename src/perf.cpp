@@ -0,0 +1,142 @@
+#include "perf.hpp"
+
+#include "mem.hpp"
+#include "os.hpp"
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sat {
+
+struct PerfEvent {
+  cstr name;
+  u32 type;
+  u64 config;
+};
+
+// Cache events are encoded as cache | operation << 8 | result << 16
+const PerfEvent perf_events[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"L1D misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"dTLB misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+const i32 perf_event_count = i32(sizeof(perf_events) / sizeof(perf_events[0]));
+
+const cstr perf_phase_names[PHASE_COUNT] = {"parse", "heuristic init", "watch build", "search", "verification"};
+
+struct PerfCounters {
+  // -1 for events which could not be opened
+  i32 fds[perf_event_count];
+  i32 open_count;
+  i32 open_error;
+
+  f64 phase_start_time[PHASE_COUNT];
+  f64 phase_time[PHASE_COUNT];
+  bool phase_measured[PHASE_COUNT];
+
+  f64 phase_start[PHASE_COUNT][perf_event_count];
+  f64 phase_total[PHASE_COUNT][perf_event_count];
+};
+
+i32 open_perf_event(const PerfEvent *event) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size           = sizeof(attr);
+  attr.type           = event->type;
+  attr.config         = event->config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return i32(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+// The kernel multiplexes events when there are more than hardware counters, the count is scaled up to the time the
+// event was enabled
+f64 read_perf_event(i32 fd) {
+  u64 values[3];
+  if (read(fd, values, sizeof(values)) != ssize_t(sizeof(values)) || values[2] == 0) return 0;
+  return f64(values[0]) * f64(values[1]) / f64(values[2]);
+}
+
+PerfCounters *init_perf_counters() {
+  auto *counters = CAllocator::construct<PerfCounters>();
+  memset(counters, 0, sizeof(PerfCounters));
+  for (i32 i = 0; i < perf_event_count; ++i) {
+    counters->fds[i] = open_perf_event(&perf_events[i]);
+    if (counters->fds[i] >= 0) {
+      ++counters->open_count;
+    } else {
+      counters->open_error = errno;
+    }
+  }
+  return counters;
+}
+
+void destroy_perf_counters(PerfCounters *counters) {
+  for (i32 i = 0; i < perf_event_count; ++i) {
+    if (counters->fds[i] >= 0) close(counters->fds[i]);
+  }
+  CAllocator::destruct(counters);
+}
+
+void begin_phase(PerfCounters *counters, PerfPhase phase) {
+  if (!counters) return;
+
+  counters->phase_measured[phase]   = true;
+  counters->phase_start_time[phase] = current_time();
+  for (i32 i = 0; i < perf_event_count; ++i) {
+    if (counters->fds[i] >= 0) counters->phase_start[phase][i] = read_perf_event(counters->fds[i]);
+  }
+}
+
+void end_phase(PerfCounters *counters, PerfPhase phase) {
+  if (!counters) return;
+
+  for (i32 i = 0; i < perf_event_count; ++i) {
+    if (counters->fds[i] >= 0) {
+      counters->phase_total[phase][i] += read_perf_event(counters->fds[i]) - counters->phase_start[phase][i];
+    }
+  }
+  counters->phase_time[phase] += current_time() - counters->phase_start_time[phase];
+}
+
+void print_perf_report(PerfCounters *counters, i64 propagation_count) {
+  if (counters->open_count == 0) {
+    printf("c Perf counters unavailable (%s), phases are only timed\n", strerror(counters->open_error));
+  }
+
+  for (i32 phase = 0; phase < PHASE_COUNT; ++phase) {
+    if (!counters->phase_measured[phase]) continue;
+
+    f64 *total = counters->phase_total[phase];
+    printf("c Perf %s: %.3fs", perf_phase_names[phase], counters->phase_time[phase]);
+    for (i32 i = 0; i < perf_event_count; ++i) {
+      if (counters->fds[i] >= 0) printf(", %s %.3g", perf_events[i].name, total[i]);
+    }
+    if (counters->fds[0] >= 0 && counters->fds[1] >= 0 && total[0] > 0) printf(", IPC %.2f", total[1] / total[0]);
+    printf("\n");
+  }
+
+  if (!counters->phase_measured[PHASE_SEARCH] || propagation_count == 0 || counters->open_count == 0) return;
+
+  // Cycles and misses of the search divided by its propagations
+  printf("c Perf per propagation:");
+  bool first = true;
+  for (i32 i = 0; i < perf_event_count; ++i) {
+    if (counters->fds[i] < 0) continue;
+    printf("%s %s %.3g", first ? "" : ",", perf_events[i].name,
+           counters->phase_total[PHASE_SEARCH][i] / f64(propagation_count));
+    first = false;
+  }
+  printf("\n");
+}
+
+} // namespace sat
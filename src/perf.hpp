@@ -0,0 +1,35 @@
+#ifndef PERF_HPP
+#define PERF_HPP
+
+#include "general.hpp"
+
+namespace sat {
+
+enum PerfPhase {
+  PHASE_PARSE,
+  PHASE_HEURISTIC_INIT,
+  PHASE_WATCH_BUILD,
+  PHASE_SEARCH,
+  PHASE_VERIFY,
+  PHASE_COUNT,
+};
+
+struct PerfCounters;
+
+// Opens hardware counters of the process (cycles, instructions, L1D/LLC/branch/dTLB misses) with perf_event_open.
+// Counters which the kernel or the CPU do not offer are left out and the phases are still timed
+PerfCounters *init_perf_counters();
+
+void destroy_perf_counters(PerfCounters *counters);
+
+// Phases can be entered several times and accumulate. Both do nothing when counters is nullptr
+void begin_phase(PerfCounters *counters, PerfPhase phase);
+
+void end_phase(PerfCounters *counters, PerfPhase phase);
+
+// Prints the counters of every measured phase, IPC and the misses per propagation of the search
+void print_perf_report(PerfCounters *counters, i64 propagation_count);
+
+} // namespace sat
+
+#endif
@@ -0,0 +1,188 @@
+#include "renumber.hpp"
+
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+// Keys are degree << 32 | variable_id so that they sort by degree and then by variable id
+i32 compare_degree_keys(const void *left, const void *right) {
+  u64 a = *(const u64 *)left;
+  u64 b = *(const u64 *)right;
+  return a < b ? -1 : a > b;
+}
+
+inline u64 degree_key(i32 *degrees, i32 variable_id) { return (u64(degrees[variable_id]) << 32) | u64(variable_id); }
+
+Renumbering renumber_formula(Formula *formula) {
+  i32 variable_count = formula->variable_count;
+  i32 clause_count   = formula->clause_count;
+
+  // Start of every clause in the literal buffer and the occurrence count of every variable
+  size *clause_starts = CAllocator::construct<size>(clause_count + 1);
+  i32 *degrees        = CAllocator::construct<i32>(variable_count + 1);
+  memset(degrees, 0, usize(variable_count + 1) * sizeof(i32));
+  clause_starts[0] = 0;
+  i32 clause_id    = 0;
+  for (size i = 0; i < formula->literal_count; ++i) {
+    i32 literal = formula->literals[i];
+    if (literal) {
+      ++degrees[abs(literal)];
+    } else {
+      clause_starts[++clause_id] = i + 1;
+    }
+  }
+
+  // Clauses of every variable
+  size *offsets   = CAllocator::construct<size>(variable_count + 2);
+  size *positions = CAllocator::construct<size>(variable_count + 1);
+  offsets[0]      = 0;
+  for (i32 i = 0; i <= variable_count; ++i) {
+    offsets[i + 1] = offsets[i] + degrees[i];
+    positions[i]   = offsets[i];
+  }
+  i32 *occurrences = CAllocator::construct<i32>(offsets[variable_count + 1] > 0 ? offsets[variable_count + 1] : 1);
+  clause_id        = 0;
+  for (size i = 0; i < formula->literal_count; ++i) {
+    i32 literal = formula->literals[i];
+    if (literal) {
+      occurrences[positions[abs(literal)]++] = clause_id;
+    } else {
+      ++clause_id;
+    }
+  }
+
+  // Every component starts from its unvisited variable of minimal degree
+  u64 *start_keys    = CAllocator::construct<u64>(variable_count);
+  u64 *neighbor_keys = CAllocator::construct<u64>(variable_count);
+  for (i32 i = 1; i <= variable_count; ++i) {
+    start_keys[i - 1] = degree_key(degrees, i);
+  }
+  qsort(start_keys, usize(variable_count), sizeof(u64), compare_degree_keys);
+
+  i32 *order      = CAllocator::construct<i32>(variable_count);
+  u8 *visited     = CAllocator::construct<u8>(variable_count + 1);
+  u8 *clause_done = CAllocator::construct<u8>(clause_count > 0 ? clause_count : 1);
+  memset(visited, 0, usize(variable_count + 1));
+  memset(clause_done, 0, usize(clause_count));
+  i32 order_size = 0;
+  for (i32 k = 0; k < variable_count; ++k) {
+    i32 start = i32(start_keys[k] & 0xFFFFFFFF);
+    if (visited[start] || degrees[start] == 0) continue;
+
+    visited[start]      = 1;
+    order[order_size++] = start;
+    i32 head            = order_size - 1;
+    while (head < order_size) {
+      i32 variable_id = order[head++];
+      i32 first_new   = order_size;
+      for (size o = offsets[variable_id]; o < offsets[variable_id + 1]; ++o) {
+        i32 clause = occurrences[o];
+        if (clause_done[clause]) continue;
+        clause_done[clause] = 1;
+
+        for (size i = clause_starts[clause]; i < clause_starts[clause + 1] - 1; ++i) {
+          i32 neighbor = abs(formula->literals[i]);
+          if (visited[neighbor]) continue;
+          visited[neighbor]   = 1;
+          order[order_size++] = neighbor;
+        }
+      }
+
+      // New neighbors are visited by increasing degree
+      i32 new_count = order_size - first_new;
+      if (new_count > 1) {
+        for (i32 i = 0; i < new_count; ++i) {
+          neighbor_keys[i] = degree_key(degrees, order[first_new + i]);
+        }
+        qsort(neighbor_keys, usize(new_count), sizeof(u64), compare_degree_keys);
+        for (i32 i = 0; i < new_count; ++i) {
+          order[first_new + i] = i32(neighbor_keys[i] & 0xFFFFFFFF);
+        }
+      }
+    }
+  }
+
+  // Variables which do not occur in any clause go last
+  for (i32 i = 1; i <= variable_count; ++i) {
+    if (!visited[i]) order[order_size++] = i;
+  }
+  assert(order_size == variable_count);
+
+  Renumbering renumbering;
+  renumbering.variable_count  = variable_count;
+  renumbering.original_ids    = CAllocator::construct<i32>(variable_count + 1);
+  i32 *new_ids                = CAllocator::construct<i32>(variable_count + 1);
+  renumbering.original_ids[0] = 0;
+  new_ids[0]                  = 0;
+  for (i32 i = 0; i < variable_count; ++i) {
+    renumbering.original_ids[i + 1] = order[i];
+    new_ids[order[i]]               = i + 1;
+  }
+
+  // Counting sort of the clauses by their smallest new variable id, which keeps the file order of ties
+  i32 *minimums      = CAllocator::construct<i32>(clause_count > 0 ? clause_count : 1);
+  i32 *bucket_starts = CAllocator::construct<i32>(variable_count + 2);
+  memset(bucket_starts, 0, usize(variable_count + 2) * sizeof(i32));
+  for (i32 c = 0; c < clause_count; ++c) {
+    i32 minimum = variable_count;
+    for (size i = clause_starts[c]; i < clause_starts[c + 1] - 1; ++i) {
+      i32 variable_id = new_ids[abs(formula->literals[i])];
+      if (variable_id < minimum) minimum = variable_id;
+    }
+    minimums[c] = minimum;
+    ++bucket_starts[minimum + 1];
+  }
+  for (i32 i = 0; i <= variable_count; ++i) {
+    bucket_starts[i + 1] += bucket_starts[i];
+  }
+  i32 *sorted_clauses = CAllocator::construct<i32>(clause_count > 0 ? clause_count : 1);
+  for (i32 c = 0; c < clause_count; ++c) {
+    sorted_clauses[bucket_starts[minimums[c]]++] = c;
+  }
+
+  i32 *literals = CAllocator::construct<i32>(formula->literal_count > 0 ? formula->literal_count : 1);
+  size out      = 0;
+  for (i32 k = 0; k < clause_count; ++k) {
+    i32 c = sorted_clauses[k];
+    for (size i = clause_starts[c]; i < clause_starts[c + 1] - 1; ++i) {
+      i32 literal     = formula->literals[i];
+      literals[out++] = literal < 0 ? -new_ids[-literal] : new_ids[literal];
+    }
+    literals[out++] = 0;
+  }
+  assert(out == formula->literal_count);
+  memcpy(formula->literals, literals, usize(out) * sizeof(i32));
+
+  CAllocator::destruct(literals);
+  CAllocator::destruct(sorted_clauses);
+  CAllocator::destruct(bucket_starts);
+  CAllocator::destruct(minimums);
+  CAllocator::destruct(new_ids);
+  CAllocator::destruct(clause_done);
+  CAllocator::destruct(visited);
+  CAllocator::destruct(order);
+  CAllocator::destruct(neighbor_keys);
+  CAllocator::destruct(start_keys);
+  CAllocator::destruct(occurrences);
+  CAllocator::destruct(positions);
+  CAllocator::destruct(offsets);
+  CAllocator::destruct(degrees);
+  CAllocator::destruct(clause_starts);
+  return renumbering;
+}
+
+void destroy_renumbering(Renumbering *renumbering) { CAllocator::destruct(renumbering->original_ids); }
+
+void restore_numbering(Renumbering *renumbering, u64 *renumbered, u64 *original) {
+  i32 word_count = (renumbering->variable_count >> 6) + 1;
+  memset(original, 0, usize(word_count) * sizeof(u64));
+  original[0] = renumbered[0] & 1;
+  for (i32 i = 1; i <= renumbering->variable_count; ++i) {
+    if (!(renumbered[i >> 6] & get_word_mask(i))) continue;
+    i32 variable_id = renumbering->original_ids[i];
+    original[variable_id >> 6] |= get_word_mask(variable_id);
+  }
+}
+
+} // namespace sat
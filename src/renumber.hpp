@@ -0,0 +1,28 @@
+#ifndef RENUMBER_HPP
+#define RENUMBER_HPP
+
+#include "formula.hpp"
+#include "general.hpp"
+
+namespace sat {
+
+// Original variable id of every variable of a renumbered formula, original_ids[0] is 0 for x0
+struct Renumbering {
+  i32 variable_count;
+  i32 *original_ids;
+};
+
+// Renumbers the variables in Cuthill-McKee order of the variable interaction graph (breadth first from a variable of
+// minimal degree, neighbors by increasing degree) so that variables which share clauses share clause words, then sorts
+// the clauses by their smallest variable so that clauses over the same variables are next to each other
+Renumbering renumber_formula(Formula *formula);
+
+void destroy_renumbering(Renumbering *renumbering);
+
+// Writes a bitset over the renumbered variables (e.g. a model) as a bitset over the original ones. Both have room for
+// variable_count + 1 variables
+void restore_numbering(Renumbering *renumbering, u64 *renumbered, u64 *original);
+
+} // namespace sat
+
+#endif
@@ -1,54 +1,112 @@
 #include "solver.hpp"
 
+#include "cardinality.hpp"
+#include "checkpoint.hpp"
+#include "dynamic_scores.hpp"
+#include "gauss.hpp"
+#include "lookahead.hpp"
 #include "mem.hpp"
+#include "os.hpp"
+#include "perf.hpp"
 #include <cstring>
 
 namespace sat {
 
-i32 words_per_clause(Problem *problem) { return ((problem->variable_count - 1) >> 6) + 1; }
+// Allocates the state of the splitting heuristic with zero counts
+void init_heuristic_state(Problem *problem) {
+  i32 variable_count = problem->variable_count;
 
-u64 get_word_mask(i32 variable_id) { return 1ul << (variable_id & 63); }
+  problem->priority_pointer = 0;
+  switch (problem->splitting_heuristic) {
+  case RANDOM: problem->variable_priority = nullptr; break;
+  case TWO_CLAUSE:
+    problem->variable_priority = CAllocator::construct<i32>(variable_count);
+
+    problem->clause_literal_count = CAllocator::construct<i32>(problem->clause_count);
+    memset(problem->clause_literal_count, 0, u32(problem->clause_count) * sizeof(i32));
+    break;
+  case POLARITY:
+    problem->variable_priority = CAllocator::construct<i32>(variable_count);
+
+    problem->polarity_info.false_count          = CAllocator::construct<i32>(variable_count);
+    problem->polarity_info.true_count           = CAllocator::construct<i32>(variable_count);
+    problem->polarity_info.clause_satisfied     = nullptr;
+    problem->polarity_info.satisfied_trail      = nullptr;
+    problem->polarity_info.satisfied_trail_size = 0;
+    problem->polarity_info.trail_marks          = nullptr;
+    memset(problem->polarity_info.false_count, 0, u32(variable_count) * sizeof(i32));
+    memset(problem->polarity_info.true_count, 0, u32(variable_count) * sizeof(i32));
+    break;
+  case LOOKAHEAD: problem->variable_priority = CAllocator::construct<i32>(variable_count); break;
+  case MOMS:
+  case JEROSLOW_WANG: problem->variable_priority = nullptr; break;
+  }
+}
+
+void destroy_heuristic_state(Problem *problem) {
+  switch (problem->splitting_heuristic) {
+  case RANDOM: break;
+  case TWO_CLAUSE: CAllocator::destruct(problem->clause_literal_count); break;
+  case POLARITY:
+    CAllocator::destruct(problem->polarity_info.false_count);
+    CAllocator::destruct(problem->polarity_info.true_count);
+    CAllocator::destruct(problem->polarity_info.clause_satisfied);
+    CAllocator::destruct(problem->polarity_info.satisfied_trail);
+    CAllocator::destruct(problem->polarity_info.trail_marks);
+    break;
+  case LOOKAHEAD:
+  case MOMS:
+  case JEROSLOW_WANG: break;
+  }
+  CAllocator::destruct(problem->variable_priority);
+}
 
-Problem init_problem(i32 variable_count, i32 clause_count, SplittingHeuristic splitting_heuristic) {
-  assert(variable_count > 0 && clause_count > 0);
+Result init_problem(Problem *out, i32 variable_count, i32 clause_count, SplittingHeuristic splitting_heuristic) {
+  assert(variable_count > 0 && clause_count >= 0);
 
   // Add "varible x0" which will be implicitly assigned a true value
   ++variable_count;
 
   Problem problem;
+  problem.random              = init_random(0x765);
   problem.split_count         = 0;
+  problem.conflict_count      = 0;
+  problem.propagation_count   = 0;
+  problem.limits              = {0, 0, 0, 0, 0};
+  problem.start_time          = 0;
+  problem.budget_check_count  = 0;
+  problem.interrupted         = false;
+  problem.out_of_memory       = false;
+  problem.best_assigned_count = 0;
+  problem.initial_polarity    = nullptr;
+  problem.used_clauses        = nullptr;
+  problem.lookahead           = nullptr;
+  problem.double_lookahead    = false;
+  problem.dynamic_scores      = nullptr;
+  problem.model_callback      = nullptr;
+  problem.model_callback_data = nullptr;
   problem.variable_count      = variable_count;
   problem.clause_count        = clause_count;
   problem.splitting_heuristic = splitting_heuristic;
 
-  problem.priority_pointer = 0;
-  switch (splitting_heuristic) {
-  case RANDOM: problem.variable_priority = nullptr; break;
-  case TWO_CLAUSE:
-    problem.variable_priority = CAllocator::construct<i32>(variable_count);
-
-    problem.clause_literal_count = CAllocator::construct<i32>(clause_count);
-    memset(problem.clause_literal_count, 0, u32(clause_count) * sizeof(i32));
-    break;
-  case POLARITY:
-    problem.variable_priority = CAllocator::construct<i32>(variable_count);
-
-    problem.polarity_info.false_count = CAllocator::construct<i32>(variable_count);
-    problem.polarity_info.true_count  = CAllocator::construct<i32>(variable_count);
-    memset(problem.polarity_info.false_count, 0, u32(variable_count) * sizeof(i32));
-    memset(problem.polarity_info.true_count, 0, u32(variable_count) * sizeof(i32));
-    break;
+  // The clause matrix is by far the largest allocation, so it comes first and nothing else has to be freed if it fails
+  assert(variable_count <= max_variable_count + 1);
+  size clause_block_size = size(words_per_clause(&problem)) * clause_count;
+
+  // Formulas of cardinality or xor constraints alone have no clauses
+  problem.clauses   = CAllocator::construct<u64>(clause_block_size > 0 ? clause_block_size : 1);
+  problem.negations = CAllocator::construct<u64>(clause_block_size > 0 ? clause_block_size : 1);
+  if (!problem.clauses || !problem.negations) {
+    CAllocator::destruct(problem.clauses);
+    CAllocator::destruct(problem.negations);
+    return err;
   }
+  memset(problem.clauses, 0, usize(clause_block_size) * sizeof(u64));
+  memset(problem.negations, 0, usize(clause_block_size) * sizeof(u64));
 
-  i32 clause_block_size = words_per_clause(&problem) * clause_count;
-
-  problem.clauses = CAllocator::construct<u64>(clause_block_size);
-  memset(problem.clauses, 0, u32(clause_block_size * 8));
-
-  problem.negations = CAllocator::construct<u64>(clause_block_size);
-  memset(problem.negations, 0, u32(clause_block_size * 8));
+  debug("Clause Structure + Negations Bytes: %ldb\n", clause_block_size * 8 * 2);
 
-  debug("Clause Structure + Negations Bytes: %db\n", clause_block_size * 8 * 2);
+  init_heuristic_state(&problem);
 
   problem.unassigned      = CAllocator::construct<u64>(words_per_clause(&problem));
   problem.assigned_values = CAllocator::construct<u64>(words_per_clause(&problem));
@@ -65,6 +123,11 @@ Problem init_problem(i32 variable_count, i32 clause_count, SplittingHeuristic sp
   problem.unassigned[0] &= ~(u64)1;
   problem.assigned_values[0] |= 1;
 
+  problem.best_unassigned = CAllocator::construct<u64>(words_per_clause(&problem));
+  problem.best_values     = CAllocator::construct<u64>(words_per_clause(&problem));
+  memcpy(problem.best_unassigned, problem.unassigned, usize(words_per_clause(&problem)) * sizeof(u64));
+  memcpy(problem.best_values, problem.assigned_values, usize(words_per_clause(&problem)) * sizeof(u64));
+
   debug("Unassigned: ");
   for (i32 i = 0; i < words_per_clause(&problem); ++i) {
     debug(" %016lx", problem.unassigned[i]);
@@ -74,22 +137,86 @@ Problem init_problem(i32 variable_count, i32 clause_count, SplittingHeuristic sp
   problem.decision_stack_size       = 0;
   problem.decision_stack            = CAllocator::construct<i32>(variable_count);
   problem.previous_unassigned_stack = CAllocator::construct<u64 *>(variable_count);
+  for (i32 i = 0; i < variable_count; ++i) {
+    problem.previous_unassigned_stack[i] = nullptr;
+  }
 
   problem.propagation_stack_size = 0;
   problem.propagation_stack      = CAllocator::construct<i32>(variable_count);
 
-  problem.variable_to_clause = CAllocator::construct<SimpleWatchlistNode *>(variable_count);
-  for (i32 i = 0; i < variable_count; ++i) {
-    problem.variable_to_clause[i] = nullptr;
+  problem.occurrence_counts  = CAllocator::construct<i32>(variable_count);
+  problem.occurrence_offsets = CAllocator::construct<size>(variable_count + 1);
+  problem.occurrences        = nullptr;
+  memset(problem.occurrence_counts, 0, usize(variable_count) * sizeof(i32));
+  memset(problem.occurrence_offsets, 0, usize(variable_count + 1) * sizeof(size));
+
+  problem.cardinality_count    = 0;
+  problem.cardinality_capacity = 0;
+  problem.cardinalities        = nullptr;
+  problem.cardinality_watches  = nullptr;
+  problem.xor_system           = nullptr;
+  problem.checkpointer         = nullptr;
+  problem.resume_checkpoint    = nullptr;
+  problem.perf_counters        = nullptr;
+
+  *out = problem;
+  return ok;
+}
+
+void destroy_problem(Problem *problem) {
+  destroy_heuristic_state(problem);
+  if (problem->lookahead) destroy_lookahead(problem->lookahead);
+  if (problem->dynamic_scores) destroy_dynamic_scores(problem->dynamic_scores);
+
+  CAllocator::destruct(problem->clauses);
+  CAllocator::destruct(problem->negations);
+  CAllocator::destruct(problem->unassigned);
+  CAllocator::destruct(problem->assigned_values);
+  CAllocator::destruct(problem->best_unassigned);
+  CAllocator::destruct(problem->best_values);
+  CAllocator::destruct(problem->initial_polarity);
+
+  for (i32 i = 0; i < problem->variable_count; ++i) {
+    CAllocator::destruct(problem->previous_unassigned_stack[i]);
+  }
+  CAllocator::destruct(problem->previous_unassigned_stack);
+  CAllocator::destruct(problem->decision_stack);
+  CAllocator::destruct(problem->propagation_stack);
+
+  CAllocator::destruct(problem->occurrence_counts);
+  CAllocator::destruct(problem->occurrence_offsets);
+  CAllocator::destruct(problem->occurrences);
+
+  for (i32 i = 0; i < problem->cardinality_count; ++i) {
+    CAllocator::destruct(problem->cardinalities[i].literals);
+  }
+  CAllocator::destruct(problem->cardinalities);
+  if (problem->cardinality_watches) {
+    for (i32 i = 0; i < 2 * problem->variable_count; ++i) {
+      CAllocator::destruct(problem->cardinality_watches[i].data);
+    }
+    CAllocator::destruct(problem->cardinality_watches);
   }
+  if (problem->xor_system) destroy_xor_system(problem->xor_system);
+}
 
-  return problem;
+// Word count of a clause which is a compile-time constant for the specialized instantiations of the solver core
+// and falls back to the runtime value when W is 0
+template <i32 W>
+inline i32 words(Problem *problem) {
+  if constexpr (W > 0) {
+    assert(W == words_per_clause(problem));
+    return W;
+  } else {
+    return words_per_clause(problem);
+  }
 }
 
+template <i32 W = 0>
 bool is_negated(Problem *problem, i32 clause_id, i32 variable_id) {
   assert(clause_id >= 0 && clause_id < problem->clause_count);
   assert(variable_id > 0 && variable_id < problem->variable_count);
-  return problem->negations[clause_id * words_per_clause(problem) + (variable_id >> 6)] & get_word_mask(variable_id);
+  return problem->negations[size(clause_id) * words<W>(problem) + (variable_id >> 6)] & get_word_mask(variable_id);
 }
 
 bool is_assigned(Problem *problem, i32 variable_id) {
@@ -129,7 +256,7 @@ void add_variable(Problem *problem, i32 clause_id, i32 variable_id, bool negate)
   default: break;
   }
 
-  i32 index = (clause_id * words_per_clause(problem)) + (variable_id >> 6);
+  size index = (size(clause_id) * words_per_clause(problem)) + (variable_id >> 6);
 
   if (problem->clauses[index] & get_word_mask(variable_id)) {
     // Case where we encountered something like "(~x v x)"
@@ -138,10 +265,82 @@ void add_variable(Problem *problem, i32 clause_id, i32 variable_id, bool negate)
   }
 
   problem->clauses[index] |= get_word_mask(variable_id);
+  ++problem->occurrence_counts[variable_id];
 
   if (negate) problem->negations[index] |= get_word_mask(variable_id);
 }
 
+void remove_clauses(Problem *problem, u8 *removed) {
+  i32 word_count = words_per_clause(problem);
+
+  i32 kept = 0;
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    if (removed[i]) {
+      for (i32 k = 0; k < word_count; ++k) {
+        u64 clause_word = problem->clauses[size(i) * word_count + k];
+        while (clause_word) {
+          i32 variable_id = (k << 6) | __builtin_ctzll(clause_word);
+          --problem->occurrence_counts[variable_id];
+          if (problem->splitting_heuristic == POLARITY) {
+            if (problem->negations[size(i) * word_count + k] & get_word_mask(variable_id)) {
+              --problem->polarity_info.false_count[variable_id];
+            } else {
+              --problem->polarity_info.true_count[variable_id];
+            }
+          }
+          clause_word &= clause_word - 1;
+        }
+      }
+      continue;
+    }
+
+    if (kept != i) {
+      memcpy(problem->clauses + size(kept) * word_count, problem->clauses + size(i) * word_count,
+             usize(word_count) * sizeof(u64));
+      memcpy(problem->negations + size(kept) * word_count, problem->negations + size(i) * word_count,
+             usize(word_count) * sizeof(u64));
+      if (problem->splitting_heuristic == TWO_CLAUSE) {
+        problem->clause_literal_count[kept] = problem->clause_literal_count[i];
+      }
+    }
+    ++kept;
+  }
+  problem->clause_count = kept;
+}
+
+void set_splitting_heuristic(Problem *problem, SplittingHeuristic splitting_heuristic) {
+  if (problem->splitting_heuristic == splitting_heuristic) return;
+
+  destroy_heuristic_state(problem);
+  problem->splitting_heuristic = splitting_heuristic;
+  init_heuristic_state(problem);
+
+  // The counts which add_variable keeps while loading are rebuilt from the clauses
+  i32 word_count = words_per_clause(problem);
+  if (splitting_heuristic == TWO_CLAUSE) {
+    for (i32 i = 0; i < problem->clause_count; ++i) {
+      for (i32 k = 0; k < word_count; ++k) {
+        problem->clause_literal_count[i] += __builtin_popcountll(problem->clauses[size(i) * word_count + k]);
+      }
+    }
+  } else if (splitting_heuristic == POLARITY) {
+    for (i32 i = 0; i < problem->clause_count; ++i) {
+      for (i32 k = 0; k < word_count; ++k) {
+        u64 clause_word = problem->clauses[size(i) * word_count + k];
+        while (clause_word) {
+          i32 variable_id = (k << 6) | __builtin_ctzll(clause_word);
+          if (problem->negations[size(i) * word_count + k] & get_word_mask(variable_id)) {
+            ++problem->polarity_info.false_count[variable_id];
+          } else {
+            ++problem->polarity_info.true_count[variable_id];
+          }
+          clause_word &= clause_word - 1;
+        }
+      }
+    }
+  }
+}
+
 void set_variable(Problem *problem, i32 variable_id, bool value) {
   assert(variable_id > 0 && variable_id < problem->variable_count);
   i32 index = variable_id >> 6;
@@ -159,15 +358,34 @@ void set_variable(Problem *problem, i32 variable_id, bool value) {
   push_propagation(problem, variable_id, value);
 }
 
+// Snapshot buffers are allocated the first time a decision level is reached and reused afterwards. The search reserves
+// the next level before every decision so that running out of memory stops it instead of aborting
+template <i32 W>
+bool reserve_decision_level(Problem *problem) {
+  u64 **previous_unassigned = &problem->previous_unassigned_stack[problem->decision_stack_size];
+  if (!*previous_unassigned) *previous_unassigned = CAllocator::construct<u64>(words<W>(problem));
+  if (!*previous_unassigned) problem->out_of_memory = true;
+  return *previous_unassigned != nullptr;
+}
+
+template <i32 W>
 void push_new_decision(Problem *problem, i32 variable_id, bool value) {
   assert(problem->decision_stack_size < problem->variable_count);
   if (value) variable_id |= (1ll << 31);
-  u64 *previous_unassigned = CAllocator::construct<u64>(words_per_clause(problem));
-  for (i32 i = 0; i < words_per_clause(problem); ++i) {
+
+  // Resuming from a checkpoint pushes decisions without reserving their levels first
+  u64 *previous_unassigned = problem->previous_unassigned_stack[problem->decision_stack_size];
+  if (!previous_unassigned) previous_unassigned = CAllocator::construct<u64>(words<W>(problem));
+  for (i32 i = 0; i < words<W>(problem); ++i) {
     previous_unassigned[i] = problem->unassigned[i];
   }
   problem->previous_unassigned_stack[problem->decision_stack_size] = previous_unassigned;
-  problem->decision_stack[problem->decision_stack_size++]          = variable_id;
+
+  if (problem->splitting_heuristic == POLARITY) {
+    problem->polarity_info.trail_marks[problem->decision_stack_size] = problem->polarity_info.satisfied_trail_size;
+  }
+  if (problem->dynamic_scores) push_score_level(problem, problem->decision_stack_size);
+  problem->decision_stack[problem->decision_stack_size++] = variable_id;
 }
 
 i32 top_decision_stack(Problem *problem) {
@@ -183,33 +401,29 @@ i32 decision_get_variable_id(i32 decision) { return decision & 0x3FFFFFFF; }
 
 void decision_flip(i32 *decision) { *decision = *decision ^ (3 << 30); }
 
+template <i32 W, SplittingHeuristic H>
 i32 find_variable(Problem *problem) {
   i32 variable_id = -1;
 
   // Check if all variables have been assigned and if so, return -1
-  i32 i = 0;
-  for (; i < words_per_clause(problem); ++i) {
-    if (problem->unassigned[i]) break;
+  u64 any_unassigned = 0;
+  for (i32 i = 0; i < words<W>(problem); ++i) {
+    any_unassigned |= problem->unassigned[i];
   }
-  if (i == words_per_clause(problem)) return -1;
+  if (!any_unassigned) return -1;
 
-  switch (problem->splitting_heuristic) {
-  case RANDOM: {
+  if constexpr (H == RANDOM) {
     do {
-      variable_id = fast_random(problem->variable_count - 1) + 1;
+      variable_id = random_range(&problem->random, problem->variable_count - 1) + 1;
     } while (is_assigned(problem, variable_id));
-
-    break;
-  }
-  case TWO_CLAUSE:
-  case POLARITY:
+  } else {
+    static_assert(H != LOOKAHEAD, "Lookahead decisions are made by lookahead_decision");
+    static_assert(H != MOMS && H != JEROSLOW_WANG, "Dynamic decisions are made by dynamic_decision");
     for (i32 i = 0; i < problem->variable_count; ++i) {
       if (!is_assigned(problem, problem->variable_priority[i])) {
         return problem->variable_priority[i];
       }
     }
-
-    break;
   }
 
   assert(variable_id > 0);
@@ -218,284 +432,621 @@ i32 find_variable(Problem *problem) {
   return variable_id;
 }
 
-enum UnitPropagateResult {
-  NO_CONFLICT,
-  CONFLICT,
-};
+template <i32 W>
+void update_polarity_counts(Problem *problem, i32 clause_id, i32 delta) {
+  u64 *clause_words   = problem->clauses + size(clause_id) * words<W>(problem);
+  u64 *negation_words = problem->negations + size(clause_id) * words<W>(problem);
+  for (i32 i = 0; i < words<W>(problem); ++i) {
+    u64 clause_word = clause_words[i];
+    while (clause_word) {
+      i32 offset      = __builtin_ctzll(clause_word);
+      i32 variable_id = (i << 6) | offset;
+      if (negation_words[i] & (1ul << offset)) {
+        problem->polarity_info.false_count[variable_id] += delta;
+      } else {
+        problem->polarity_info.true_count[variable_id] += delta;
+      }
+      clause_word &= clause_word - 1;
+    }
+  }
+}
+
+template <i32 W>
+void satisfy_clause(Problem *problem, i32 clause_id) {
+  Problem::PolarityInfo *info = &problem->polarity_info;
+  if (info->clause_satisfied[clause_id]) return;
+
+  info->clause_satisfied[clause_id]                   = 1;
+  info->satisfied_trail[info->satisfied_trail_size++] = clause_id;
+  update_polarity_counts<W>(problem, clause_id, -1);
+}
+
+template <i32 W>
+void restore_satisfied_trail(Problem *problem, i32 trail_size) {
+  Problem::PolarityInfo *info = &problem->polarity_info;
+  while (info->satisfied_trail_size > trail_size) {
+    i32 clause_id                     = info->satisfied_trail[--info->satisfied_trail_size];
+    info->clause_satisfied[clause_id] = 0;
+    update_polarity_counts<W>(problem, clause_id, 1);
+  }
+}
+
+template <i32 W>
+UnitPropagateResult propagate_clauses(Problem *problem) {
+  bool track_satisfied = problem->splitting_heuristic == POLARITY;
+  bool track_scores    = problem->dynamic_scores != nullptr;
+  bool track_used      = problem->used_clauses != nullptr;
 
-UnitPropagateResult unit_propagate(Problem *problem) {
   while (problem->propagation_stack_size > 0) {
     i32 top = top_propagation_stack(problem);
     --problem->propagation_stack_size;
 
     bool value      = top & (1 << 31);
     i32 variable_id = top & 0x7FFFFFFF;
+    ++problem->propagation_count;
 
     // TODO: implement 2wl
 
-    auto *current = problem->variable_to_clause[variable_id];
-    while (current) {
-      bool term_negated = current->clause_id >> 31;
-      i32 clause_id     = current->clause_id & 0x7FFFFFFF;
+    size end = problem->occurrence_offsets[variable_id + 1];
+    for (size o = problem->occurrence_offsets[variable_id]; o < end; ++o) {
+      bool term_negated = problem->occurrences[o].negated;
+      i32 clause_id     = problem->occurrences[o].clause_id;
 
       // Only propagate if value of assignment would cause a term to go to 0
       if (!value ^ term_negated) {
-        bool has_unknown                = false;
-        bool has_one_unknown            = false;
-        i32 unknown_variable_id         = -1;
-        bool unknown_variable_is_negate = false;
-        for (i32 i = 0; i < words_per_clause(problem); ++i) {
-          u64 assigned    = ~problem->unassigned[i];
-          u64 clause_word = problem->clauses[clause_id * words_per_clause(problem) + i];
-          if ((assigned & clause_word) != clause_word) {
-            // Clause has an unassigned variable
-            u64 unknown = (assigned & clause_word) ^ clause_word;
-            assert(unknown > 0);
-
-            has_unknown = true;
-
-            if ((unknown & (unknown - 1)) == 0) {
-              if (has_one_unknown) {
-                has_one_unknown = false;
-                break;
-              }
-              has_one_unknown            = true;
-              unknown_variable_id        = (i << 6) | __builtin_ctzll(unknown);
-              unknown_variable_is_negate = is_negated(problem, clause_id, unknown_variable_id);
-            } else {
-              has_one_unknown = false;
-              break;
-            }
-          }
-        }
+        if (track_scores) shrink_clause(problem, clause_id);
 
-        // Calculate value of the clause
-        bool clause_is_true = false;
-        for (i32 i = 0; i < words_per_clause(problem); ++i) {
-          u64 assigned        = ~problem->unassigned[i];
-          u64 clause_word     = problem->clauses[clause_id * words_per_clause(problem) + i];
-          u64 clause_value    = problem->assigned_values[i];
-          u64 clause_negation = problem->negations[clause_id * words_per_clause(problem) + i];
+        u64 *clause_words   = problem->clauses + size(clause_id) * words<W>(problem);
+        u64 *negation_words = problem->negations + size(clause_id) * words<W>(problem);
 
-          clause_is_true |= (assigned & clause_word & (clause_value ^ clause_negation));
-          if (clause_is_true) break;
+        // Single pass over the clause which unrolls completely when the word count is known at compile time. The
+        // number of unknown literals saturates at 2 since only "none" and "exactly one" are of interest
+        u64 true_terms          = 0;
+        i32 unknown_count       = 0;
+        i32 unknown_variable_id = -1;
+        for (i32 i = 0; i < words<W>(problem); ++i) {
+          u64 clause_word = clause_words[i];
+          u64 unknown     = clause_word & problem->unassigned[i];
+
+          true_terms |= clause_word & ~problem->unassigned[i] & (problem->assigned_values[i] ^ negation_words[i]);
+
+          if (unknown) {
+            unknown_count += (unknown & (unknown - 1)) ? 2 : 1;
+            unknown_variable_id = (i << 6) | __builtin_ctzll(unknown);
+          }
         }
 
-        if (!clause_is_true) {
-          if (has_one_unknown) {
+        if (!true_terms) {
+          if (unknown_count == 1) {
+            if (track_used) problem->used_clauses[clause_id] = 1;
+            bool unknown_variable_is_negate = is_negated<W>(problem, clause_id, unknown_variable_id);
             debug("  - From clause%d: x%d = %d\n", clause_id, unknown_variable_id, !unknown_variable_is_negate);
             set_variable(problem, unknown_variable_id, !unknown_variable_is_negate);
-          } else if (!has_unknown) {
+          } else if (unknown_count == 0) {
             debug("  - Conflict from clause%d\n", clause_id);
+            if (track_used) problem->used_clauses[clause_id] = 1;
             problem->propagation_stack_size = 0;
             return CONFLICT;
           }
         }
+      } else if (track_satisfied) {
+        satisfy_clause<W>(problem, clause_id);
+      } else if (track_scores) {
+        satisfy_scored_clause(problem, clause_id);
       }
-      current = current->next;
+    }
+
+    if (problem->cardinality_count > 0 &&
+        propagate_cardinalities(problem, make_literal(variable_id, value)) == CONFLICT) {
+      problem->propagation_stack_size = 0;
+      return CONFLICT;
     }
   }
   return NO_CONFLICT;
 }
 
-ProblemResult dpll_solve(Problem *problem) {
-  // Check one-literal invariant
-#if DEBUG
-  for (i32 i = 0; i < problem->clause_count; ++i) {
-    bool has_one_literal = false;
-    i32 one_variable_id  = 0;
+// The xor rows are only looked at once the clauses have nothing left to propagate since eliminating is more expensive
+template <i32 W>
+UnitPropagateResult unit_propagate(Problem *problem) {
+  for (;;) {
+    if (propagate_clauses<W>(problem) == CONFLICT) return CONFLICT;
+    if (!problem->xor_system) return NO_CONFLICT;
+    if (propagate_xors(problem) == CONFLICT) return CONFLICT;
+    if (problem->propagation_stack_size == 0) return NO_CONFLICT;
+  }
+}
 
-    for (i32 k = 0; k < words_per_clause(problem); ++k) {
-      u64 clause_word = problem->clauses[(i * words_per_clause(problem)) + k];
-      if (clause_word != 0) {
-        if ((clause_word & (clause_word - 1)) == 0) {
-          if (has_one_literal) {
-            has_one_literal = false;
-            break;
-          }
-          has_one_literal = true;
+// Undo decisions until one which has not been tried both ways is found and flip it. Returns false when the search
+// space has been exhausted
+template <i32 W>
+bool backtrack(Problem *problem) {
+  while (problem->decision_stack_size > 0 && decision_is_tried_both(top_decision_stack(problem))) {
+    // Backtrack by one decision level
+    --problem->decision_stack_size;
+  }
+  if (problem->decision_stack_size <= 0) return false;
 
-          one_variable_id = (k << 6) | __builtin_ctzll(clause_word);
-        } else {
-          has_one_literal = false;
-          break;
-        }
+  u64 *previous_unassigned = problem->previous_unassigned_stack[problem->decision_stack_size - 1];
+  if (problem->dynamic_scores) {
+    backtrack_dynamic_scores(problem, previous_unassigned, problem->decision_stack_size - 1);
+  }
+  for (i32 i = 0; i < words<W>(problem); ++i) {
+    problem->unassigned[i] = previous_unassigned[i];
+  }
+  if (problem->splitting_heuristic == POLARITY) {
+    restore_satisfied_trail<W>(problem, problem->polarity_info.trail_marks[problem->decision_stack_size - 1]);
+  }
+
+  // Flip the decision after backtracking
+  decision_flip(&problem->decision_stack[problem->decision_stack_size - 1]);
+
+  i32 flipped_variable_id = decision_get_variable_id(top_decision_stack(problem));
+  bool flipped_value      = decision_get_value(top_decision_stack(problem));
+
+  // Unassign variable to pass assertion check in set_variable
+  problem->unassigned[flipped_variable_id >> 6] |= get_word_mask(flipped_variable_id);
+  set_variable(problem, flipped_variable_id, flipped_value);
+
+  debug("Flipped x%d = %d: ", flipped_variable_id, flipped_value);
+
+  debug("Unassigned: ");
+  for (i32 i = 0; i < words<W>(problem); ++i) {
+    debug(" %016lx", problem->unassigned[i]);
+  }
+  debug("\n");
+
+  return true;
+}
+
+// Assigns every unassigned variable which occurs with only one polarity in the clauses which are not satisfied yet.
+// Returns the number of assigned variables
+template <i32 W>
+i32 assign_pure_literals(Problem *problem) {
+  i32 assigned_count = 0;
+  for (i32 i = 0; i < words<W>(problem); ++i) {
+    u64 unassigned = problem->unassigned[i];
+    while (unassigned) {
+      i32 variable_id = (i << 6) | __builtin_ctzll(unassigned);
+      unassigned &= unassigned - 1;
+
+      if (problem->polarity_info.false_count[variable_id] == 0) {
+        debug("Pure x%d = 1\n", variable_id);
+        set_variable(problem, variable_id, true);
+        ++assigned_count;
+      } else if (problem->polarity_info.true_count[variable_id] == 0) {
+        debug("Pure x%d = 0\n", variable_id);
+        set_variable(problem, variable_id, false);
+        ++assigned_count;
       }
     }
+  }
+  return assigned_count;
+}
 
-    if (has_one_literal) assert(is_assigned(problem, one_variable_id));
+// Remembers the assignment with the most assigned variables so that an interrupted search can still report it
+template <i32 W>
+void record_partial_assignment(Problem *problem) {
+  i32 unassigned_count = 0;
+  for (i32 i = 0; i < words<W>(problem); ++i) {
+    unassigned_count += __builtin_popcountll(problem->unassigned[i]);
   }
-#endif
 
-  // Initialization for heuristics
-  i32 *variable_occurences = CAllocator::construct<i32>(problem->variable_count);
+  i32 assigned_count = problem->variable_count - 1 - unassigned_count;
+  if (assigned_count <= problem->best_assigned_count) return;
+
+  problem->best_assigned_count = assigned_count;
+  memcpy(problem->best_unassigned, problem->unassigned, usize(words<W>(problem)) * sizeof(u64));
+  memcpy(problem->best_values, problem->assigned_values, usize(words<W>(problem)) * sizeof(u64));
+}
+
+// Checked at every decision. The counters are plain comparisons and only the memory usage needs a system call so it
+// is looked at every 64 decisions
+bool over_budget(Problem *problem) {
+  if (__atomic_load_n(&problem->interrupted, __ATOMIC_RELAXED)) return true;
+
+  SolveLimits *limits = &problem->limits;
+  if (limits->decision_limit && problem->split_count >= limits->decision_limit) return true;
+  if (limits->conflict_limit && problem->conflict_count >= limits->conflict_limit) return true;
+  if (limits->propagation_limit && problem->propagation_count >= limits->propagation_limit) return true;
+  if (limits->time_limit > 0 && current_time() - problem->start_time >= limits->time_limit) return true;
+  if (limits->memory_limit && (++problem->budget_check_count & 63) == 0) {
+    if (peak_memory_usage() >= limits->memory_limit) return true;
+  }
+  return false;
+}
+
+template <i32 W, SplittingHeuristic H>
+ProblemResult search(Problem *problem) {
+  ProblemResult result = UNSAT;
+  for (;;) {
+    record_partial_assignment<W>(problem);
+    if (over_budget(problem) || !reserve_decision_level<W>(problem)) {
+      debug("Search stopped by a limit, an interrupt or a failed allocation\n");
+      if (problem->checkpointer) write_final_checkpoint(problem);
+      return result == SAT ? SAT : UNKNOWN;
+    }
+    if (problem->checkpointer) checkpoint_search(problem);
+
+    // Pure literals are assigned without branching. Their propagation only reaches satisfied clauses so it cannot fail.
+    // Enumeration needs every model and cardinality and xor constraints are not part of the counts so they keep
+    // branching
+    if constexpr (H == POLARITY) {
+      if (!problem->model_callback && problem->cardinality_count == 0 && !problem->xor_system &&
+          assign_pure_literals<W>(problem)) {
+        UnitPropagateResult pure_result = unit_propagate<W>(problem);
+        assert(pure_result == NO_CONFLICT);
+        (void)pure_result;
+        continue;
+      }
+    }
+
+    i32 variable_id;
+    bool value = true;
+    if constexpr (H == LOOKAHEAD) {
+      variable_id = lookahead_decision(problem, &value);
+    } else if constexpr (H == MOMS || H == JEROSLOW_WANG) {
+      variable_id = dynamic_decision(problem, &value);
+    } else {
+      variable_id = find_variable<W, H>(problem);
+    }
+
+    if (variable_id == LOOKAHEAD_CONFLICT) {
+      ++problem->conflict_count;
+      if (!backtrack<W>(problem)) return result;
+    } else if (variable_id == -1) {
+      result = SAT;
+      if (!problem->model_callback) return SAT;
+
+      // Report the model and continue the search as if the model was a conflict
+      verify_solution(problem);
+      if (!problem->model_callback(problem, problem->model_callback_data) || !backtrack<W>(problem)) return SAT;
+    } else {
+      ++problem->split_count;
+
+      if constexpr (H == RANDOM) {
+        value = next_random(&problem->random) & 1;
+      } else if constexpr (H == POLARITY) {
+        value = problem->polarity_info.true_count[variable_id] > problem->polarity_info.false_count[variable_id];
+      }
+
+      // Initial polarities (e.g. the best assignment found by local search) override the heuristic's choice
+      if (problem->initial_polarity) value = problem->initial_polarity[variable_id >> 6] & get_word_mask(variable_id);
+
+      set_variable(problem, variable_id, value);
+
+      debug("Selected x%d = %d\n", variable_id, value);
+
+      push_new_decision<W>(problem, variable_id, value);
+    }
+
+    while (unit_propagate<W>(problem) == CONFLICT) {
+      ++problem->conflict_count;
+      if (!backtrack<W>(problem)) return result;
+    }
+  }
+}
+
+template <i32 W>
+ProblemResult search(Problem *problem) {
   switch (problem->splitting_heuristic) {
-  case RANDOM: break;
-  case TWO_CLAUSE: {
-    for (i32 i = 0; i < problem->variable_count; ++i) {
-      variable_occurences[i] = 0;
+  case RANDOM: return search<W, RANDOM>(problem);
+  case TWO_CLAUSE: return search<W, TWO_CLAUSE>(problem);
+  case POLARITY: return search<W, POLARITY>(problem);
+  case LOOKAHEAD: return search<W, LOOKAHEAD>(problem);
+  case MOMS: return search<W, MOMS>(problem);
+  case JEROSLOW_WANG: return search<W, JEROSLOW_WANG>(problem);
+  }
+  panic("Unknown splitting heuristic %d\n", problem->splitting_heuristic);
+}
+
+// Assigns the variables which are assigned in target but not in the problem yet with their values from the checkpoint,
+// except for skipped_variable_id
+template <i32 W>
+void assign_from_checkpoint(Problem *problem, u64 *target, u64 *values, i32 skipped_variable_id) {
+  for (i32 i = 0; i < words<W>(problem); ++i) {
+    u64 missing = problem->unassigned[i] & ~target[i];
+    while (missing) {
+      i32 variable_id = (i << 6) | __builtin_ctzll(missing);
+      missing &= missing - 1;
+      if (variable_id == skipped_variable_id) continue;
+      set_variable(problem, variable_id, values[i] & get_word_mask(variable_id));
     }
+  }
+}
 
-    // Count number of two-clauses in which a literal is contained in and update variable_occurrences
-    for (i32 i = 0; i < problem->clause_count; ++i) {
-      if (problem->clause_literal_count[i] == 2) {
-        for (i32 k = 0; k < words_per_clause(problem); ++k) {
-          u64 clause_word = problem->clauses[(i * words_per_clause(problem)) + k];
-          while (clause_word) {
-            i32 offset      = __builtin_ctzll(clause_word);
-            i32 variable_id = (k << 6) | offset;
+// Brings a prepared problem to the state of the checkpoint by replaying its decisions. Variables which the search
+// assigned without a decision (pure and failed literals) are assigned at the level where they first appear. Replaying
+// rebuilds the heuristic state, the clause trails and the xor pivots along the way. read_checkpoint checks the shape
+// of the decisions, a conflict while replaying them still means that the checkpoint is damaged
+template <i32 W>
+Result resume_search(Problem *problem) {
+  Checkpoint *checkpoint = problem->resume_checkpoint;
+  for (i32 level = 0; level < checkpoint->header.decision_count; ++level) {
+    i32 decision    = checkpoint->decisions[level];
+    i32 variable_id = decision_get_variable_id(decision);
+    bool value      = decision_get_value(decision);
+
+    assign_from_checkpoint<W>(problem, checkpoint->level_unassigned + size(level) * words<W>(problem),
+                              checkpoint->assigned_values, variable_id);
+    if (unit_propagate<W>(problem) == CONFLICT) return err;
+    if (!(problem->unassigned[variable_id >> 6] & get_word_mask(variable_id))) return err;
 
-            ++variable_occurences[variable_id];
+    set_variable(problem, variable_id, value);
+    push_new_decision<W>(problem, variable_id, value);
+    problem->decision_stack[level] = decision;
+    if (unit_propagate<W>(problem) == CONFLICT) return err;
+  }
 
-            clause_word &= ~(1ul << offset);
-          }
+  assign_from_checkpoint<W>(problem, checkpoint->unassigned, checkpoint->assigned_values, 0);
+  if (unit_propagate<W>(problem) == CONFLICT) return err;
+  for (i32 i = 0; i < words<W>(problem); ++i) {
+    if (problem->unassigned[i] != checkpoint->unassigned[i]) return err;
+  }
+
+  problem->split_count       = checkpoint->header.split_count;
+  problem->conflict_count    = checkpoint->header.conflict_count;
+  problem->propagation_count = checkpoint->header.propagation_count;
+  problem->start_time        = current_time() - checkpoint->header.elapsed_time;
+  problem->random.state      = checkpoint->header.random_state;
+  debug("Resumed at %d decision levels\n", problem->decision_stack_size);
+  return ok;
+}
+
+// Pick the instantiation of the search loop which matches the word count of the problem. Small problems (up to 191
+// variables with the implicit x0) get fully unrolled clause loops and everything else takes the generic path
+ProblemResult search_dispatch(Problem *problem) {
+  switch (words_per_clause(problem)) {
+  case 1: return search<1>(problem);
+  case 2: return search<2>(problem);
+  case 3: return search<3>(problem);
+  default: return search<0>(problem);
+  }
+}
+
+UnitPropagateResult propagate(Problem *problem) {
+  switch (words_per_clause(problem)) {
+  case 1: return unit_propagate<1>(problem);
+  case 2: return unit_propagate<2>(problem);
+  case 3: return unit_propagate<3>(problem);
+  default: return unit_propagate<0>(problem);
+  }
+}
+
+Result resume_dispatch(Problem *problem) {
+  switch (words_per_clause(problem)) {
+  case 1: return resume_search<1>(problem);
+  case 2: return resume_search<2>(problem);
+  case 3: return resume_search<3>(problem);
+  default: return resume_search<0>(problem);
+  }
+}
+
+void prepare_search(Problem *problem) {
+  i32 variable_count = problem->variable_count;
+  i32 word_count     = words_per_clause(problem);
+
+  // The occurrence lists are sized by the counts which add_variable kept while loading. Every offset starts at the end
+  // of its list and moves back while the list is filled, so one walk over the clauses builds all lists in decreasing
+  // clause order and leaves every offset at the start of its list
+  begin_phase(problem->perf_counters, PHASE_WATCH_BUILD);
+  size *offsets = problem->occurrence_offsets;
+  size total    = 0;
+  for (i32 i = 0; i < variable_count; ++i) {
+    // Only undecided variables are watched because they can change
+    if (problem->unassigned[i >> 6] & get_word_mask(i)) total += problem->occurrence_counts[i];
+    offsets[i] = total;
+  }
+  offsets[variable_count] = total;
+  problem->occurrences    = CAllocator::construct<ClauseOccurrence>(total > 0 ? total : 1);
+
+  // The same walk counts the two-clause occurrences and the clauses which are satisfied at the root
+  i32 *variable_occurences = CAllocator::construct<i32>(variable_count);
+  memset(variable_occurences, 0, usize(variable_count) * sizeof(i32));
+
+  Problem::PolarityInfo *info = nullptr;
+  if (problem->splitting_heuristic == POLARITY) {
+    info                       = &problem->polarity_info;
+    info->clause_satisfied     = CAllocator::construct<u8>(problem->clause_count);
+    info->satisfied_trail      = CAllocator::construct<i32>(problem->clause_count);
+    info->satisfied_trail_size = 0;
+    info->trail_marks          = CAllocator::construct<i32>(variable_count);
+    memset(info->clause_satisfied, 0, usize(problem->clause_count));
+  }
+
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    u64 *clause_words   = problem->clauses + size(i) * word_count;
+    u64 *negation_words = problem->negations + size(i) * word_count;
+    bool is_two_clause  = problem->splitting_heuristic == TWO_CLAUSE && problem->clause_literal_count[i] == 2;
+    bool is_satisfied   = false;
+#if DEBUG
+    i32 literal_count = 0;
+    i32 unknown_count = 0;
+#endif
+
+    for (i32 k = 0; k < word_count; ++k) {
+      u64 clause_word = clause_words[k];
+      is_satisfied |= (clause_word & ~problem->unassigned[k] & (problem->assigned_values[k] ^ negation_words[k])) != 0;
+#if DEBUG
+      literal_count += __builtin_popcountll(clause_word);
+      unknown_count += __builtin_popcountll(clause_word & problem->unassigned[k]);
+#endif
+
+      while (clause_word) {
+        i32 offset      = __builtin_ctzll(clause_word);
+        i32 variable_id = (k << 6) | offset;
+
+        if (problem->unassigned[k] & (1ul << offset)) {
+          ClauseOccurrence *occurrence = &problem->occurrences[--offsets[variable_id]];
+          occurrence->clause_id        = i;
+          occurrence->negated          = (negation_words[k] >> offset) & 1;
         }
+        if (is_two_clause) ++variable_occurences[variable_id];
+
+        clause_word &= clause_word - 1;
       }
     }
 
-    break;
+    // Check one-literal invariant
+    assert(literal_count != 1 || unknown_count == 0);
+
+    // Clauses which are already satisfied at the root never come back so they are counted out for good
+    if (info && is_satisfied) {
+      info->clause_satisfied[i] = 1;
+      update_polarity_counts<0>(problem, i, -1);
+    }
+  }
+
+#if DEBUG
+  // Verify that the counts matched the clauses so that every list was filled completely
+  size start = 0;
+  for (i32 i = 0; i < variable_count; ++i) {
+    assert(offsets[i] == start);
+    if (problem->unassigned[i >> 6] & get_word_mask(i)) start += problem->occurrence_counts[i];
   }
-  case POLARITY: {
+#endif
+  end_phase(problem->perf_counters, PHASE_WATCH_BUILD);
+
+  // Initialization for heuristics
+  begin_phase(problem->perf_counters, PHASE_HEURISTIC_INIT);
+  switch (problem->splitting_heuristic) {
+  case RANDOM:
+  case TWO_CLAUSE:
+  case MOMS:
+  case JEROSLOW_WANG: break;
+  case POLARITY:
     // Use maximum of true_count or false_count to update variable_occurences
-    for (i32 i = 0; i < problem->variable_count; ++i) {
-      if (problem->polarity_info.true_count[i] > problem->polarity_info.false_count[i]) {
-        variable_occurences[i] = problem->polarity_info.true_count[i];
+    for (i32 i = 0; i < variable_count; ++i) {
+      if (info->true_count[i] > info->false_count[i]) {
+        variable_occurences[i] = info->true_count[i];
       } else {
-        variable_occurences[i] = problem->polarity_info.false_count[i];
+        variable_occurences[i] = info->false_count[i];
       }
     }
     break;
-  }
+  case LOOKAHEAD:
+    // Lookahead candidates are preselected by their total number of occurrences
+    memcpy(variable_occurences, problem->occurrence_counts, usize(variable_count) * sizeof(i32));
+    break;
   }
 
   switch (problem->splitting_heuristic) {
-  case RANDOM: break;
+  case RANDOM:
+  case MOMS:
+  case JEROSLOW_WANG: break;
   case TWO_CLAUSE:
-  case POLARITY: {
-    // Insertion sort the variables based on maximum occurences
-    problem->variable_priority[0] = 0;
-    for (i32 i = 1; i < problem->variable_count; ++i) {
-      problem->variable_priority[i] = i;
-
-      i32 k = i;
-      while (k >= 1) {
-        if (variable_occurences[problem->variable_priority[k - 1]] > variable_occurences[problem->variable_priority[k]])
-          break;
-
-        i32 temp                          = problem->variable_priority[k - 1];
-        problem->variable_priority[k - 1] = problem->variable_priority[k];
-        problem->variable_priority[k]     = temp;
-
-        --k;
-      }
+  case POLARITY:
+  case LOOKAHEAD: {
+    // Counting sort of the variables by decreasing occurences, ties go to the larger variable id. No score is larger
+    // than the clause count so this is linear in the size of the problem
+    i32 max_score = 0;
+    for (i32 i = 0; i < variable_count; ++i) {
+      assert(variable_occurences[i] >= 0);
+      if (variable_occurences[i] > max_score) max_score = variable_occurences[i];
+    }
+    i32 *bucket_starts = CAllocator::construct<i32>(max_score + 2);
+    memset(bucket_starts, 0, usize(max_score + 2) * sizeof(i32));
+    for (i32 i = 0; i < variable_count; ++i) {
+      ++bucket_starts[max_score - variable_occurences[i] + 1];
     }
+    for (i32 i = 0; i <= max_score; ++i) {
+      bucket_starts[i + 1] += bucket_starts[i];
+    }
+    for (i32 i = variable_count - 1; i >= 0; --i) {
+      problem->variable_priority[bucket_starts[max_score - variable_occurences[i]]++] = i;
+    }
+    CAllocator::destruct(bucket_starts);
 
 #if DEBUG
     // Verify that all variables are in the priority list
-    u64 *include_map = CAllocator::construct<u64>(words_per_clause(problem));
-    for (i32 i = 0; i < words_per_clause(problem); ++i) {
+    u64 *include_map = CAllocator::construct<u64>(word_count);
+    for (i32 i = 0; i < word_count; ++i) {
       include_map[i] = (u64)-1;
-      if (i + 1 == words_per_clause(problem)) include_map[i] &= (get_word_mask(problem->variable_count) - 1);
+      if (i + 1 == word_count && (variable_count & 63)) include_map[i] &= get_word_mask(variable_count) - 1;
     }
-    for (i32 i = 0; i < problem->variable_count; ++i) {
+    for (i32 i = 0; i < variable_count; ++i) {
       assert(include_map[problem->variable_priority[i] >> 6] & get_word_mask(problem->variable_priority[i]));
       include_map[problem->variable_priority[i] >> 6] &= ~get_word_mask(problem->variable_priority[i]);
     }
-    for (i32 i = 0; i < words_per_clause(problem); ++i) {
+    for (i32 i = 0; i < word_count; ++i) {
       assert(include_map[i] == 0);
     }
+    CAllocator::destruct(include_map);
 
     // Verify priority list is sorted
-    for (i32 i = 1; i < problem->variable_count; ++i) {
+    for (i32 i = 1; i < variable_count; ++i) {
       i32 left  = variable_occurences[problem->variable_priority[i - 1]];
       i32 right = variable_occurences[problem->variable_priority[i]];
-      assert(left >= right);
+      assert(left > right || (left == right && problem->variable_priority[i - 1] > problem->variable_priority[i]));
     }
 #endif
   } break;
   }
+  end_phase(problem->perf_counters, PHASE_HEURISTIC_INIT);
 
-  // Build variable_to_clause list for simple watchlist
-  for (i32 i = 0; i < problem->clause_count; ++i) {
-    for (i32 k = 0; k < words_per_clause(problem); ++k) {
-      u64 clause_word = problem->clauses[(i * words_per_clause(problem)) + k];
-      while (clause_word) {
-        i32 offset      = __builtin_ctzll(clause_word);
-        i32 variable_id = (k << 6) | offset;
+  CAllocator::destruct(variable_occurences);
 
-        // Only add undecided variables to the watchlist because they can change
-        if (!is_assigned(problem, variable_id)) {
-          // Add clause to watchlist
-          auto *new_node                           = CAllocator::construct<SimpleWatchlistNode>();
-          new_node->clause_id                      = i | (is_negated(problem, i, variable_id) << 31);
-          new_node->next                           = problem->variable_to_clause[variable_id];
-          problem->variable_to_clause[variable_id] = new_node;
-        }
-
-        clause_word &= ~(1ul << offset);
-      }
-    }
-  }
-
-  // Main iteration loop
-  for (;;) {
-    i32 variable_id = find_variable(problem);
-    if (variable_id == -1) break;
-
-    ++problem->split_count;
+  if (problem->splitting_heuristic == LOOKAHEAD) problem->lookahead = init_lookahead(problem);
+}
 
-    bool value;
-    switch (problem->splitting_heuristic) {
-    case RANDOM: value = fast_random(2) == 1; break;
-    case POLARITY:
-      if (problem->polarity_info.true_count[variable_id] > problem->polarity_info.false_count[variable_id]) {
-        value = true;
-      } else {
-        value = false;
-      }
-      break;
-    default: value = true; break;
+// Only unassigned variables are watched, so a clause which is falsified by the unit clauses before the search starts
+// would never be looked at by propagation
+bool has_falsified_clause(Problem *problem) {
+  i32 word_count = words_per_clause(problem);
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    u64 *clause    = problem->clauses + size(i) * word_count;
+    u64 *negations = problem->negations + size(i) * word_count;
+    bool falsified = true;
+    for (i32 k = 0; k < word_count && falsified; ++k) {
+      falsified = !(clause[k] & (problem->unassigned[k] | (problem->assigned_values[k] ^ negations[k])));
     }
+    if (!falsified) continue;
 
-    set_variable(problem, variable_id, value);
-
-    debug("Selected x%d = %d\n", variable_id, value);
-
-    push_new_decision(problem, variable_id, value);
-
-    while (unit_propagate(problem) == CONFLICT) {
-      while (decision_is_tried_both(top_decision_stack(problem))) {
-        // Backtrack by one decision level
-        --problem->decision_stack_size;
-
-        if (problem->decision_stack_size <= 0) return UNSAT;
-      }
-
-      u64 *previous_unassigned = problem->previous_unassigned_stack[problem->decision_stack_size - 1];
-      for (i32 i = 0; i < words_per_clause(problem); ++i) {
-        problem->unassigned[i] = previous_unassigned[i];
-      }
-
-      // Flip the decision after backtracking
-      decision_flip(&problem->decision_stack[problem->decision_stack_size - 1]);
+    if (problem->used_clauses) problem->used_clauses[i] = 1;
+    return true;
+  }
+  return false;
+}
 
-      i32 flipped_variable_id = decision_get_variable_id(top_decision_stack(problem));
-      bool flipped_value      = decision_get_value(top_decision_stack(problem));
+ProblemResult dpll_solve(Problem *problem) {
+  problem->start_time = current_time();
+  prepare_search(problem);
+  if (has_falsified_clause(problem)) return UNSAT;
+
+  // The unit clauses of the input are only queued while loading. They are propagated before the first decision, so
+  // that cardinality and xor constraints which they already violate are found even if nothing is left to decide
+  if (propagate(problem) == CONFLICT) return UNSAT;
+
+  if (problem->splitting_heuristic == MOMS || problem->splitting_heuristic == JEROSLOW_WANG) {
+    begin_phase(problem->perf_counters, PHASE_HEURISTIC_INIT);
+    problem->dynamic_scores = init_dynamic_scores(problem);
+    end_phase(problem->perf_counters, PHASE_HEURISTIC_INIT);
+  }
 
-      // Unassign variable to pass assertion check in set_variable
-      problem->unassigned[flipped_variable_id >> 6] |= get_word_mask(flipped_variable_id);
-      set_variable(problem, flipped_variable_id, flipped_value);
+  // Main iteration loop
+  begin_phase(problem->perf_counters, PHASE_SEARCH);
+  // A checkpoint which cannot be replayed is reported by the caller and the search is not started, so that the
+  // checkpoint file is not replaced
+  if (problem->resume_checkpoint && resume_dispatch(problem)) {
+    problem->resume_checkpoint->replay_failed = true;
+    end_phase(problem->perf_counters, PHASE_SEARCH);
+    return UNKNOWN;
+  }
+  ProblemResult result = search_dispatch(problem);
+  end_phase(problem->perf_counters, PHASE_SEARCH);
+
+  // Models are verified one by one when enumerating
+  if (result == SAT && !problem->model_callback) {
+    begin_phase(problem->perf_counters, PHASE_VERIFY);
+    verify_solution(problem);
+    end_phase(problem->perf_counters, PHASE_VERIFY);
+  }
 
-      debug("Flipped x%d = %d: ", flipped_variable_id, flipped_value);
+  return result;
+}
 
-      debug("Unassigned: ");
-      for (i32 i = 0; i < words_per_clause(problem); ++i) {
-        debug(" %016lx", problem->unassigned[i]);
-      }
-      debug("\n");
-    }
-  }
+void interrupt(Problem *problem) { __atomic_store_n(&problem->interrupted, true, __ATOMIC_RELAXED); }
 
+void verify_solution(Problem *problem) {
   // Verification passes
   for (i32 i = 0; i < words_per_clause(problem); ++i) {
     assert(problem->unassigned[i] == 0);
@@ -503,8 +1054,8 @@ ProblemResult dpll_solve(Problem *problem) {
   for (i32 i = 0; i < problem->clause_count; ++i) {
     bool result = false;
     for (i32 k = 0; k < words_per_clause(problem); ++k) {
-      u64 clause_word = problem->clauses[(i * words_per_clause(problem)) + k];
-      u64 negate_word = problem->negations[(i * words_per_clause(problem)) + k];
+      u64 clause_word = problem->clauses[(size(i) * words_per_clause(problem)) + k];
+      u64 negate_word = problem->negations[(size(i) * words_per_clause(problem)) + k];
 
       while (clause_word) {
         i32 offset = __builtin_ctzll(clause_word);
@@ -527,18 +1078,80 @@ ProblemResult dpll_solve(Problem *problem) {
       panic("Verification failed at clause%d\n", i);
     }
   }
+  if (!cardinalities_satisfied(problem, problem->assigned_values)) {
+    panic("Verification failed at a cardinality constraint\n");
+  }
+  if (!xors_satisfied(problem, problem->assigned_values)) panic("Verification failed at a xor constraint\n");
   debug("============================\n");
   debug("Solution verification passed\n");
   debug("============================\n");
+}
 
-  return SAT;
+bool model_satisfies(Problem *problem, u64 *values) {
+  i32 word_count = words_per_clause(problem);
+  for (i32 i = 0; i < problem->clause_count; ++i) {
+    u64 *clause    = problem->clauses + size(i) * word_count;
+    u64 *negations = problem->negations + size(i) * word_count;
+    bool satisfied = false;
+    for (i32 k = 0; k < word_count && !satisfied; ++k) {
+      satisfied = clause[k] & (values[k] ^ negations[k]);
+    }
+    if (!satisfied) return false;
+  }
+  return cardinalities_satisfied(problem, values) && xors_satisfied(problem, values);
 }
 
-void print_sat_solution(Problem *problem) {
-  for (i32 i = 1; i < problem->variable_count; ++i) {
-    bool value = problem->assigned_values[i >> 6] & get_word_mask(i);
-    printf("x%d = %d\n", i, value);
+// Decimal digits of the current variable id, right-aligned at index 10 and incremented in place so that writing a model
+// takes no divisions. The padding allows copying a fixed 11 bytes from any start
+struct DecimalCounter {
+  char digits[24];
+  i32 start;
+};
+
+void increment(DecimalCounter *counter) {
+  i32 i = 10;
+  while (i >= counter->start && counter->digits[i] == '9') counter->digits[i--] = '0';
+  if (i < counter->start) {
+    counter->start     = i;
+    counter->digits[i] = '1';
+  } else {
+    ++counter->digits[i];
+  }
+}
+
+void write_model(Writer *writer, cstr prefix, u64 *values, u64 *unassigned, i32 variable_count) {
+  DecimalCounter counter;
+  memset(counter.digits, 0, sizeof(counter.digits));
+  counter.digits[10] = '0';
+  counter.start      = 10;
+
+  append_string(writer, prefix);
+  i32 line_length = 0;
+  for (i32 i = 1; i < variable_count; ++i) {
+    increment(&counter);
+    u64 mask = get_word_mask(i);
+    if (unassigned && (unassigned[i >> 6] & mask)) continue;
+
+    if (line_length >= max_model_line_length) {
+      append_string(writer, "\n");
+      append_string(writer, prefix);
+      line_length = 0;
+    }
+
+    // Space, sign and at most 10 digits are written straight into the buffer
+    if (writer->length + 16 > Writer::capacity) flush(writer);
+    char *out  = writer->data + writer->length;
+    char *end  = out;
+    *end++     = ' ';
+    *end       = '-';
+    end       += !(values[i >> 6] & mask);
+    memcpy(end, counter.digits + counter.start, 11);
+    end += 11 - counter.start;
+
+    writer->length += i32(end - out);
+    line_length += i32(end - out);
   }
+  append_string(writer, " 0\n");
 }
 
 void dump_problem(Problem *problem) {
@@ -555,11 +1168,11 @@ void dump_problem(Problem *problem) {
   printf("\n");
   for (i32 i = 0; i < problem->clause_count; ++i) {
     for (i32 k = words_per_clause(problem) - 1; k >= 0; --k) {
-      printf("%016lx ", problem->clauses[i * words_per_clause(problem) + k]);
+      printf("%016lx ", problem->clauses[size(i) * words_per_clause(problem) + k]);
     }
     printf("clause_%d\n", i);
     for (i32 k = words_per_clause(problem) - 1; k >= 0; --k) {
-      printf("%016lx ", problem->negations[i * words_per_clause(problem) + k]);
+      printf("%016lx ", problem->negations[size(i) * words_per_clause(problem) + k]);
     }
     printf("negate_%d\n\n", i);
   }
@@ -5,15 +5,50 @@
 
 namespace sat {
 
-struct SimpleWatchlistNode {
+// The sign is kept next to the clause id (in what would be padding) so that every non-negative i32 is a valid id
+struct ClauseOccurrence {
   i32 clause_id;
-  SimpleWatchlistNode *next;
+  bool negated;
 };
 
 enum SplittingHeuristic {
   RANDOM,
   TWO_CLAUSE,
   POLARITY,
+  LOOKAHEAD,
+  MOMS,
+  JEROSLOW_WANG,
+};
+
+struct Lookahead;
+struct DynamicScores;
+struct XorSystem;
+struct Writer;
+struct Checkpointer;
+struct Checkpoint;
+struct PerfCounters;
+
+// Cardinality constraint in the form "at least bound of the literals are true". Only the first bound + 1 literals are
+// watched and the watched literals are kept at the front of the array
+struct CardinalityConstraint {
+  i32 bound;
+  i32 size;
+  i32 *literals;
+};
+
+struct WatchList {
+  i32 *data;
+  i32 size;
+  i32 capacity;
+};
+
+// Budgets of a dpll_solve call which are checked at every decision, 0 means unlimited
+struct SolveLimits {
+  f64 time_limit; // Seconds of wall time
+  i64 decision_limit;
+  i64 conflict_limit;
+  i64 propagation_limit;
+  i64 memory_limit; // Bytes of peak resident memory
 };
 
 struct Problem {
@@ -21,9 +56,16 @@ struct Problem {
   i32 *variable_priority;
   i32 priority_pointer;
 
+  // The counts only cover clauses which are not satisfied yet once the search has been prepared. Clauses satisfied
+  // during the search are kept on a trail with one mark per decision level so that backtracking can count them back in
   struct PolarityInfo {
     i32 *false_count;
     i32 *true_count;
+
+    u8 *clause_satisfied;
+    i32 *satisfied_trail;
+    i32 satisfied_trail_size;
+    i32 *trail_marks;
   };
 
   union {
@@ -34,7 +76,46 @@ struct Problem {
     PolarityInfo polarity_info;
   };
 
-  i32 split_count;
+  // Random heuristic state, owned by the problem so that independent problems can be solved on different threads
+  Random random;
+
+  i64 split_count;
+  i64 conflict_count;
+  i64 propagation_count;
+
+  SolveLimits limits;
+  f64 start_time;
+  i32 budget_check_count;
+
+  // Set by interrupt() from any thread, only accessed atomically
+  bool interrupted;
+
+  // Set when the snapshot of a new decision level cannot be allocated, which stops the search like a limit
+  bool out_of_memory;
+
+  // Deepest partial assignment seen at a decision, reported when the search stops early
+  i32 best_assigned_count;
+  u64 *best_unassigned;
+  u64 *best_values;
+
+  // Lookahead state, only allocated for the LOOKAHEAD heuristic
+  Lookahead *lookahead;
+  bool double_lookahead;
+
+  // Live clause lengths and literal scores, only allocated by dpll_solve for the MOMS and JEROSLOW_WANG heuristics
+  DynamicScores *dynamic_scores;
+
+  // Optional bitset of preferred values for decisions, nullptr when the heuristic decides. Owned by the problem
+  u64 *initial_polarity;
+
+  // Optional mark per clause, owned by the caller, which is set when the clause propagates a literal or is falsified.
+  // After UNSAT the marked clauses together with the unit clauses of their variables are unsatisfiable on their own
+  u8 *used_clauses;
+
+  // When set, dpll_solve reports every model to the callback and keeps searching until the callback returns false or
+  // the search space is exhausted
+  bool (*model_callback)(Problem *problem, void *data);
+  void *model_callback_data;
 
   i32 variable_count;
   i32 clause_count;
@@ -52,23 +133,100 @@ struct Problem {
   i32 propagation_stack_size;
   i32 *propagation_stack;
 
-  SimpleWatchlistNode **variable_to_clause;
+  // Occurrences of every variable, counted by add_variable while loading
+  i32 *occurrence_counts;
+
+  // Clauses of every variable which is unassigned when the search starts, the ones of variable v are from
+  // occurrence_offsets[v] to occurrence_offsets[v + 1] in decreasing clause order. Empty until prepare_search
+  size *occurrence_offsets;
+  ClauseOccurrence *occurrences;
+
+  i32 cardinality_count;
+  i32 cardinality_capacity;
+  CardinalityConstraint *cardinalities;
+
+  // Constraints watching each literal, allocated with the first cardinality constraint
+  WatchList *cardinality_watches;
+
+  // Xor constraints reduced by Gaussian elimination, allocated with the first one
+  XorSystem *xor_system;
+
+  // Optional periodic checkpoints of the search and a checkpoint to resume from, both owned by the caller
+  Checkpointer *checkpointer;
+  Checkpoint *resume_checkpoint;
+
+  // Optional hardware counters which are sampled around the phases of dpll_solve, owned by the caller
+  PerfCounters *perf_counters;
 };
 
-Problem init_problem(i32 variable_count, i32 clause_count, SplittingHeuristic splitting_heuristic);
+// Variable ids share their i32 with flag bits in decisions and literals, one id is taken by the implicit x0. Clause
+// ids can use every non-negative i32 and offsets into the clause matrix are 64-bit
+const i32 max_variable_count = (1 << 30) - 2;
+
+inline i32 words_per_clause(Problem *problem) { return ((problem->variable_count - 1) >> 6) + 1; }
+
+inline u64 get_word_mask(i32 variable_id) { return 1ul << (variable_id & 63); }
+
+// Literals outside of the clause matrix are encoded as (variable_id << 1) | negated
+inline i32 make_literal(i32 variable_id, bool negated) { return (variable_id << 1) | i32(negated); }
+
+inline i32 literal_variable(i32 literal) { return literal >> 1; }
+
+inline bool literal_is_negated(i32 literal) { return literal & 1; }
+
+// Decisions keep the value in the sign bit and the tried-both flag in bit 30 above the variable id
+i32 decision_get_variable_id(i32 decision);
+
+// Returns err without allocating anything if the clause matrix cannot be allocated
+Result init_problem(Problem *problem, i32 variable_count, i32 clause_count, SplittingHeuristic splitting_heuristic);
+
+void destroy_problem(Problem *problem);
 
 void add_variable(Problem *problem, i32 clause_id, i32 variable_id, bool negate);
 
 void set_variable(Problem *problem, i32 variable_id, bool value);
 
+// Removes the flagged clauses before the search is prepared, compacting the clause matrix
+void remove_clauses(Problem *problem, u8 *removed);
+
+// Switches a loaded problem to another heuristic before the search is prepared, recounting its clause statistics
+void set_splitting_heuristic(Problem *problem, SplittingHeuristic splitting_heuristic);
+
 enum ProblemResult {
   SAT,
   UNSAT,
+  UNKNOWN, // A limit was reached, the search was interrupted or it ran out of memory
+};
+
+// Builds the heuristic ordering and the watchlists. Called by dpll_solve and by anything else which drives
+// propagation on its own
+void prepare_search(Problem *problem);
+
+enum UnitPropagateResult {
+  NO_CONFLICT,
+  CONFLICT,
 };
 
+// Propagates every pending assignment on the propagation stack
+UnitPropagateResult propagate(Problem *problem);
+
 ProblemResult dpll_solve(Problem *problem);
 
-void print_sat_solution(Problem *problem);
+// Makes a running dpll_solve return UNKNOWN at its next decision. Safe to call from another thread or a signal handler
+void interrupt(Problem *problem);
+
+// Panics if the fully assigned problem does not satisfy every clause, cardinality and xor constraint
+void verify_solution(Problem *problem);
+
+// Checks a complete assignment against every clause, cardinality and xor constraint
+bool model_satisfies(Problem *problem, u64 *values);
+
+// Longest model line before the literals continue on a new line with the same prefix
+const i32 max_model_line_length = 100;
+
+// Writes the literals of the values as model lines ("v" for the competition format) which start with prefix and end
+// with 0. Variables which are set in unassigned are skipped, unassigned may be nullptr
+void write_model(Writer *writer, cstr prefix, u64 *values, u64 *unassigned, i32 variable_count);
 
 void dump_problem(Problem *problem);
 
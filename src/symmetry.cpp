@@ -0,0 +1,398 @@
+#include "symmetry.hpp"
+
+#include "mem.hpp"
+#include <cstring>
+
+namespace sat {
+
+// Colored graph of the formula: one vertex per literal (color 0) which is connected to its negation and one vertex per
+// clause (color 1) which is connected to its literals. Automorphisms of the graph are symmetries of the formula
+struct SymmetryGraph {
+  i32 variable_count;
+  i32 vertex_count;
+  size *offsets;
+  i32 *edges;
+};
+
+struct RefineKey {
+  i32 color;
+  i32 vertex;
+  u64 hash;
+};
+
+// Partition of the first path of the search tree before the vertex of the target cell is individualized
+struct SearchLevel {
+  i32 *colors;
+  i32 cell_count;
+  i32 target_color;
+  i32 vertex;
+};
+
+struct SymmetrySearch {
+  SymmetryGraph graph;
+  RefineKey *keys;
+
+  SearchLevel *levels;
+  i32 depth;
+
+  // Scratch space of the right side of a mapping
+  i32 *right;
+  i32 *left_sizes;
+  i32 *right_sizes;
+  i32 *inverse;
+  i32 *permutation;
+  i32 *stamp;
+
+  // Union find over vertices of the orbits of the generators found so far
+  i32 *orbit;
+
+  i32 *generators;
+  i32 generator_count;
+
+  // Vertex and edge visits, the search gives up on what is left once the limit is reached
+  i64 work;
+};
+
+const i64 symmetry_work_limit       = 500000000;
+const i64 symmetry_level_memory     = 1 << 24;
+const i32 max_symmetry_generators   = 1024;
+const i32 max_lex_leader_variables  = 100;
+
+i32 literal_vertex(i32 literal) { return literal > 0 ? 2 * (literal - 1) : 2 * (-literal - 1) + 1; }
+
+i32 vertex_literal(i32 vertex) { return vertex & 1 ? -(vertex >> 1) - 1 : (vertex >> 1) + 1; }
+
+SymmetryGraph build_symmetry_graph(Formula *formula) {
+  SymmetryGraph graph;
+  graph.variable_count = formula->variable_count;
+  graph.vertex_count   = 2 * formula->variable_count + formula->clause_count;
+  graph.offsets        = CAllocator::construct<size>(graph.vertex_count + 1);
+  memset(graph.offsets, 0, usize(graph.vertex_count + 1) * sizeof(size));
+
+  // Count the degrees first and fill the edges in a second pass
+  for (i32 pass = 0; pass < 2; ++pass) {
+    size *fill = pass ? CAllocator::construct<size>(graph.vertex_count) : graph.offsets + 1;
+    if (pass) memcpy(fill, graph.offsets, usize(graph.vertex_count) * sizeof(size));
+
+    for (i32 i = 0; i < 2 * graph.variable_count; ++i) {
+      if (pass) {
+        graph.edges[fill[i]++] = i ^ 1;
+      } else {
+        ++fill[i];
+      }
+    }
+
+    i32 clause_vertex = 2 * graph.variable_count;
+    for (size i = 0; i < formula->literal_count; ++i) {
+      i32 literal = formula->literals[i];
+      if (!literal) {
+        ++clause_vertex;
+        continue;
+      }
+      i32 vertex = literal_vertex(literal);
+      if (pass) {
+        graph.edges[fill[vertex]++]        = clause_vertex;
+        graph.edges[fill[clause_vertex]++] = vertex;
+      } else {
+        ++fill[vertex];
+        ++fill[clause_vertex];
+      }
+    }
+
+    if (pass) {
+      CAllocator::destruct(fill);
+    } else {
+      for (i32 i = 0; i < graph.vertex_count; ++i) {
+        graph.offsets[i + 1] += graph.offsets[i];
+      }
+      graph.edges = CAllocator::construct<i32>(graph.offsets[graph.vertex_count]);
+    }
+  }
+
+  return graph;
+}
+
+u64 mix_color(i32 color) {
+  u64 x = u64(color) + 0x9E3779B97F4A7C15;
+  x     = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+  x     = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+  return x ^ (x >> 31);
+}
+
+i32 compare_refine_keys(const void *left, const void *right) {
+  auto *a = (const RefineKey *)left;
+  auto *b = (const RefineKey *)right;
+  if (a->color != b->color) return a->color < b->color ? -1 : 1;
+  if (a->hash != b->hash) return a->hash < b->hash ? -1 : 1;
+  return a->vertex < b->vertex ? -1 : a->vertex > b->vertex;
+}
+
+// Splits the cells by the multiset of neighbour colors until nothing changes. The new colors only depend on the old
+// colors and the graph, never on the vertex ids, so partitions of isomorphic positions refine the same way. Returns the
+// new cell count
+i32 refine_partition(SymmetrySearch *search, i32 *colors, i32 cell_count) {
+  SymmetryGraph *graph = &search->graph;
+  for (;;) {
+    for (i32 v = 0; v < graph->vertex_count; ++v) {
+      u64 hash = 0;
+      for (size k = graph->offsets[v]; k < graph->offsets[v + 1]; ++k) {
+        hash += mix_color(colors[graph->edges[k]]);
+      }
+      search->keys[v] = {colors[v], v, hash};
+    }
+    search->work += graph->vertex_count + graph->offsets[graph->vertex_count];
+    qsort(search->keys, usize(graph->vertex_count), sizeof(RefineKey), compare_refine_keys);
+
+    i32 count = 0;
+    for (i32 i = 0; i < graph->vertex_count; ++i) {
+      RefineKey *key = &search->keys[i];
+      if (i == 0 || key->color != key[-1].color || key->hash != key[-1].hash) ++count;
+      colors[key->vertex] = count - 1;
+    }
+
+    if (count == cell_count) return count;
+    cell_count = count;
+  }
+}
+
+void count_cell_sizes(SymmetrySearch *search, i32 *colors, i32 *sizes) {
+  memset(sizes, 0, usize(search->graph.vertex_count) * sizeof(i32));
+  for (i32 v = 0; v < search->graph.vertex_count; ++v) {
+    ++sizes[colors[v]];
+  }
+}
+
+// Builds the first path of the search tree by individualizing the first vertex of the first non-singleton cell until
+// the partition is discrete. Returns false when the path does not fit into the memory budget
+bool build_first_path(SymmetrySearch *search) {
+  i32 vertex_count = search->graph.vertex_count;
+  i32 max_depth    = i32(symmetry_level_memory / vertex_count);
+  search->levels   = CAllocator::construct<SearchLevel>(max_depth + 1);
+  search->depth    = 0;
+
+  i32 *colors = CAllocator::construct<i32>(vertex_count);
+  for (i32 v = 0; v < vertex_count; ++v) {
+    colors[v] = v < 2 * search->graph.variable_count ? 0 : 1;
+  }
+  i32 cell_count = refine_partition(search, colors, 2);
+
+  for (;;) {
+    SearchLevel *level = &search->levels[search->depth];
+    level->colors      = colors;
+    level->cell_count  = cell_count;
+    level->vertex      = -1;
+    if (cell_count == vertex_count) return true;
+    if (search->depth == max_depth) return false;
+
+    count_cell_sizes(search, colors, search->left_sizes);
+    level->target_color = 0;
+    while (search->left_sizes[level->target_color] == 1) ++level->target_color;
+    for (i32 v = 0; level->vertex < 0; ++v) {
+      if (colors[v] == level->target_color) level->vertex = v;
+    }
+
+    i32 *next = CAllocator::construct<i32>(vertex_count);
+    memcpy(next, colors, usize(vertex_count) * sizeof(i32));
+    next[level->vertex] = cell_count;
+    cell_count          = refine_partition(search, next, cell_count + 1);
+    colors              = next;
+    ++search->depth;
+  }
+}
+
+// Follows the first path from the given level with w individualized instead of the vertex of the path. Below that
+// level the vertex of the path is taken if it is in the matching cell and the first vertex of the cell otherwise, so
+// the search is incomplete but every permutation it returns is checked. Returns false when the shapes stop matching
+bool map_leaf(SymmetrySearch *search, i32 level_index, i32 w) {
+  i32 vertex_count = search->graph.vertex_count;
+  i32 *right       = search->right;
+  memcpy(right, search->levels[level_index].colors, usize(vertex_count) * sizeof(i32));
+
+  i32 cell_count = search->levels[level_index].cell_count;
+  right[w]       = cell_count;
+  cell_count     = refine_partition(search, right, cell_count + 1);
+
+  for (i32 k = level_index + 1;; ++k) {
+    SearchLevel *level = &search->levels[k];
+    if (cell_count != level->cell_count) return false;
+
+    count_cell_sizes(search, level->colors, search->left_sizes);
+    count_cell_sizes(search, right, search->right_sizes);
+    if (memcmp(search->left_sizes, search->right_sizes, usize(cell_count) * sizeof(i32))) return false;
+    if (k == search->depth) break;
+
+    i32 u = level->vertex;
+    if (right[u] != level->target_color) {
+      for (u = 0; right[u] != level->target_color; ++u) {
+      }
+    }
+    right[u]   = cell_count;
+    cell_count = refine_partition(search, right, cell_count + 1);
+  }
+
+  // Both partitions are discrete, the vertices with the same color correspond to each other
+  i32 *leaf = search->levels[search->depth].colors;
+  for (i32 v = 0; v < vertex_count; ++v) {
+    search->inverse[right[v]] = v;
+  }
+  for (i32 v = 0; v < vertex_count; ++v) {
+    search->permutation[v] = search->inverse[leaf[v]];
+  }
+  return true;
+}
+
+bool is_automorphism(SymmetrySearch *search) {
+  SymmetryGraph *graph = &search->graph;
+  for (i32 v = 0; v < graph->vertex_count; ++v) {
+    search->stamp[v] = -1;
+  }
+
+  for (i32 v = 0; v < graph->vertex_count; ++v) {
+    i32 image = search->permutation[v];
+    if (graph->offsets[v + 1] - graph->offsets[v] != graph->offsets[image + 1] - graph->offsets[image]) return false;
+
+    for (size k = graph->offsets[image]; k < graph->offsets[image + 1]; ++k) {
+      search->stamp[graph->edges[k]] = v;
+    }
+    for (size k = graph->offsets[v]; k < graph->offsets[v + 1]; ++k) {
+      if (search->stamp[search->permutation[graph->edges[k]]] != v) return false;
+    }
+    search->work += graph->offsets[v + 1] - graph->offsets[v];
+  }
+  return true;
+}
+
+i32 orbit_root(SymmetrySearch *search, i32 vertex) {
+  while (search->orbit[vertex] != vertex) {
+    search->orbit[vertex] = search->orbit[search->orbit[vertex]];
+    vertex                = search->orbit[vertex];
+  }
+  return vertex;
+}
+
+// Generators which only swap duplicate clauses still merge orbits but have nothing to break
+void record_generator(SymmetrySearch *search) {
+  i32 *generator = search->generators + search->generator_count * (search->graph.variable_count + 1);
+  bool moves     = false;
+  generator[0]   = 0;
+  for (i32 x = 1; x <= search->graph.variable_count; ++x) {
+    generator[x] = vertex_literal(search->permutation[literal_vertex(x)]);
+    moves |= generator[x] != x;
+  }
+  if (moves) ++search->generator_count;
+
+  for (i32 v = 0; v < search->graph.vertex_count; ++v) {
+    i32 a = orbit_root(search, v);
+    i32 b = orbit_root(search, search->permutation[v]);
+    if (a != b) search->orbit[a] = b;
+  }
+}
+
+// Tries to map the vertex of every level of the first path to the other vertices of its cell, starting at the bottom so
+// that the orbits of the generators found deeper (which fix the path above) prune the candidates
+void find_generators(SymmetrySearch *search) {
+  for (i32 k = search->depth - 1; k >= 0; --k) {
+    SearchLevel *level = &search->levels[k];
+    for (i32 w = 0; w < search->graph.vertex_count; ++w) {
+      if (level->colors[w] != level->target_color || w == level->vertex) continue;
+      if (orbit_root(search, w) == orbit_root(search, level->vertex)) continue;
+      if (search->work > symmetry_work_limit || search->generator_count == max_symmetry_generators) return;
+
+      if (map_leaf(search, k, w) && is_automorphism(search)) record_generator(search);
+    }
+  }
+}
+
+// Lex-leader constraint x <= generator(x) over the variables moved by the generator in increasing order. Auxiliary
+// variable p_i means that the first i moved variables equal their images:
+// (-p_(i-1) v -x_i v y_i), (-p_(i-1) v -x_i v p_i) and (-p_(i-1) v y_i v p_i) with y_i the image of x_i
+void add_lex_leader(Formula *formula, i32 *generator, i32 variable_count, SymmetryStats *stats) {
+  i32 previous = 0;
+  i32 moved    = 0;
+  for (i32 x = 1; x <= variable_count && moved < max_lex_leader_variables; ++x) {
+    i32 y = generator[x];
+    if (y == x) continue;
+    ++moved;
+
+    i32 clause[3];
+    i32 length = 0;
+    if (previous) clause[length++] = -previous;
+    clause[length++] = -x;
+
+    // x <= -x only leaves x false and the images can never be equal after it
+    if (y == -x) {
+      push_clause(formula, clause, length);
+      ++stats->clause_count;
+      return;
+    }
+
+    clause[length] = y;
+    push_clause(formula, clause, length + 1);
+    ++stats->clause_count;
+    if (moved == max_lex_leader_variables) return;
+
+    i32 current = ++formula->variable_count;
+    ++stats->variable_count;
+
+    clause[length] = current;
+    push_clause(formula, clause, length + 1);
+    clause[length - 1] = y;
+    push_clause(formula, clause, length + 1);
+    stats->clause_count += 2;
+
+    previous = current;
+  }
+}
+
+SymmetryStats break_symmetries(Formula *formula) {
+  SymmetryStats stats = {0, 0, 0};
+  if (formula->variable_count <= 0 || formula->clause_count <= 0) return stats;
+
+  SymmetrySearch search;
+  search.graph           = build_symmetry_graph(formula);
+  search.work            = 0;
+  search.generator_count = 0;
+
+  i32 vertex_count   = search.graph.vertex_count;
+  search.keys        = CAllocator::construct<RefineKey>(vertex_count);
+  search.right       = CAllocator::construct<i32>(vertex_count);
+  search.left_sizes  = CAllocator::construct<i32>(vertex_count);
+  search.right_sizes = CAllocator::construct<i32>(vertex_count);
+  search.inverse     = CAllocator::construct<i32>(vertex_count);
+  search.permutation = CAllocator::construct<i32>(vertex_count);
+  search.stamp       = CAllocator::construct<i32>(vertex_count);
+  search.orbit       = CAllocator::construct<i32>(vertex_count);
+  search.generators  = CAllocator::construct<i32>(size(max_symmetry_generators) * (formula->variable_count + 1));
+  for (i32 v = 0; v < vertex_count; ++v) {
+    search.orbit[v] = v;
+  }
+
+  if (build_first_path(&search)) find_generators(&search);
+  debug("Symmetry search: depth %d, %ld work\n", search.depth, search.work);
+
+  i32 variable_count = formula->variable_count;
+  for (i32 i = 0; i < search.generator_count; ++i) {
+    add_lex_leader(formula, search.generators + i * (variable_count + 1), variable_count, &stats);
+  }
+  stats.generator_count = search.generator_count;
+
+  for (i32 i = 0; i <= search.depth; ++i) {
+    CAllocator::destruct(search.levels[i].colors);
+  }
+  CAllocator::destruct(search.levels);
+  CAllocator::destruct(search.keys);
+  CAllocator::destruct(search.right);
+  CAllocator::destruct(search.left_sizes);
+  CAllocator::destruct(search.right_sizes);
+  CAllocator::destruct(search.inverse);
+  CAllocator::destruct(search.permutation);
+  CAllocator::destruct(search.stamp);
+  CAllocator::destruct(search.orbit);
+  CAllocator::destruct(search.generators);
+  CAllocator::destruct(search.graph.offsets);
+  CAllocator::destruct(search.graph.edges);
+
+  return stats;
+}
+
+} // namespace sat
@@ -0,0 +1,22 @@
+#ifndef SYMMETRY_HPP
+#define SYMMETRY_HPP
+
+#include "formula.hpp"
+#include "general.hpp"
+
+namespace sat {
+
+struct SymmetryStats {
+  i32 generator_count;
+  i32 clause_count;
+  i32 variable_count;
+};
+
+// Finds generators of the symmetry group of the formula (permutations of the literals which map the set of clauses to
+// itself) and appends lex-leader clauses for them. The clauses keep the lexicographically smallest model of every orbit
+// so satisfiability is preserved but models are removed. Auxiliary variables are numbered after the original ones
+SymmetryStats break_symmetries(Formula *formula);
+
+} // namespace sat
+
+#endif
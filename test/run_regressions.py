@@ -0,0 +1,85 @@
+import subprocess
+import sys
+
+# Small regression inputs in this directory, run from the repository root after `make build`:
+#   python3 test/run_regressions.py [path to sat]
+# Every case is the arguments, the input and the expected exit code, optionally with a line the output must contain.
+# Models of satisfiable answers are checked against the clauses of the input
+
+binary = sys.argv[1] if len(sys.argv) > 1 else "./build/bin/sat"
+
+cases = []
+for h in ["r", "t", "p", "l", "m", "j", "a"]:
+    cases.append(([h], "test/small_sat.cnf", 10, None))
+    cases.append(([h], "test/pigeonhole_4.cnf", 20, None))
+
+# The batch engine keeps clauses as masks and used to turn the tautology into the unit clause -1
+cases.append((["t", "--batch"], "test/batch_tautology.txt", 0, "s SATISFIABLE"))
+
+# Conflicting unit clauses used to be a load error on every path which reloads the formula
+for options in [[], ["--renumber"], ["--bva"], ["--symmetry"], ["--count"], ["--backbone"], ["--core"]]:
+    cases.append((["t"] + options, "test/conflicting_units.cnf", 20, "s UNSATISFIABLE"))
+
+# Cardinality lines which the unit clauses already violate used to be answered as satisfiable, formulas of
+# cardinality lines alone used to be rejected
+for h in ["r", "t", "p", "l", "m", "j", "a"]:
+    cases.append(([h], "test/cardinality_units.cnf", 20, "s UNSATISFIABLE"))
+    cases.append(([h], "test/cardinality_only.cnf", 10, "s SATISFIABLE"))
+
+# Model counting does not support cardinality or xor constraints and used to abort on them
+cases.append((["t"], "test/count_cardinality.cnf", 10, "s SATISFIABLE"))
+cases.append((["t", "--count"], "test/count_cardinality.cnf", 1, None))
+cases.append((["t"], "test/count_xor.cnf", 10, "s SATISFIABLE"))
+cases.append((["t", "--count"], "test/count_xor.cnf", 1, None))
+cases.append((["t", "--count", "--detect-xor"], "test/small_sat.cnf", 1, None))
+cases.append((["t", "--count", "--detect-amo"], "test/pigeonhole_4.cnf", 1, None))
+cases.append((["t", "--enumerate", "--detect-amo"], "test/pigeonhole_4.cnf", 1, None))
+
+# The local search of --hybrid used to ignore the time limit and run through its whole flip budget
+cases.append((["t", "--hybrid", "--flips=1000000000", "--time-limit=1"], "test/pigeonhole_4.cnf", 0, "s UNKNOWN"))
+
+# Output files which cannot be written are errors
+cases.append((["t", "--model=/dev/full"], "test/small_sat.cnf", 1, None))
+cases.append((["t", "--core", "--core-output=/dev/full"], "test/pigeonhole_4.cnf", 1, None))
+
+
+def check_model(path, output):
+    values = set()
+    for line in output.splitlines():
+        if line.startswith("v "):
+            values.update(int(x) for x in line.split()[1:])
+
+    clause = []
+    for line in open(path):
+        if line[0] in "cpkx%":
+            continue
+        for x in line.split():
+            if x != "0":
+                clause.append(int(x))
+            elif not any(literal in values for literal in clause):
+                return False
+            else:
+                clause = []
+    return True
+
+
+failures = 0
+for arguments, path, expected_code, expected_line in cases:
+    command = [binary] + arguments + [path]
+    res = subprocess.run(command, timeout=60, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+
+    failure = None
+    if res.returncode != expected_code:
+        failure = "exit code " + str(res.returncode) + " instead of " + str(expected_code)
+    elif expected_line and expected_line not in res.stdout.splitlines():
+        failure = "no line '" + expected_line + "'"
+    elif res.returncode == 10 and not check_model(path, res.stdout):
+        failure = "model falsifies a clause"
+
+    if failure:
+        failures = failures + 1
+        print("FAILED " + " ".join(command) + ": " + failure)
+        print(res.stdout)
+
+print(str(len(cases) - failures) + "/" + str(len(cases)) + " regressions passed")
+sys.exit(1 if failures else 0)
@@ -1,4 +1,5 @@
 import os
+import re
 import subprocess
 import time
 import statistics
@@ -44,10 +45,11 @@ for r in ratios:
             try:
                 print(h + ":")
                 start = time.time_ns()
-                res = subprocess.run(["./build/bin/sat", h, full_path], timeout=180, stderr=subprocess.PIPE)
+                res = subprocess.run(["./build/bin/sat", h, full_path], timeout=180, stdout=subprocess.PIPE,
+                                     text=True)
                 end = time.time_ns()
 
-                split_count = int(res.stderr)
+                split_count = int(re.search(r"^c Decisions: (\d+)", res.stdout, re.MULTILINE).group(1))
                 splits.append(split_count)
                 print("splits: " + str(split_count))
 
@@ -70,7 +72,7 @@ for r in ratios:
 
         if is_completed:
             num_completed = num_completed + 1
-            if rc == 0:
+            if rc == 10:
                 num_sat = num_sat + 1
 
         print("median splits: " + str(statistics.median(splits)))
@@ -1,119 +1,284 @@
 #include "general.hpp"
+
+#include "formula.hpp"
+#include "generator.hpp"
+#include "mem.hpp"
+#include "solver.hpp"
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
-char *append_int(char *output, i32 value) {
-  char buffer[10];
-  i32 i = 0;
-  if (value == 0) {
-    buffer[0] = 0;
-    ++i;
-  } else {
-    while (value) {
-      assert(i < 10);
-      buffer[i] = value % 10;
-      value /= 10;
-      ++i;
+namespace sat {
+
+enum OutputFormat {
+  DIMACS,
+  BINARY,
+  MEMORY,
+};
+
+struct Options {
+  GeneratorConfig config;
+  i32 instance_count;
+  i32 thread_count;
+  u64 seed;
+  OutputFormat format;
+  cstr output_directory;
+  SplittingHeuristic splitting_heuristic;
+  SolveLimits limits;
+};
+
+// Shared by the generator threads which take instances in order from next_instance
+struct Batch {
+  Options *options;
+  std::atomic<i32> next_instance;
+  std::atomic<i64> clause_total;
+  std::atomic<i32> sat_count;
+  std::atomic<i32> unknown_count;
+  std::atomic<i64> split_total;
+};
+
+f64 seconds_since(timespec *start) {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return f64(now.tv_sec - start->tv_sec) + f64(now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+void format_comment(char *comment, usize length, Options *options, u64 seed) {
+  snprintf(comment, length, "Generated %s instance with size %d, width %d, ratio %f and seed %lu",
+           family_name(options->config.family), options->config.size, options->config.width, options->config.ratio,
+           seed);
+}
+
+// In memory instances go straight into the solver without touching the disk
+void solve_instance(Batch *batch, Formula *formula, i32 instance) {
+  Problem problem;
+  if (load_problem(&problem, formula, batch->options->splitting_heuristic)) panic("Could not load instance\n");
+  problem.limits = batch->options->limits;
+
+  timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ProblemResult result = dpll_solve(&problem);
+  f64 elapsed          = seconds_since(&start);
+
+  cstr result_names[] = {"SAT", "UNSAT", "UNKNOWN"};
+  printf("  %s %d: %s, %d splits, %.3fs\n", family_name(batch->options->config.family), instance,
+         result_names[result], problem.split_count, elapsed);
+  if (result == SAT) ++batch->sat_count;
+  if (result == UNKNOWN) ++batch->unknown_count;
+  batch->split_total += problem.split_count;
+
+  destroy_problem(&problem);
+}
+
+void *generate_batch(void *data) {
+  auto *batch      = (Batch *)data;
+  Options *options = batch->options;
+
+  for (;;) {
+    i32 instance = batch->next_instance++;
+    if (instance >= options->instance_count) break;
+
+    // Seeds only depend on the instance so the output does not depend on the thread count
+    u64 seed        = options->seed + u64(instance);
+    Formula formula = generate_instance(&options->config, seed);
+    batch->clause_total += formula.clause_count;
+
+    char path[256];
+    char comment[256];
+    switch (options->format) {
+    case DIMACS:
+      snprintf(path, sizeof(path), "%s/%s_%d_%d.cnf", options->output_directory, family_name(options->config.family),
+               options->config.size, instance);
+      format_comment(comment, sizeof(comment), options, seed);
+      if (write_dimacs(&formula, path, comment)) panic("Could not write %s\n", path);
+      break;
+    case BINARY:
+      snprintf(path, sizeof(path), "%s/%s_%d_%d.bin", options->output_directory, family_name(options->config.family),
+               options->config.size, instance);
+      if (write_binary(&formula, path)) panic("Could not write %s\n", path);
+      break;
+    case MEMORY: solve_instance(batch, &formula, instance); break;
     }
+
+    destroy_formula(&formula);
   }
-  for (i32 k = i - 1; k >= 0; --k) {
-    *output = buffer[k] + '0';
-    ++output;
-  }
-  return output;
+
+  return nullptr;
 }
 
-char *append_string(char *output, const char *string) {
-  while (*string) {
-    *output = *string;
-    ++output;
-    ++string;
+void run_batch(Options *options) {
+  if (options->format != MEMORY) mkdir(options->output_directory, 0777);
+
+  Batch batch;
+  batch.options       = options;
+  batch.next_instance = 0;
+  batch.clause_total  = 0;
+  batch.sat_count     = 0;
+  batch.unknown_count = 0;
+  batch.split_total   = 0;
+
+  timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  if (options->thread_count == 1) {
+    generate_batch(&batch);
+  } else {
+    auto *threads = CAllocator::construct<pthread_t>(options->thread_count);
+    for (i32 i = 0; i < options->thread_count; ++i) {
+      if (pthread_create(&threads[i], nullptr, generate_batch, &batch)) panic("Could not create thread\n");
+    }
+    for (i32 i = 0; i < options->thread_count; ++i) {
+      pthread_join(threads[i], nullptr);
+    }
+    CAllocator::destruct(threads);
+  }
+
+  f64 elapsed = seconds_since(&start);
+  printf("%d %s instances with %ld clauses in %.3fs\n", options->instance_count, family_name(options->config.family),
+         i64(batch.clause_total), elapsed);
+  if (options->format == MEMORY) {
+    printf("SAT: %d/%d, UNKNOWN: %d, average splits: %.1f\n", i32(batch.sat_count), options->instance_count,
+           i32(batch.unknown_count), f64(batch.split_total) / options->instance_count);
   }
-  return output;
 }
 
-void generate(i32 test_number, f64 ratio) {
-  i32 variable_count = 50;
-  i32 clause_count   = variable_count * ratio;
-
-  char buf[64];
-  char *dst = buf;
-  dst       = append_string(dst, "test_gen/suite/ratio");
-  dst       = append_int(dst, (i32)(ratio * 10));
-  *(dst++)  = '/';
-  dst       = append_int(dst, test_number);
-  *(dst++)  = '_';
-  dst       = append_int(dst, variable_count);
-  *(dst++)  = '_';
-  dst       = append_int(dst, clause_count);
-  dst       = append_string(dst, ".cnf");
-  *dst      = '\0';
-
-  printf("  Generating %s...\n", buf);
-
-  FILE *file = fopen(buf, "w");
-  if (!file) return;
-
-  fprintf(file, "c Test file generated for ratio %f\n", ratio);
-  fprintf(file, "c By Calvin Khiddee-Wu\n");
-  fprintf(file, "p cnf %d %d\n", variable_count, clause_count);
-
-  for (int i = 0; i < clause_count; ++i) {
-    int variable_history[3];
-    for (int k = 0; k < 3; ++k) {
-      if (fast_random(2) == 1) {
-        fprintf(file, "-");
-      }
+// Uniform random 3-SAT at 50 variables for ratios 3.0 to 6.0 which is what run_tests.py expects
+void generate_suite() {
+  mkdir("test_gen/suite", 0777);
 
-      // Enusre no duplicates in a clause
-      i32 variable_id;
-      for (;;) {
-        variable_id = fast_random(variable_count) + 1;
+  GeneratorConfig config = default_generator_config(RANDOM_KSAT);
+  for (i32 r = 30; r <= 60; r += 2) {
+    char directory[64];
+    snprintf(directory, sizeof(directory), "test_gen/suite/ratio%d", r);
+    mkdir(directory, 0777);
+    printf("Int folder %s\n", directory);
 
-        int l = 0;
-        for (; l < k; ++l) {
-          if (variable_history[l] == variable_id) break;
-        }
-        if (l == k) break;
-      }
+    config.ratio = f64(r) / 10;
+    for (i32 k = 0; k < 100; ++k) {
+      u64 seed        = u64(r * 100 + k);
+      Formula formula = generate_instance(&config, seed);
 
-      fprintf(file, "%d ", variable_id);
+      char path[128];
+      char comment[64];
+      snprintf(path, sizeof(path), "%s/%d_%d_%d.cnf", directory, k, config.size, formula.clause_count);
+      snprintf(comment, sizeof(comment), "Test file generated for ratio %f", config.ratio);
+      printf("  Generating %s...\n", path);
+      if (write_dimacs(&formula, path, comment)) panic("Could not write %s\n", path);
 
-      variable_history[k] = variable_id;
+      destroy_formula(&formula);
     }
+  }
+}
 
-    for (int k = 0; k < 3; ++k) {
-      assert(variable_history[k] != 0);
-      for (int l = k + 1; l < 3; ++l) {
-        assert(variable_history[k] != variable_history[l]);
+// Parses "--name=value" and returns nullptr if the argument is a different option
+cstr option_value(cstr arg, cstr name) {
+  usize length = strlen(name);
+  if (strncmp(arg, name, length) || arg[length] != '=') return nullptr;
+  return arg + length + 1;
+}
+
+Result parse_options(Options *options, i32 argc, char **argv) {
+  cstr family = argv[1];
+  if (!strcmp(family, "ksat")) {
+    options->config = default_generator_config(RANDOM_KSAT);
+  } else if (!strcmp(family, "pigeonhole")) {
+    options->config = default_generator_config(PIGEONHOLE);
+  } else if (!strcmp(family, "coloring")) {
+    options->config = default_generator_config(COLORING);
+  } else if (!strcmp(family, "parity")) {
+    options->config = default_generator_config(PARITY);
+  } else if (!strcmp(family, "riddle")) {
+    options->config = default_generator_config(RIDDLE);
+  } else {
+    error("Unknown instance family %s\n", family);
+    return err;
+  }
+
+  options->instance_count      = 1;
+  options->thread_count        = 1;
+  options->seed                = 0x765;
+  options->format              = DIMACS;
+  options->output_directory    = "test_gen/generated";
+  options->splitting_heuristic = TWO_CLAUSE;
+  options->limits              = {0, 0, 0, 0, 0};
+
+  for (i32 i = 2; i < argc; ++i) {
+    cstr arg = argv[i];
+    cstr value;
+    if ((value = option_value(arg, "--size"))) {
+      options->config.size = atoi(value);
+    } else if ((value = option_value(arg, "--width"))) {
+      options->config.width = atoi(value);
+    } else if ((value = option_value(arg, "--ratio"))) {
+      options->config.ratio = atof(value);
+    } else if ((value = option_value(arg, "--instances"))) {
+      options->instance_count = atoi(value);
+    } else if ((value = option_value(arg, "--threads"))) {
+      options->thread_count = atoi(value);
+    } else if ((value = option_value(arg, "--seed"))) {
+      options->seed = strtoull(value, nullptr, 10);
+    } else if ((value = option_value(arg, "--time-limit"))) {
+      options->limits.time_limit = atof(value);
+    } else if ((value = option_value(arg, "--out"))) {
+      options->output_directory = value;
+    } else if ((value = option_value(arg, "--format"))) {
+      if (!strcmp(value, "dimacs")) {
+        options->format = DIMACS;
+      } else if (!strcmp(value, "binary")) {
+        options->format = BINARY;
+      } else if (!strcmp(value, "memory")) {
+        options->format = MEMORY;
+      } else {
+        error("Unknown format %s\n", value);
+        return err;
       }
+    } else if ((value = option_value(arg, "--heuristic"))) {
+      switch (value[0]) {
+      case 'r': options->splitting_heuristic = RANDOM; break;
+      case 't': options->splitting_heuristic = TWO_CLAUSE; break;
+      case 'p': options->splitting_heuristic = POLARITY; break;
+      case 'l': options->splitting_heuristic = LOOKAHEAD; break;
+      case 'm': options->splitting_heuristic = MOMS; break;
+      case 'j': options->splitting_heuristic = JEROSLOW_WANG; break;
+      default: error("Unknown heuristic %s\n", value); return err;
+      }
+    } else {
+      error("Unknown option %s\n", arg);
+      return err;
     }
-    fprintf(file, "0\n");
   }
 
-  fclose(file);
-}
+  if (validate_generator_config(&options->config)) {
+    error("Invalid parameters for %s\n", family);
+    return err;
+  }
+  if (options->instance_count <= 0 || options->thread_count <= 0) {
+    error("Expected at least one instance and one thread\n");
+    return err;
+  }
 
-i32 main() {
-  mkdir("test_gen/suite", 0777);
+  return ok;
+}
 
-  f64 min_ratio = 3;
-  f64 max_ratio = 6;
+} // namespace sat
 
-  f64 ratio = min_ratio;
-  for (i32 i = 0; i <= (max_ratio - min_ratio) / 0.2; ++i) {
-    char buf[20];
-    char *dst = append_string(buf, "test_gen/suite/ratio");
-    dst       = append_int(dst, (i32)(ratio * 10));
-    *dst      = '\0';
-    mkdir(buf, 0777);
-    printf("Int folder %s\n", buf);
+i32 main(i32 argc, char **argv) {
+  if (argc == 1) {
+    sat::generate_suite();
+    return 0;
+  }
 
-    for (i32 k = 0; k < 100; ++k) {
-      generate(k, ratio);
-    }
-    ratio += 0.2;
+  sat::Options options;
+  if (sat::parse_options(&options, argc, argv)) {
+    error("Expected usage: test_gen [ksat|pigeonhole|coloring|parity|riddle] [--size=N] [--width=N] [--ratio=R] "
+          "[--instances=N] [--threads=N] [--seed=N] [--format=dimacs|binary|memory] [--out=DIR] "
+          "[--heuristic=r|t|p|l|m|j] [--time-limit=S]\n");
+    return 1;
   }
 
+  sat::run_batch(&options);
   return 0;
 }